@@ -0,0 +1,40 @@
+/**
+ * @file cbor_writer.h
+ * @brief Minimal CBOR (RFC 8949) encoder into a fixed buffer
+ *
+ * Only what the uplink needs: definite-length maps and arrays, integers,
+ * text, float32 and booleans. Writes past the end set overflow instead of
+ * failing each call, so a message is built straight through and checked
+ * once at the end.
+ */
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;      // Something did not fit; the buffer is unusable
+} CborWriter;
+
+void cborWriterInit(CborWriter *out, uint8_t *buf, size_t cap);
+
+void cborMap(CborWriter *out, size_t pairs);
+void cborArray(CborWriter *out, size_t items);
+void cborUint(CborWriter *out, uint64_t value);
+void cborInt(CborWriter *out, int64_t value);
+void cborText(CborWriter *out, const char *text);
+void cborFloat(CborWriter *out, float value);
+void cborBool(CborWriter *out, bool value);
+
+/**
+ * @brief Bytes written, or 0 after an overflow
+ */
+size_t cborLength(const CborWriter *out);
+
+#endif // CBOR_WRITER_H
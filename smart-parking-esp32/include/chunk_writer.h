@@ -0,0 +1,42 @@
+/**
+ * @file chunk_writer.h
+ * @brief Buffered writer for streamed (chunked) HTTP responses
+ *
+ * Producers such as /history and /metrics emit many small pieces; the
+ * writer collects them into one buffer and hands full buffers to a
+ * backend-specific sink (WebServer::sendContent, httpd_resp_send_chunk).
+ */
+
+#ifndef CHUNK_WRITER_H
+#define CHUNK_WRITER_H
+
+#include <Arduino.h>
+
+#define CHUNK_WRITER_SIZE 512
+
+// Receives the response in pieces; return false to stop (client gone)
+typedef bool (*ChunkSink)(void *ctx, const char *data, size_t len);
+
+typedef struct {
+    char buf[CHUNK_WRITER_SIZE];
+    size_t len;
+    ChunkSink sink;
+    void *ctx;
+    bool ok;            // Cleared once the sink gives up
+} ChunkWriter;
+
+void chunkWriterInit(ChunkWriter *out, ChunkSink sink, void *ctx);
+void chunkWrite(ChunkWriter *out, const void *data, size_t len);
+
+/**
+ * @brief printf one piece (at most CHUNK_WRITER_SIZE - 1 bytes)
+ */
+void chunkPrintf(ChunkWriter *out, const char *fmt, ...);
+
+/**
+ * @brief Send whatever is buffered
+ * @return false if the sink gave up at any point
+ */
+bool chunkFlush(ChunkWriter *out);
+
+#endif // CHUNK_WRITER_H
@@ -20,6 +20,36 @@
 // ============================================================================
 // Create a bot using @BotFather on Telegram to get your token
 #define BOT_TOKEN "your_telegram_bot_token"
+#define TELEGRAM_ALERT_CHAT_ID ""       // Chat that receives alerts, e.g. "123456789" (empty = off)
+
+#define TELEGRAM_LONG_POLL_SEC 25       // getUpdates waits server-side up to this long
+#define TELEGRAM_OUTBOX_SIZE 8          // Queued outgoing messages
+#define TELEGRAM_MSG_MAX 512            // Bytes per queued message
+#define TELEGRAM_REPLY_MAX 256          // Command replies other than /diag and /start
+#define TELEGRAM_BATCH_MAX 1024         // Messages to one chat are merged up to this size
+#define TELEGRAM_MAX_SUBSCRIBERS 16     // Chats on /subscribe, kept in NVS
+#define TELEGRAM_RATE_BURST 3           // Sends allowed back-to-back...
+#define TELEGRAM_RATE_INTERVAL_MS 1000  // ...then one per interval
+
+// ============================================================================
+// MQTT Uplink (see mqtt_uplink.h)
+// ============================================================================
+#define MQTT_BROKER_HOST ""             // e.g. "broker.example.com" (empty = off)
+#define MQTT_BROKER_PORT 1883
+#define MQTT_USERNAME ""                // Empty = anonymous
+#define MQTT_PASSWORD ""
+#define MQTT_DEVICE_ID ""               // Client id and topic level; empty = "lot-" + last 3 MAC bytes
+#define MQTT_TOPIC_PREFIX "parking"     // Topics are <prefix>/<device id>/...
+#define MQTT_BACKLOG_SIZE 256           // Events kept while the broker is unreachable (12 B each)
+#define MQTT_BATCH_MAX 32               // Events per "events" message
+#define MQTT_FLUSH_BURST 4              // Batches sent per poll when draining a backlog...
+#define MQTT_FLUSH_GAP_MS 50            // ...with this pause before the next burst
+#define MQTT_SUMMARY_INTERVAL_MS 60000  // Retained "state" republished at least this often
+#define MQTT_STATE_MIN_INTERVAL_MS 1000 // State changes coalesced to one publish per interval
+#define MQTT_POLL_MS 250                // Command and keepalive poll period
+#define MQTT_KEEPALIVE_SEC 30
+#define MQTT_RECONNECT_MIN_MS 1000      // Reconnect backoff doubles from here...
+#define MQTT_RECONNECT_MAX_MS 60000     // ...up to this
 
 // ============================================================================
 // Hardware Pin Configuration
@@ -37,7 +67,8 @@
 
 // DHT22 Sensor
 #define DHT_PIN 4          // DHT22 data pin
-#define DHT_TYPE DHT22     // Sensor type
+#define DHT_TYPE DHT22     // Sensor type (DHT22 or DHT11)
+#define DHT_RMT_CHANNEL 4  // RMT receiver channel used to time the sensor's pulses
 
 // LCD I2C
 #define LCD_SDA 21         // I2C SDA
@@ -45,18 +76,158 @@
 #define LCD_ADDRESS 0x27   // I2C address (try 0x3F if 0x27 doesn't work)
 #define LCD_COLS 16        // Number of columns
 #define LCD_ROWS 2         // Number of rows
+// I2C clock: the PCF8574 backpack is rated for 100 kHz. Many run at
+// 400000, which quarters the time a redraw holds the bus; opt in per board
+#define LCD_I2C_CLOCK_HZ 100000
+
+// ============================================================================
+// Lanes (see lane.h)
+// ============================================================================
+// One row per lane: name, LANE_ENTRY/LANE_EXIT, IR beam GPIO, servo GPIO.
+// Lanes listing the same servo GPIO share a barrier; every barrier has its
+// own gate task, so separate servos let the lanes run fully in parallel.
+// Example, two entries and two exits, one barrier each:
+//   { "Entry A", LANE_ENTRY, 18, 25 }, { "Entry B", LANE_ENTRY, 5, 33 },
+//   { "Exit A",  LANE_EXIT,  19, 13 }, { "Exit B",  LANE_EXIT, 23, 12 },
+#define LANE_MAX 4              // Table rows allowed (one IR channel + queue each)
+#define LANE_TABLE { \
+    { "Entry", LANE_ENTRY, IR_ENTRY_PIN, SERVO_PIN }, \
+    { "Exit",  LANE_EXIT,  IR_EXIT_PIN,  SERVO_PIN }, \
+}
+
+// ============================================================================
+// IR Sensor Configuration
+// ============================================================================
+#define SENSOR_USE_ISR 1        // 1 = GPIO interrupts, 0 = poll every SENSOR_CHECK_INTERVAL
+#define IR_DEBOUNCE_US 5000     // Edges closer than this are treated as bounce
+#define IR_EDGE_BUFFER_SIZE 16  // ISR -> task edge ring buffer (power of two)
 
 // ============================================================================
 // Parking Configuration
 // ============================================================================
 #define TOTAL_PARKING_SLOTS 4   // Total number of parking slots
-#define GATE_OPEN_TIME_MS 2000  // Time gate stays open (milliseconds)
+#define GATE_OPEN_TIME_MS 2000  // Longest the gate stays open if the beam never clears
+#define GATE_CLEAR_GUARD_MS 300 // Close this long after the car has left the beam
+
+// ============================================================================
+// Per-Bay Sensors (see slot_scanner.h)
+// ============================================================================
+// 0 = none (gate counter only), 1 = 74HC165 chain on SPI, 2 = MCP23017 on I2C
+// When fitted, one sensor per bay: TOTAL_PARKING_SLOTS bays, up to 512
+#define SLOT_SENSOR_TYPE 0
+#define SLOT_SENSOR_ACTIVE_LOW 1    // Sensor output LOW = car present
+#define SLOT_SCAN_INTERVAL_MS 100   // Full scan period
+#define SLOT_RECONCILE_MS 60000     // Gate counter vs bay sensors mismatch tolerated this long
+#define SLOT_SR_LOAD_PIN 32         // 74HC165 SH/LD (all chips)
+#define SLOT_SR_CLK_PIN 14          // 74HC165 CLK
+#define SLOT_SR_DATA_PIN 34         // QH of the chip nearest the ESP32 (input-only pin)
+#define SLOT_SR_SPI_HZ 1000000
+#define SLOT_MCP_BASE_ADDR 0x20     // First MCP23017; chips use consecutive addresses
+
+// ============================================================================
+// Event Journal (flash partition "journal", see partitions.csv)
+// ============================================================================
+#define JOURNAL_BATCH 8             // Flush as soon as this many records wait...
+#define JOURNAL_FLUSH_MS 2000       // ...or at least this often (max events lost on power cut)
+#define JOURNAL_BATCH_MAX 32        // RAM batch capacity; appends beyond it are dropped
+
+// ============================================================================
+// History (/history, RAM only - lost on reboot)
+// ============================================================================
+#define HISTORY_FINE_PERIOD_SEC 60  // Fine bucket length
+#define HISTORY_FINE_COUNT 1440     // 24 h of fine buckets
+#define HISTORY_COARSE_FACTOR 15    // Fine buckets per coarse bucket (15 min)
+#define HISTORY_COARSE_COUNT 2880   // 30 days of coarse buckets
+
+// ============================================================================
+// Latency Trace (/trace, serial 't')
+// ============================================================================
+#define TRACE_RING_SIZE 128         // Most recent car events kept with stage timings
 
 // ============================================================================
 // Servo Positions
 // ============================================================================
 #define SERVO_CLOSED_ANGLE 90   // Angle for closed gate
 #define SERVO_OPEN_ANGLE 0      // Angle for open gate
+#define SERVO_LEDC_CHANNEL 0    // First barrier's PWM channel (barrier n uses +n)
+#define SERVO_MIN_PULSE_US 544  // Pulse width at 0 degrees
+#define SERVO_MAX_PULSE_US 2400 // Pulse width at 180 degrees
+#define SERVO_MAX_SPEED_DPS 360 // Ramp cruise speed (deg/s)
+#define SERVO_ACCEL_DPS2 1440   // Ramp acceleration (deg/s^2): 90 deg swing = 500 ms
+#define SERVO_RAMP_TICK_MS 10   // Profile update period
+
+// ============================================================================
+// Power (see power.h)
+// ============================================================================
+// 1 = low-power mode (set by env:esp32dev_lowpower): CPU frequency scaling,
+// WiFi modem sleep, and automatic light sleep with the IR pins as wake
+// sources if the framework was built with tickless idle
+#ifndef POWER_SAVE_MODE
+#define POWER_SAVE_MODE 0
+#endif
+#define POWER_MAX_FREQ_MHZ 240
+#define POWER_MIN_FREQ_MHZ 80       // Lowest DFS step while awake (WiFi needs 80)
+
+// ============================================================================
+// Reservations (see reservation.h)
+// ============================================================================
+#define RESERVATION_MAX 8               // Store size; RESERVATION_MAX_HELD_PCT is what limits bookings
+#define RESERVATION_TABLE_SIZE 16       // Hash slots: power of two, >= 2 x RESERVATION_MAX
+#define RESERVATION_MAX_HELD_PCT 50     // Share of the capacity bookings may hold (at least one slot)
+#define RESERVATION_PER_REQUESTER 1     // Open bookings per Telegram chat or web requester
+#define RESERVATION_CHAT_IDS ""         // Chats allowed to book, e.g. "123,456" (empty = TELEGRAM_ALERT_CHAT_ID only)
+#define RESERVATION_API_TOKEN ""        // POST /reserve needs token=<this> to book or cancel (empty = off)
+#define RESERVATION_HOLD_MIN 30         // Default hold when none is given (minutes)
+#define RESERVATION_MAX_HOLD_MIN 240
+#define RESERVATION_WHEEL_SLOTS 64      // Expiry wheel: one turn = 64 x 30 s = 32 min,
+#define RESERVATION_WHEEL_TICK_S 30     // longer holds go round several times
+
+// ============================================================================
+// Occupancy Forecast (see forecast.h; /data "fullInMin", Telegram /all)
+// ============================================================================
+#define FORECAST_EMA_ALPHA 0.25f        // Weight of each new week in a weekday/hour bucket
+#define FORECAST_HORIZON_H 12           // Look this far ahead for the lot filling up
+#define FORECAST_MIN_OBSERVED_SEC 1800  // Partly watched hours shorter than this are not learned
+
+// ============================================================================
+// Lot Federation (see federation.h; /data "siteAvailable", LCD)
+// ============================================================================
+// Give every controller of a site its own name ("Level 1", "North") to
+// share occupancy with the others on the LAN; "" keeps the node on its own
+#ifndef FED_NODE_NAME
+#define FED_NODE_NAME ""                // Or -DFED_NODE_NAME='"Level 2"' per env
+#endif
+#define FED_GROUP "239.255.80.1"        // Multicast group (administratively scoped)
+#define FED_PORT 45454
+#define FED_TTL 1                       // Stay on the local subnet
+#define FED_MAX_PEERS 15                // Other nodes tracked (site of 16)
+#define FED_DELTA_MIN_MS 20             // Changes closer together are coalesced
+#define FED_SYNC_RATE 2                 // Anti-entropy syncs per second, whole site
+#define FED_SYNC_MIN_MS 1000            // Shortest sync period of one node
+#define FED_EXPIRE_SYNCS 3              // Missed sync periods before a peer is dropped
+
+// ============================================================================
+// Memory (see heap_watch.h)
+// ============================================================================
+#define MEM_SAMPLE_INTERVAL_MS 60000    // Heap / largest-free-block sample period
+#define MEM_TREND_SAMPLES 60            // Trend window (samples)
+#define MEM_FRAG_ALERT_BYTES 20480      // Alert once the largest free block is below this (TLS needs ~17 KB)
+
+// ============================================================================
+// OTA Updates (see ota_update.h; MQTT command "update <url>")
+// ============================================================================
+// Public key for the image signatures (PEM, one string); empty = OTA off.
+//   openssl ecparam -name prime256v1 -genkey -noout -out ota_key.pem
+//   openssl ec -in ota_key.pem -pubout
+#define OTA_PUBLIC_KEY_PEM ""
+#define OTA_CHUNK_SIZE 4096             // Streamed into flash this much at a time (whole sectors)
+#define OTA_CHECKPOINT_BYTES 65536      // Progress saved to NVS this often, for resume after a reset
+#define OTA_MAX_RESUMES 8               // Range requests after dropped transfers before giving up
+#define OTA_RETRY_MS 5000
+#define OTA_READ_TIMEOUT_MS 10000       // A read stalled this long counts as dropped
+#define OTA_GATE_DEFER_MS 3000          // Longest a flash write waits for the barriers to come down
+#define OTA_TRIAL_BOOTS 3               // Resets a new image may take before rolling back (1 with bootloader rollback)
+#define OTA_CONFIRM_MS 120000           // Uptime with WiFi that confirms a new image
 
 // ============================================================================
 // Time Configuration
@@ -66,6 +237,37 @@
 #define NTP_SERVER "pool.ntp.org"
 #define GMT_OFFSET_SEC 7200     // GMT+2 for Cairo
 #define DAYLIGHT_OFFSET_SEC 0
+#define TIME_SYNC_INTERVAL_MS 3600000   // SNTP resync period; the clock free-runs on esp_timer in between
+#define TIME_SNTP_TIMEOUT_MS 15000      // Fall back to TIME_API_URL if SNTP has not answered by then
+#define TIME_RETRY_INTERVAL_MS 60000    // Minimum gap between time API attempts
+
+// ============================================================================
+// Connectivity (see connectivity.h)
+// ============================================================================
+#define CONNECTIVITY_FAIL_THRESHOLD 3       // Consecutive failed requests before "no internet"
+#define CONNECTIVITY_IDLE_MS 60000          // Probe only after this long without any network traffic
+#define CONNECTIVITY_PROBE_MIN_MS 15000     // Probe interval doubles from here...
+#define CONNECTIVITY_PROBE_MAX_MS 600000    // ...up to this while the network stays quiet
+#define CONNECTIVITY_PROBE_HOST "clients3.google.com"   // TCP connect only, nothing is sent
+#define CONNECTIVITY_PROBE_PORT 80
+#define CONNECTIVITY_PROBE_TIMEOUT_MS 2000
+
+// ============================================================================
+// Web Server Configuration
+// ============================================================================
+// HTTP engine: 0 = Arduino WebServer polled by webServerTask,
+// 1 = event-driven esp_http_server (set by env:esp32dev_async)
+#ifndef WEB_ASYNC_BACKEND
+#define WEB_ASYNC_BACKEND 0
+#endif
+#define WEB_REQUEST_SOCKETS 4   // Async backend: connections beyond the SSE_MAX_CLIENTS /events streams
+
+// Dashboard is gzipped into flash at build time; clients revalidate via ETag
+#define WEB_CACHE_CONTROL "no-cache"
+
+// Live updates (/events, Server-Sent Events)
+#define SSE_MAX_CLIENTS 8       // Concurrent dashboard viewers
+#define SSE_KEEPALIVE_MS 15000  // Comment ping when nothing changed
 
 // ============================================================================
 // Task Configuration (FreeRTOS)
@@ -74,7 +276,7 @@
 #define HARDWARE_CORE 0    // Core for hardware tasks (pro_cpu)
 #define COMM_CORE 1        // Core for communication tasks (app_cpu)
 
-// Stack Sizes (in bytes)
+// Stack Sizes (in bytes; static, see static_rtos.h)
 #define SENSOR_TASK_STACK 4096
 #define GATE_TASK_STACK 4096
 #define LED_TASK_STACK 2048
@@ -83,6 +285,13 @@
 #define WEB_TASK_STACK 8192
 #define TELEGRAM_TASK_STACK 8192
 #define WIFI_TASK_STACK 6144
+#define EVENTS_TASK_STACK 4096
+#define TELEGRAM_SEND_TASK_STACK 8192
+#define SLOT_SCAN_TASK_STACK 3072
+#define JOURNAL_TASK_STACK 3072
+#define MQTT_TASK_STACK 4096
+#define OTA_TASK_STACK 8192
+#define FED_TASK_STACK 3072
 
 // Task Priorities (higher = more priority)
 #define SENSOR_TASK_PRIORITY 3
@@ -93,23 +302,34 @@
 #define WEB_TASK_PRIORITY 1
 #define TELEGRAM_TASK_PRIORITY 1
 #define WIFI_TASK_PRIORITY 1
+#define EVENTS_TASK_PRIORITY 1
+#define TELEGRAM_SEND_TASK_PRIORITY 1
+#define SLOT_SCAN_TASK_PRIORITY 1
+#define JOURNAL_TASK_PRIORITY 1
+#define MQTT_TASK_PRIORITY 1
+#define OTA_TASK_PRIORITY 1     // Lowest application priority; gate tasks run on the other core
+#define FED_TASK_PRIORITY 2     // Ahead of the TLS tasks so site updates stay prompt
 
 // ============================================================================
 // Timing Intervals (milliseconds)
 // ============================================================================
-#define SENSOR_CHECK_INTERVAL 50
+#define SENSOR_CHECK_INTERVAL 50    // Polling mode only (SENSOR_USE_ISR 0)
 #define DHT_READ_INTERVAL 2000
-#define LCD_UPDATE_INTERVAL 500
+#define DHT_TEMP_STEP_C 0.5         // Publish temperature changes of at least this much...
+#define DHT_HUM_STEP_PCT 2.0        // ...or humidity changes of at least this much
+#define DHT_EMA_ALPHA 0.3           // Smoothing weight of each new sample
+#define DHT_OUTLIER_TEMP_C 3.0      // Samples this far from the recent median are ignored
+#define DHT_OUTLIER_HUM_PCT 10.0
+#define LCD_MESSAGE_HOLD_MS 500     // How long gate messages stay on the LCD
 #define WIFI_CHECK_INTERVAL 10000
-#define TIME_UPDATE_INTERVAL 5000
-#define TELEGRAM_CHECK_INTERVAL 1000
+#define WIFI_UNSYNCED_INTERVAL 1000 // wifiTask period until the clock has synced
+#define TELEGRAM_CHECK_INTERVAL 1000   // Retry delay when a long poll fails
 #define WEB_SERVER_INTERVAL 10
 
 // ============================================================================
 // Queue Sizes
 // ============================================================================
-#define ENTRY_QUEUE_SIZE 5
-#define EXIT_QUEUE_SIZE 5
+#define LANE_QUEUE_SIZE 5       // Per lane (car and beam-clear events)
 #define LCD_QUEUE_SIZE 10
 
 // ============================================================================
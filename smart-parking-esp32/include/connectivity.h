@@ -0,0 +1,61 @@
+/**
+ * @file connectivity.h
+ * @brief Internet reachability inferred from real traffic
+ *
+ * Telegram, MQTT and the time sync report whether their requests got
+ * through; CONNECTIVITY_FAIL_THRESHOLD failures in a row (with no
+ * success in between) mark the uplink unreachable and any success marks
+ * it reachable again. Only when nothing has reported for
+ * CONNECTIVITY_IDLE_MS does wifiTask run an active probe (one TCP
+ * connect, no HTTP), and successive probes back off exponentially from
+ * CONNECTIVITY_PROBE_MIN_MS to CONNECTIVITY_PROBE_MAX_MS.
+ *
+ * Changes are published as internetConnected in the parking state.
+ */
+
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <Arduino.h>
+
+typedef enum {
+    CONN_SOURCE_TELEGRAM,
+    CONN_SOURCE_MQTT,
+    CONN_SOURCE_NTP,
+    CONN_SOURCE_TIME_API,
+    CONN_SOURCE_PROBE,
+    CONN_SOURCE_COUNT
+} ConnectivitySource;
+
+/**
+ * @brief Outcome of one real network operation (non-blocking, any task)
+ */
+void connectivityReport(ConnectivitySource source, bool ok);
+
+/**
+ * @brief WiFi link state from wifiTask; link down means unreachable
+ */
+void connectivitySetLink(bool up);
+
+/**
+ * @brief Run the active probe if one is due; call from wifiTask
+ *
+ * Returns at once unless a probe is due, in which case it blocks for at
+ * most CONNECTIVITY_PROBE_TIMEOUT_MS.
+ */
+void connectivityMaintain();
+
+/**
+ * @brief Milliseconds until connectivityMaintain() may probe
+ *        (UINT32_MAX while the link is down)
+ */
+uint32_t connectivityMsToNextProbe();
+
+bool connectivityReachable();
+
+/**
+ * @brief Active probes sent since boot
+ */
+uint32_t connectivityProbeCount();
+
+#endif // CONNECTIVITY_H
@@ -0,0 +1,53 @@
+/**
+ * @file dht_reader.h
+ * @brief DHT11/DHT22 reader on the RMT receiver, interrupts left enabled
+ *
+ * The usual bit-banged driver times the 40 data bits with interrupts
+ * disabled for ~5 ms, which stalls the gate path on the same core. Here
+ * the start pulse is a task delay and the RMT peripheral measures the
+ * sensor's pulses on its own; the task only decodes the captured
+ * durations afterwards. Temperature and humidity come from one
+ * transaction.
+ */
+
+#ifndef DHT_READER_H
+#define DHT_READER_H
+
+#include <Arduino.h>
+
+#ifndef DHT11
+    #define DHT11 11
+#endif
+#ifndef DHT22
+    #define DHT22 22
+#endif
+
+typedef enum {
+    DHT_OK,
+    DHT_ERR_TIMEOUT,        // No capture (sensor missing or wiring)
+    DHT_ERR_NO_RESPONSE,    // Captured pulses, but no 80/80 us preamble
+    DHT_ERR_SHORT,          // Fewer than 40 bits captured
+    DHT_ERR_CHECKSUM
+} DhtStatus;
+
+typedef struct {
+    float temperature;      // deg C
+    float humidity;         // % RH
+} DhtReading;
+
+/**
+ * @brief Claim the RMT channel and set the pin up as open drain
+ * @return false if the RMT driver could not be installed
+ */
+bool dhtReaderBegin(uint8_t pin, uint8_t type);
+
+/**
+ * @brief One blocking transaction (~5 ms, the task sleeps meanwhile)
+ *
+ * Do not call more often than every 2 s (DHT22) or 1 s (DHT11).
+ */
+DhtStatus dhtRead(DhtReading *out);
+
+const char *dhtStatusName(DhtStatus status);
+
+#endif // DHT_READER_H
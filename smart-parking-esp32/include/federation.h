@@ -0,0 +1,68 @@
+/**
+ * @file federation.h
+ * @brief Site-wide occupancy across several controllers over UDP multicast
+ *
+ * Each node (one per level or entrance) owns one record: its walk-in free
+ * slots, capacity and FED_NODE_NAME. Records are sent to FED_GROUP:FED_PORT
+ * as ~35-byte datagrams; nodes on the same LAN hear each other directly,
+ * so nothing is relayed and every record has exactly one writer.
+ *
+ *   delta  sent as soon as this node's record changes, at most one per
+ *          FED_DELTA_MIN_MS (later changes are coalesced into the next)
+ *   sync   the record plus a digest of (node, seq) for every peer this
+ *          node has heard. A peer whose entry is missing or out of date
+ *          answers with a delta (anti-entropy), so a lost datagram or a
+ *          node that just joined is repaired within one sync.
+ *
+ * Every record carries a per-boot id and a sequence number bumped on
+ * each change; older or duplicate records are dropped and skipped
+ * numbers are counted as lost deltas. Syncs are spread out as the site
+ * grows: each node sends one every nodes * 1000 / FED_SYNC_RATE ms
+ * (never more often than FED_SYNC_MIN_MS, with jitter), so the whole site
+ * stays at about FED_SYNC_RATE syncs per second. A peer is dropped from
+ * the aggregate after FED_EXPIRE_SYNCS of its own intervals without news.
+ *
+ * The aggregate, and the peer with the most room while this node is
+ * full, are published through the parking state (siteAvailable,
+ * siteTotal, siteNodes, redirect), so /data, /events and the LCD pick
+ * them up like any other field.
+ */
+
+#ifndef FEDERATION_H
+#define FEDERATION_H
+
+#include <Arduino.h>
+
+typedef struct {
+    uint8_t peers;              // Heard from within their expiry
+    uint32_t txDeltas;
+    uint32_t txSyncs;
+    uint32_t txRepairs;         // Deltas sent because a peer's digest was behind
+    uint32_t txBytes;
+    uint32_t rxPackets;         // Valid records from peers
+    uint32_t rxBytes;
+    uint32_t rxStale;           // Records older than one already applied (reordered)
+    uint32_t rxLost;            // Sequence numbers never received
+    uint32_t rxRejected;        // Bad size, magic or version, or the peer table was full
+    uint32_t expired;           // Peers dropped for silence
+    uint32_t syncIntervalMs;    // Current own sync period
+} FederationStats;
+
+/**
+ * @brief Set up the node id and state listener; call once in setup()
+ * @return false if FED_NODE_NAME is empty (federation off, no task needed)
+ */
+bool federationBegin();
+
+bool federationEnabled();
+
+void federationGetStats(FederationStats *out);
+
+/**
+ * @brief Federation task - joins the group while WiFi is up, sends
+ *        deltas and syncs, expires silent peers
+ * Runs on Core 1 (Communication)
+ */
+void federationTask(void *parameter);
+
+#endif // FEDERATION_H
@@ -0,0 +1,55 @@
+/**
+ * @file forecast.h
+ * @brief "Full in N minutes" estimate from learned weekday/hour traffic
+ *
+ * Arrival and departure rates are kept per weekday and hour (7 x 24
+ * buckets, ~2 KB, saved to NVS) as exponential moving averages. The gate
+ * path only bumps two counters per car; forecastMaintain() folds each
+ * finished hour into its bucket, so every bucket is one EMA step per week.
+ * An hour watched for less than FORECAST_MIN_OBSERVED_SEC (boot, clock
+ * not yet synced) is scaled up if half seen, otherwise dropped.
+ *
+ * forecastGet() walks the buckets ahead of now with the current walk-in
+ * vacancy until the expected net inflow fills the lot, up to
+ * FORECAST_HORIZON_H. The result is cached as an absolute time until the
+ * next car, a vacancy change or a model update, so repeated /data and
+ * Telegram requests cost a comparison. Buckets not seen yet fall back to
+ * the same hour on the other weekdays.
+ */
+
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <Arduino.h>
+#include "system_event.h"
+
+typedef struct {
+    bool ready;                 // Every hour up to the horizon has data
+    int16_t minutesToFull;      // 0 = full now, -1 = not within the horizon (or not ready)
+    float arrivalsPerHour;      // Expected this hour
+    float departuresPerHour;
+} ForecastResult;
+
+/**
+ * @brief Load the model from NVS; call once in setup()
+ */
+void forecastBegin();
+
+/**
+ * @brief Count a car (EVENT_CAR_ENTRY / EVENT_CAR_EXIT, others ignored);
+ *        any task, two atomic increments
+ */
+void forecastRecord(EventType type);
+
+/**
+ * @brief Fold finished hours into the model and save it; call from
+ *        wifiTask (more often than once an hour)
+ */
+void forecastMaintain();
+
+/**
+ * @brief Current estimate (cached, see above)
+ */
+void forecastGet(ForecastResult *out);
+
+#endif // FORECAST_H
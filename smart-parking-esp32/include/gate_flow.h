@@ -0,0 +1,73 @@
+/**
+ * @file gate_flow.h
+ * @brief Entry/exit path from a lane event to a barrier action
+ *
+ * Takes or frees the slot in the parking state, asks the barrier's state
+ * machine to open, remembers which lanes still have a granted car in the
+ * beam and closes early once they have all cleared. The gate tasks in
+ * main.cpp and the host bench (sim/bench.cpp) run this same code; what
+ * only exists on the device (servo, journal, MQTT, LCD, reservations)
+ * goes through GateFlowHooks.
+ *
+ * A barrier's state is only touched by the task that serves the barrier,
+ * so nothing here is locked.
+ */
+
+#ifndef GATE_FLOW_H
+#define GATE_FLOW_H
+
+#include <Arduino.h>
+#include "gate_fsm.h"
+#include "system_event.h"
+#include "trace.h"
+
+typedef struct {
+    // Drive a barrier's servo; returns when the command went out (us)
+    int64_t (*actuate)(int barrier, GateAction action);
+    // Entry on a lane: has a reservation checked in there? NULL = walk-ins only
+    bool (*reservationWaiting)(int lane);
+    // The booked car has its slot: consume the check-in. False if the
+    // reservation went away in between (its hold was already released)
+    bool (*claimReservation)(int lane);
+    // Slot taken (EVENT_CAR_ENTRY), freed (EVENT_CAR_EXIT) or the car
+    // turned away (EVENT_PARKING_FULL), before the barrier moves
+    void (*counted)(int lane, EventType type, bool reserved, int remaining);
+    // A car event was decided and traced (NULL = nothing else to record)
+    void (*decided)(const SystemEvent *event, TraceOutcome outcome, int64_t actuatedUs);
+} GateFlowHooks;
+
+/**
+ * @brief Close every barrier's state machine; call after lanesBegin()
+ */
+void gateFlowBegin(const GateFlowHooks *hooks, uint32_t travelMs);
+
+const GateFsm *gateFlowFsm(int barrier);
+
+/**
+ * @brief Car at an entry lane: take a slot (the held one for a
+ *        reservation) and open, or turn it away if the lot is full
+ */
+TraceOutcome gateFlowEntry(int lane, const SystemEvent *event, uint32_t nowMs);
+
+/**
+ * @brief Car at an exit lane: free a slot and open
+ */
+TraceOutcome gateFlowExit(int lane, const SystemEvent *event, uint32_t nowMs);
+
+/**
+ * @brief A lane's beam cleared - close early once every granted car is through
+ */
+void gateFlowBeamClear(int lane, uint32_t nowMs);
+
+/**
+ * @brief Open without a car; the barrier comes down after GATE_OPEN_TIME_MS
+ *        unless a real car extends it
+ */
+void gateFlowRemoteOpen(int barrier, uint32_t nowMs);
+
+/**
+ * @brief Advance a barrier's timers (call whenever its task wakes)
+ */
+void gateFlowTick(int barrier, uint32_t nowMs);
+
+#endif // GATE_FLOW_H
@@ -0,0 +1,72 @@
+/**
+ * @file gate_fsm.h
+ * @brief Timer-driven barrier state machine (IDLE/OPENING/OPEN/CLOSING)
+ *
+ * Pure logic: the caller passes the current time in and performs the
+ * returned servo action, so one gate task can drive several barriers
+ * without ever blocking on a delay.
+ */
+
+#ifndef GATE_FSM_H
+#define GATE_FSM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    GATE_IDLE,      // Barrier down
+    GATE_OPENING,   // Servo moving up
+    GATE_OPEN,      // Barrier up, waiting for the car to pass
+    GATE_CLOSING    // Servo moving down
+} GateState;
+
+typedef enum {
+    GATE_ACTION_NONE,
+    GATE_ACTION_OPEN,   // Drive the servo to the open angle
+    GATE_ACTION_CLOSE   // Drive the servo to the closed angle
+} GateAction;
+
+typedef struct {
+    GateState state;
+    uint32_t deadlineMs;    // When the current state times out
+    uint32_t travelMs;      // Servo travel time between end positions
+    uint32_t holdMs;        // Longest the barrier stays up waiting for the car
+    uint32_t guardMs;       // Delay between the car clearing and closing
+    bool released;          // Every granted car has cleared the beam
+} GateFsm;
+
+void gateFsmInit(GateFsm *fsm, uint32_t travelMs, uint32_t holdMs, uint32_t guardMs);
+
+/**
+ * @brief A car has been granted passage
+ *
+ * Opens an idle barrier, reopens a closing one, and restarts the hold
+ * time of an open one so back-to-back cars pass in a single cycle.
+ */
+GateAction gateFsmRequest(GateFsm *fsm, uint32_t nowMs);
+
+/**
+ * @brief All cars granted passage have cleared the beam
+ *
+ * The barrier closes guardMs later instead of waiting out holdMs; if it
+ * is still opening, the guard starts once it is fully up.
+ */
+void gateFsmRelease(GateFsm *fsm, uint32_t nowMs);
+
+/**
+ * @brief Advance the state machine; call whenever a deadline expires
+ */
+GateAction gateFsmTick(GateFsm *fsm, uint32_t nowMs);
+
+/**
+ * @brief Milliseconds until the next deadline
+ * @return -1 when the barrier is idle
+ */
+int32_t gateFsmTimeToNext(const GateFsm *fsm, uint32_t nowMs);
+
+/**
+ * @brief Human readable state ("Closed", "Opening", "Open", "Closing")
+ */
+const char *gateStateName(GateState state);
+
+#endif // GATE_FSM_H
@@ -0,0 +1,54 @@
+/**
+ * @file heap_watch.h
+ * @brief Heap-fragmentation watch
+ *
+ * Without PSRAM the heap is ~300 KB shared with WiFi and two TLS
+ * sessions. The firmware's own transient buffers (Telegram replies and
+ * /diag, MQTT payloads, OTA chunks, federation packets, the outbox batch)
+ * are static arrays, so what allocates at run time is library code:
+ * WiFiClientSecure/mbedTLS sessions, HTTPClient, the web servers,
+ * AsyncUDP packets, PubSubClient. This module watches the result.
+ *
+ * heapWatchMaintain() samples the free heap and the largest free block
+ * every MEM_SAMPLE_INTERVAL_MS and keeps MEM_TREND_SAMPLES of them for
+ * the trend. When the largest block drops below MEM_FRAG_ALERT_BYTES (a
+ * TLS handshake needs one contiguous ~17 KB buffer) a Telegram alert is
+ * sent, once until it recovers by a quarter. Every failed heap request,
+ * from any caller, is counted.
+ */
+
+#ifndef HEAP_WATCH_H
+#define HEAP_WATCH_H
+
+#include <Arduino.h>
+
+typedef struct {
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;      // Since boot
+    uint32_t largestBlock;
+    uint32_t minLargestBlock;   // Since boot
+    int32_t largestTrendPerHour;    // Change over the trend window, bytes/h
+    uint32_t failedAllocs;      // Heap requests that returned NULL (any caller)
+    uint32_t largestFailedAlloc;
+    bool fragmented;            // Alert raised and not yet cleared
+} HeapStats;
+
+/**
+ * @brief Hook heap failures and take the first sample; call first in setup()
+ */
+void heapWatchBegin();
+
+/**
+ * @brief Sample the heap when due and raise or clear the fragmentation
+ *        alert; call from wifiTask
+ */
+void heapWatchMaintain();
+
+/**
+ * @brief Print the heap budget to Serial
+ */
+void heapWatchReport(const char *when);
+
+void heapWatchStats(HeapStats *out);
+
+#endif // HEAP_WATCH_H
@@ -0,0 +1,63 @@
+/**
+ * @file history.h
+ * @brief On-device downsampled time series for /history
+ *
+ * State is sampled once a second into a running accumulator; every
+ * HISTORY_FINE_PERIOD_SEC the accumulator closes a bucket in the fine
+ * ring, and every HISTORY_COARSE_FACTOR fine buckets are merged into one
+ * coarse bucket. Both rings are fixed-size RAM arrays of 8-byte samples
+ * (defaults: 1 min for 24 h and 15 min for 30 days, about 34 KB).
+ *
+ * Bucket times are local epoch seconds at the end of the bucket, or
+ * uptime seconds while the clock has never been synced.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include "chunk_writer.h"
+
+typedef struct {
+    uint16_t occupiedAvg10;     // Mean occupied slots x10
+    uint16_t occupiedMax;
+    int16_t temperature10;      // Mean degC x10
+    uint8_t humidity2;          // Mean %RH x2
+    uint8_t gateCycles;         // Barrier openings (saturates at 255)
+} HistorySample;
+
+typedef struct {
+    uint32_t resolutionSec;     // Finest tier whose period is >= this
+    uint32_t from;              // Bucket end times, inclusive (0 = no bound)
+    uint32_t to;
+    bool binary;                // false = CSV
+} HistoryQuery;
+
+/**
+ * @brief Start the 1 s sampling timer
+ */
+void historyBegin();
+
+/**
+ * @brief Count one barrier opening (any task)
+ */
+void historyCountGateCycle();
+
+/**
+ * @brief Stream the samples matching a query
+ *
+ * CSV: a header row, then "time,occupied_avg,occupied_max,gate_cycles,
+ * temperature,humidity" per bucket. Binary: a 16-byte header ("PKH1",
+ * u16 period, u16 count, u32 first time, u8 flags, 3 reserved) followed
+ * by count little-endian HistorySample records.
+ *
+ * @return false if the sink gave up
+ */
+bool historyStream(const HistoryQuery *query, ChunkSink sink, void *ctx);
+
+/**
+ * @brief Content-Type for a query's format
+ */
+const char *historyContentType(const HistoryQuery *query);
+
+#endif // HISTORY_H
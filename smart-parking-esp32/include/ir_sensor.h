@@ -0,0 +1,71 @@
+/**
+ * @file ir_sensor.h
+ * @brief Interrupt-driven IR beam sensing with software debounce
+ *
+ * The GPIO ISR only timestamps edges (esp_timer_get_time) and pushes them
+ * into a small ring buffer, then wakes the sensor task with a task
+ * notification. Debouncing happens in task context.
+ */
+
+#ifndef IR_SENSOR_H
+#define IR_SENSOR_H
+
+#include <Arduino.h>
+
+#define IR_MAX_CHANNELS 8
+
+// Raw edge captured in the ISR
+typedef struct {
+    uint8_t channel;    // Index into the pins given to irSensorBegin()
+    uint8_t level;      // Pin level after the edge (LOW = beam broken)
+    int64_t timeUs;     // esp_timer_get_time() at the edge
+} IrEdge;
+
+// Per-channel debounce state
+typedef struct {
+    bool blocked;           // Debounced beam state (true = car present)
+    bool pending;           // An edge was ignored inside the window
+    int64_t lastChangeUs;   // Time of the last accepted transition
+} IrDebounce;
+
+/**
+ * @brief Feed one edge into a debouncer
+ *
+ * The first edge that changes the debounced state is accepted at once, so
+ * detection latency is the ISR latency. Further edges inside windowUs are
+ * treated as bounce and only mark the channel as pending, so the task can
+ * resample the pin once the window has passed.
+ *
+ * @return true if the debounced state changed
+ */
+bool irDebounceFeed(IrDebounce *d, bool blocked, int64_t timeUs, int64_t windowUs);
+
+/**
+ * @brief Configure the IR pins and attach the edge interrupts
+ * @param pins One GPIO per channel (up to IR_MAX_CHANNELS)
+ * @param notifyTask Task to wake (vTaskNotifyGiveFromISR) on every edge
+ */
+void irSensorBegin(const uint8_t *pins, int count, TaskHandle_t notifyTask);
+
+/**
+ * @brief Get the next debounced transition, if any
+ *
+ * Drains the ISR ring buffer and resamples channels whose debounce window
+ * has expired with an edge still pending.
+ *
+ * @return true if a transition was written to edge
+ */
+bool irSensorPoll(IrEdge *edge);
+
+/**
+ * @brief Ticks the sensor task may block before it has to resample a pin
+ * @return portMAX_DELAY when no channel is pending
+ */
+TickType_t irSensorNextTimeout();
+
+/**
+ * @brief Number of edges lost because the ring buffer was full
+ */
+uint32_t irSensorDroppedEdges();
+
+#endif // IR_SENSOR_H
@@ -0,0 +1,60 @@
+/**
+ * @file journal.h
+ * @brief Append-only event journal in the "journal" flash partition
+ *
+ * Fixed 16-byte records are written round-robin through the partition;
+ * the sector after the head is erased just before it is reused, so the
+ * journal always holds the newest (sectors - 1) * 256 events. Appends go
+ * to a RAM batch that journalTask writes out every JOURNAL_FLUSH_MS or as
+ * soon as JOURNAL_BATCH records are waiting, which keeps flash writes
+ * (and wear) to one program operation per batch.
+ *
+ * Every record carries the free-slot count after its event, so restoring
+ * occupancy at boot only needs the newest record.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <Arduino.h>
+#include "system_event.h"
+
+#define JOURNAL_FLAG_UPTIME 0x01    // timestamp is uptime seconds (clock not synced)
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;           // Monotonic; 0xFFFFFFFF = erased flash
+    uint32_t timestamp;     // Local epoch seconds, or uptime (JOURNAL_FLAG_UPTIME)
+    uint8_t type;           // EventType
+    uint8_t flags;
+    int16_t value;          // Event-specific (barrier index, corrected count...)
+    uint16_t available;     // Free slots right after the event
+    uint16_t crc;           // CRC-16/CCITT of the bytes above
+} JournalRecord;
+
+/**
+ * @brief Locate the partition and find the newest record
+ * @param last Newest valid record (out)
+ * @return true if the journal holds at least one record
+ */
+bool journalBegin(JournalRecord *last);
+
+/**
+ * @brief Queue an event (non-blocking, any task); stamps time and state
+ * @return false if the batch is full or the journal is unavailable
+ */
+bool journalAppend(EventType type, int value);
+
+/**
+ * @brief Write all queued records now (e.g. before a restart)
+ */
+void journalFlush();
+
+uint32_t journalDropped();
+
+/**
+ * @brief Background flusher
+ * Runs on Core 0 (Hardware)
+ */
+void journalTask(void *parameter);
+
+#endif // JOURNAL_H
@@ -0,0 +1,110 @@
+/**
+ * @file lane.h
+ * @brief Entry/exit lanes and the barriers they drive, from LANE_TABLE
+ *
+ * A lane is one IR beam with a direction; its barrier is the servo on
+ * the lane's servoPin. Lanes that name the same servo pin share one
+ * barrier, so the default table (entry + exit on SERVO_PIN) is the
+ * classic single-gate setup, and giving every lane its own pin turns it
+ * into independent gates. Each barrier gets its own event queue set and
+ * gate task in main.cpp; lanes only meet again at the shared slot
+ * counter in parking_state.h.
+ *
+ * The table is constexpr so per-lane and per-barrier storage (queues,
+ * gate task stacks) can be sized at compile time: LANE_COUNT and
+ * LANE_BARRIER_COUNT.
+ */
+
+#ifndef LANE_H
+#define LANE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifndef LANE_MAX
+    #define LANE_MAX 4
+#endif
+
+typedef enum {
+    LANE_ENTRY = 0,
+    LANE_EXIT
+} LaneDirection;
+
+typedef struct {
+    const char *name;           // Log/LCD/metrics label (keep it short)
+    LaneDirection direction;
+    uint8_t irPin;              // Beam sensor, LOW = car present
+    uint8_t servoPin;           // Barrier servo (shared pins share a barrier)
+} LaneConfig;
+
+#ifndef IR_ENTRY_PIN
+    #define IR_ENTRY_PIN 18
+#endif
+#ifndef IR_EXIT_PIN
+    #define IR_EXIT_PIN 19
+#endif
+#ifndef SERVO_PIN
+    #define SERVO_PIN 25
+#endif
+#ifndef LANE_TABLE
+    #define LANE_TABLE { \
+        { "Entry", LANE_ENTRY, IR_ENTRY_PIN, SERVO_PIN }, \
+        { "Exit",  LANE_EXIT,  IR_EXIT_PIN,  SERVO_PIN }, \
+    }
+#endif
+
+static constexpr LaneConfig laneTable[] = LANE_TABLE;
+static constexpr int LANE_COUNT = sizeof(laneTable) / sizeof(laneTable[0]);
+
+/**
+ * @brief Distinct servo pins in the table (same grouping as lanesBegin)
+ */
+constexpr int laneTableBarrierCount() {
+    int count = 0;
+    for(int l = 0; l < LANE_COUNT; l++) {
+        bool shared = false;
+        for(int k = 0; k < l; k++) shared = shared || laneTable[k].servoPin == laneTable[l].servoPin;
+        if(!shared) count++;
+    }
+    return count;
+}
+
+static constexpr int LANE_BARRIER_COUNT = laneTableBarrierCount();
+
+static_assert(LANE_MAX <= 8, "lane bitmasks are 8 bits wide");
+static_assert(LANE_COUNT > 0, "LANE_TABLE is empty");
+static_assert(LANE_COUNT <= LANE_MAX, "LANE_TABLE has more than LANE_MAX lanes");
+
+/**
+ * @brief Group the lanes into barriers; call once before the barrier
+ *        functions
+ */
+void lanesBegin();
+
+int laneCount();
+
+const LaneConfig *laneConfig(int lane);
+
+/**
+ * @brief Lane by index or (case-insensitive) name, -1 if unknown
+ */
+int laneFind(const char *arg);
+
+/**
+ * @brief Barrier index (0..laneBarrierCount()-1) that a lane opens
+ */
+int laneBarrier(int lane);
+
+int laneBarrierCount();
+
+/**
+ * @brief Servo GPIO of a barrier
+ */
+uint8_t laneBarrierPin(int barrier);
+
+/**
+ * @brief Bit (1 << lane) for every lane a barrier serves
+ */
+uint8_t laneBarrierLanes(int barrier);
+
+#endif // LANE_H
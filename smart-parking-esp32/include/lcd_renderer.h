@@ -0,0 +1,63 @@
+/**
+ * @file lcd_renderer.h
+ * @brief Frame-buffer renderer for the 16x2 I2C LCD
+ *
+ * Callers compose a whole frame in RAM; the renderer compares it with
+ * what the display already shows and sends only the changed characters,
+ * one cursor move per run. Nothing is cleared, so the display never
+ * flickers and an unchanged frame costs no I2C traffic at all.
+ */
+
+#ifndef LCD_RENDERER_H
+#define LCD_RENDERER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifndef LCD_COLS
+    #define LCD_COLS 16
+#endif
+#ifndef LCD_ROWS
+    #define LCD_ROWS 2
+#endif
+
+class LiquidCrystal_I2C;
+
+typedef struct {
+    char cells[LCD_ROWS][LCD_COLS];     // Not NUL-terminated
+} LcdFrame;
+
+/**
+ * @brief Fill a frame with spaces
+ */
+void lcdFrameClear(LcdFrame *frame);
+
+/**
+ * @brief printf into one row, padded with spaces and cut at LCD_COLS
+ */
+void lcdFramePrintf(LcdFrame *frame, int row, const char *fmt, ...);
+
+/**
+ * @brief Find the next run of cells that differ between two frames
+ *
+ * Cells are indexed row-major. Runs separated by a single unchanged cell
+ * are merged, since rewriting it costs the same as a cursor move.
+ *
+ * @param from First cell index to look at
+ * @param len Run length (out)
+ * @return Start index of the run, or -1 if the rest is unchanged
+ */
+int lcdFrameNextRun(const LcdFrame *shown, const LcdFrame *next, int from, int *len);
+
+/**
+ * @brief Take ownership of the display; clears it once
+ */
+void lcdRendererBegin(LiquidCrystal_I2C *lcd);
+
+/**
+ * @brief Bring the display in line with a frame
+ * @return Characters sent over I2C (0 if nothing changed)
+ */
+int lcdRendererDraw(const LcdFrame *frame);
+
+#endif // LCD_RENDERER_H
@@ -0,0 +1,64 @@
+/**
+ * @file live_events.h
+ * @brief Server-Sent Events stream (/events) pushing ParkingState deltas
+ *
+ * A subscriber gets the full state once, then only the fields that
+ * changed, as soon as a writer publishes them. Browsers keep a single
+ * connection open instead of polling /data every second.
+ *
+ * Subscribers are plain socket descriptors; the web backend supplies the
+ * send/close hooks, so both HTTP engines share this code.
+ */
+
+#ifndef LIVE_EVENTS_H
+#define LIVE_EVENTS_H
+
+#include <Arduino.h>
+#include "parking_state.h"
+
+// Socket hooks provided by the web backend
+typedef struct {
+    int (*send)(int sock, const char *data, size_t len);   // Bytes sent, <0 on error
+    void (*close)(int sock);                                // Ask the backend to close
+} LiveEventsTransport;
+
+/**
+ * @brief Create the client table lock and take the initial snapshot
+ */
+void liveEventsInit(const LiveEventsTransport *transport);
+
+typedef enum {
+    LIVE_EVENTS_SUBSCRIBED = 0,
+    LIVE_EVENTS_FULL,           // All SSE_MAX_CLIENTS slots taken, nothing written
+    LIVE_EVENTS_SEND_FAILED     // Headers may be out already; close, do not reply
+} LiveEventsSubscribeResult;
+
+/**
+ * @brief Adopt an HTTP connection as an event-stream subscriber
+ *
+ * Writes the SSE response headers and a full snapshot on the socket.
+ * Only LIVE_EVENTS_FULL leaves the connection fit for an error response.
+ */
+LiveEventsSubscribeResult liveEventsSubscribe(int sock);
+
+/**
+ * @brief Forget a socket the backend has closed (no-op if not subscribed)
+ */
+void liveEventsForget(int sock);
+
+/**
+ * @brief Push the changes since the last publish to every subscriber
+ */
+void liveEventsPublish(const ParkingState *state);
+
+/**
+ * @brief Send an SSE comment to keep proxies open and drop dead clients
+ */
+void liveEventsHeartbeat();
+
+/**
+ * @brief Number of connected subscribers
+ */
+int liveEventsClientCount();
+
+#endif // LIVE_EVENTS_H
@@ -0,0 +1,71 @@
+/**
+ * @file metrics.h
+ * @brief Runtime instrumentation: tasks, queues, mutexes, gate latency
+ *
+ * Task CPU time and stack high-water marks come straight from FreeRTOS
+ * (uxTaskGetSystemState) when the scrape happens. Queues and mutexes are
+ * instrumented at the call sites through metricsQueueSend() and
+ * metricsMutexTake(), which cost one esp_timer read and a short critical
+ * section each. Everything is exported as Prometheus text on /metrics
+ * and summarised by the Telegram /diag command.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "chunk_writer.h"
+#include "lane.h"
+
+// Lane queues are METRICS_QUEUE_LANE + lane index
+typedef enum {
+    METRICS_QUEUE_LCD = 0,
+    METRICS_QUEUE_LANE,
+    METRICS_QUEUE_COUNT = METRICS_QUEUE_LANE + LANE_MAX
+} MetricsQueueId;
+
+typedef enum {
+    METRICS_MUTEX_SSE_CLIENTS = 0,
+    METRICS_MUTEX_WEB_STREAMS,
+    METRICS_MUTEX_JOURNAL,
+    METRICS_MUTEX_GATE_STATUS,
+    METRICS_MUTEX_COUNT
+} MetricsMutexId;
+
+/**
+ * @brief Create the snapshot lock; call once in setup()
+ */
+void metricsBegin();
+
+/**
+ * @brief Attach a name to a queue created in setup()
+ */
+void metricsRegisterQueue(MetricsQueueId id, const char *name, QueueHandle_t queue);
+
+/**
+ * @brief xQueueSend on a registered queue, counting drops and peak depth
+ */
+bool metricsQueueSend(MetricsQueueId id, const void *item, TickType_t wait);
+
+/**
+ * @brief xSemaphoreTake, recording how long the caller waited
+ */
+bool metricsMutexTake(MetricsMutexId id, SemaphoreHandle_t mutex, TickType_t wait);
+
+/**
+ * @brief Record sensor-edge-to-servo-command latency
+ */
+void metricsObserveGateLatency(int64_t latencyUs);
+
+/**
+ * @brief Stream every metric in Prometheus text format (version 0.0.4)
+ */
+bool metricsWritePrometheus(ChunkSink sink, void *ctx);
+
+/**
+ * @brief Short human-readable summary for Telegram /diag
+ * @return Bytes written (output is truncated to fit)
+ */
+size_t metricsFormatDiag(char *buf, size_t len);
+
+#endif // METRICS_H
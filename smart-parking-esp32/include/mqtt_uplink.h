@@ -0,0 +1,75 @@
+/**
+ * @file mqtt_uplink.h
+ * @brief Fleet telemetry over MQTT: CBOR events and state, remote commands
+ *
+ * Every lot pushes to one broker instead of being polled over HTTP.
+ * Topics live under MQTT_TOPIC_PREFIX/<device id>:
+ *
+ *   status  "online" / "offline" (retained, offline is the last will)
+ *   state   CBOR map of the parking state (retained), on change at most
+ *           every MQTT_STATE_MIN_INTERVAL_MS and every
+ *           MQTT_SUMMARY_INTERVAL_MS regardless
+ *   events  CBOR { "boot": epoch, "lost": n, "ev": [[seq, uptime s,
+ *           type, value, free], ...] }, up to MQTT_BATCH_MAX per message
+ *   cmd     subscribed, plain text: "open <lane>" (index or name),
+ *           "capacity <slots>" or "update <firmware url>" (ota_update.h)
+ *   ack     CBOR { "cmd": text, "ok": bool } for each command
+ *
+ * Events are kept in a RAM ring of MQTT_BACKLOG_SIZE while the broker is
+ * unreachable (oldest dropped first) and removed only once their batch
+ * has been written to the socket. After a reconnect the backlog drains a
+ * few batches per poll, MQTT_FLUSH_GAP_MS apart, so a long outage does
+ * not flood the link or starve command handling.
+ */
+
+#ifndef MQTT_UPLINK_H
+#define MQTT_UPLINK_H
+
+#include <Arduino.h>
+#include "system_event.h"
+
+// Remote commands, run on the MQTT task; return false to nack
+typedef struct {
+    bool (*openLane)(int lane);
+    bool (*setCapacity)(int totalSlots);
+    bool (*startUpdate)(const char *url);
+} MqttCommandHandlers;
+
+/**
+ * @brief Set up topics and the backlog; call once in setup()
+ * @return false if MQTT_BROKER_HOST is empty (uplink off, no task needed)
+ */
+bool mqttUplinkBegin(const MqttCommandHandlers *handlers);
+
+/**
+ * @brief true if the uplink was configured by mqttUplinkBegin()
+ */
+bool mqttUplinkEnabled();
+
+/**
+ * @brief Queue an event for the broker (non-blocking, any task)
+ *
+ * Stamps the uptime and the current free-slot count like journalAppend().
+ * A no-op when the uplink is off.
+ */
+void mqttUplinkRecord(EventType type, int value);
+
+bool mqttUplinkConnected();
+
+/**
+ * @brief Events waiting for the broker
+ */
+uint32_t mqttUplinkBacklog();
+
+/**
+ * @brief Events lost because the backlog was full
+ */
+uint32_t mqttUplinkDropped();
+
+/**
+ * @brief MQTT client task - connection, backlog flush, commands
+ * Runs on Core 1 (Communication)
+ */
+void mqttTask(void *parameter);
+
+#endif // MQTT_UPLINK_H
@@ -0,0 +1,97 @@
+/**
+ * @file ota_update.h
+ * @brief Signed over-the-air updates into the inactive app partition,
+ *        resumable, with trial boots and rollback
+ *
+ * The image is streamed in OTA_CHUNK_SIZE pieces straight into the app
+ * slot that is not running (app0/app1 in partitions.csv); nothing is
+ * buffered beyond one flash sector. Progress is checkpointed in NVS, so
+ * a dropped connection continues with an HTTP Range request and a reset
+ * mid-download resumes after boot. If-Range with the ETag makes sure the
+ * pieces come from the same file.
+ *
+ * Before the boot partition is switched, the slot is read back and its
+ * SHA-256 checked against <url>.sig, a signature made with the key whose
+ * public half is OTA_PUBLIC_KEY_PEM (ECDSA or RSA, as produced by
+ * `openssl dgst -sha256 -sign`). Without a key updates are refused.
+ *
+ * The new image boots on trial: it is confirmed once it has run
+ * OTA_CONFIRM_MS with WiFi up. Each build uses one rollback mechanism:
+ * - Arduino bootloader: an NVS counter boots the previous slot again
+ *   after OTA_TRIAL_BOOTS resets without confirmation.
+ * - CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE (env:esp32dev_lowpower): the
+ *   image stays PENDING_VERIFY and the bootloader rolls it back at the
+ *   first reset before confirmation, so OTA_TRIAL_BOOTS is forced to 1
+ *   and the counter only notices that it happened.
+ *
+ * Erasing and writing flash stalls code fetches on both cores, so each
+ * chunk waits (up to OTA_GATE_DEFER_MS) until every barrier is down; the
+ * task runs at the lowest priority on COMM_CORE.
+ */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+
+#define OTA_URL_MAX 160
+#define OTA_ERROR_MAX 48
+
+typedef enum {
+    OTA_IDLE = 0,
+    OTA_DOWNLOADING,
+    OTA_VERIFYING,
+    OTA_INSTALLED,              // Boot partition switched, restarting
+    OTA_FAILED
+} OtaPhase;
+
+typedef struct {
+    OtaPhase phase;
+    uint32_t imageBytes;        // Content length (0 until known)
+    uint32_t writtenBytes;      // In flash, including ranges resumed from NVS
+    uint32_t downloadedBytes;   // Received since boot
+    uint32_t resumes;           // Range requests after a dropped transfer
+    uint32_t gateDeferrals;     // Chunks held back while a barrier moved
+    uint64_t downloadUs;        // Waiting on the network
+    uint64_t flashUs;           // Erasing and writing
+    uint32_t flashMaxUs;        // Longest single chunk
+    bool pendingConfirm;        // Running a new image on trial
+    bool rolledBack;            // The last update failed its trial boots
+    char error[OTA_ERROR_MAX];
+} OtaStatus;
+
+/**
+ * @brief Count trial boots (and roll back) and reload an interrupted
+ *        download; call first thing in setup()
+ */
+void otaBegin();
+
+/**
+ * @brief true if OTA_PUBLIC_KEY_PEM is set; without it there is no OTA task
+ */
+bool otaEnabled();
+
+/**
+ * @brief Start (or resume) an update from an http(s) URL; any task
+ * @return false if no key is configured, the URL is too long, an update
+ *         is running or the running image is not confirmed yet
+ */
+bool otaStart(const char *url);
+
+/**
+ * @brief Confirm a trial image once it has proven itself; call from
+ *        wifiTask
+ */
+void otaMaintain(bool wifiConnected);
+
+void otaGetStatus(OtaStatus *out);
+
+const char *otaPhaseName(OtaPhase phase);
+
+/**
+ * @brief OTA task - waits for otaStart, then downloads and installs
+ * Runs on Core 1 (Communication), lowest priority
+ */
+void otaTask(void *parameter);
+
+#endif // OTA_UPDATE_H
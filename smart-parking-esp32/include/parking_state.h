@@ -0,0 +1,149 @@
+/**
+ * @file parking_state.h
+ * @brief Versioned snapshot of the shared parking state (seqlock)
+ *
+ * Writers on either core publish through the functions below; each
+ * publish is a short critical section that bumps a sequence counter
+ * around the update. Readers copy the whole struct without taking any
+ * lock and retry if a write overlapped, so every snapshot is consistent
+ * (slots, gate and environment all from the same moment).
+ */
+
+#ifndef PARKING_STATE_H
+#define PARKING_STATE_H
+
+#include <Arduino.h>
+#include "gate_fsm.h"
+
+#define PARKING_NODE_NAME_MAX 12    // Federated node name, including the NUL (federation.h)
+
+typedef struct {
+    uint32_t version;           // Incremented on every publish
+    int16_t totalSlots;
+    int16_t availableSlots;
+    int16_t reservedSlots;      // Of the free slots, held for reservations (reservation.h)
+    GateState gate;             // Combined state of all barriers
+    float temperature;
+    float humidity;
+    uint32_t bootEpoch;         // Local epoch at uptime 0 (0 = clock not synced), see time_service.h
+    bool wifiConnected;
+    bool internetConnected;
+    int16_t siteAvailable;      // Walk-in free slots on every federated node, this one included
+    int16_t siteTotal;          // 0 = not federated (federation.h)
+    uint8_t siteNodes;          // Nodes in the aggregate, this one included
+    char redirect[PARKING_NODE_NAME_MAX];   // Node with room while this one is full ("" = none)
+} ParkingState;
+
+/**
+ * @brief Reset the state; call once in setup() before any task starts
+ */
+void parkingStateInit(int totalSlots);
+
+/**
+ * @brief Copy a consistent snapshot (never blocks on a mutex)
+ */
+void parkingStateRead(ParkingState *out);
+
+/**
+ * @brief Current version, for cheap "has anything changed" checks
+ */
+uint32_t parkingStateVersion();
+
+// Called (outside the critical section, in the writer's task) after every publish
+typedef void (*ParkingStateListener)();
+
+#define PARKING_STATE_MAX_LISTENERS 4
+
+/**
+ * @brief Register a change callback; keep it short (e.g. a task notify)
+ * @return false if all listener slots are taken
+ */
+bool parkingStateAddListener(ParkingStateListener listener);
+
+// ============================================================================
+// Writers
+// ============================================================================
+
+/**
+ * @brief Atomically take one free slot that is not held for a reservation
+ * @param remaining Free slots after the call (may be NULL)
+ * @return false if the lot is full for walk-ins
+ */
+bool parkingStateTakeSlot(int *remaining);
+
+/**
+ * @brief Atomically take a slot for a reservation holder, using its hold
+ *
+ * Falls back to an unheld free slot if the hold was lost because the free
+ * count was overwritten below the held count (bay sensors).
+ *
+ * @param remaining Free slots after the call (may be NULL)
+ * @param usedHold Set if a hold was consumed, for
+ *        parkingStateRestoreHeldSlot() (may be NULL)
+ * @return false if the lot is full
+ */
+bool parkingStateTakeHeldSlot(int *remaining, bool *usedHold);
+
+/**
+ * @brief Give back the hold parkingStateTakeHeldSlot() consumed, when the
+ *        booking it was taken for turned out to be gone
+ *
+ * Not subject to the hold cap: it only undoes a take. The slot itself
+ * stays taken.
+ */
+void parkingStateRestoreHeldSlot();
+
+/**
+ * @brief Atomically hold one free slot for a reservation
+ * @param maxHeldPct Share of totalSlots that may be held, at least one
+ *        slot (100 = no limit)
+ * @return false if every free slot is already held or the share is used up
+ */
+bool parkingStateHoldSlot(int maxHeldPct);
+
+/**
+ * @brief Drop one hold (expired or cancelled reservation)
+ */
+void parkingStateReleaseHold();
+
+/**
+ * @brief Atomically give one slot back (clamped to totalSlots)
+ * @param remaining Free slots after the call (may be NULL)
+ */
+void parkingStateReleaseSlot(int *remaining);
+
+/**
+ * @brief Overwrite the free-slot count (clamped), e.g. from bay sensors
+ *
+ * Holds above the new count are dropped and reported to the
+ * parkingStateOnHoldsDropped() handler.
+ */
+void parkingStateSetAvailable(int available);
+
+/**
+ * @brief Change the lot capacity, keeping the number of parked cars
+ *        (free slots are clamped to 0..totalSlots, holds as above)
+ */
+void parkingStateSetTotal(int totalSlots);
+
+/**
+ * @brief Set the one handler told how many holds a clamp dropped
+ *
+ * Runs on the writer's task after the update, outside the lock, so the
+ * owner of the holds (reservation.cpp) can drop as many bookings and its
+ * store keeps matching reservedSlots.
+ */
+void parkingStateOnHoldsDropped(void (*handler)(int dropped));
+
+void parkingStatePublishGate(GateState gate);
+void parkingStatePublishEnv(float temperature, float humidity);
+void parkingStatePublishClock(uint32_t bootEpoch);
+void parkingStatePublishNetwork(bool wifiConnected, bool internetConnected);
+
+/**
+ * @brief Site-wide aggregate from the federation task
+ * @param redirect Node to send drivers to, "" for none
+ */
+void parkingStatePublishSite(int available, int total, int nodes, const char *redirect);
+
+#endif // PARKING_STATE_H
@@ -0,0 +1,38 @@
+/**
+ * @file power.h
+ * @brief Low-power mode: frequency scaling and automatic light sleep
+ *
+ * With POWER_SAVE_MODE 1 the power manager drops the CPU to
+ * POWER_MIN_FREQ_MHZ when nothing needs it and, if the framework was
+ * built with FreeRTOS tickless idle (env:esp32dev_lowpower), light-sleeps
+ * whenever every task is blocked. WiFi stays associated in modem sleep,
+ * and the IR pins are level-armed wake sources (ir_sensor.cpp).
+ *
+ * Light sleep stops the LEDC clock, so while a barrier is moving or
+ * open its gate task holds the chip awake with powerStayAwake().
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Configure the power manager and WiFi modem sleep; call once
+ *        after WiFi.begin()
+ */
+void powerBegin();
+
+/**
+ * @brief true if automatic light sleep was enabled
+ */
+bool powerLightSleepEnabled();
+
+/**
+ * @brief Hold (true) or drop (false) one no-light-sleep reference
+ *
+ * References are counted, so each caller must pair its calls.
+ */
+void powerStayAwake(bool awake);
+
+#endif // POWER_H
@@ -0,0 +1,111 @@
+/**
+ * @file reservation.h
+ * @brief Slot reservations by plate or token, held against the lot counter
+ *
+ * A reservation holds one free slot in the shared state (reservedSlots),
+ * so walk-ins are turned away before a driver with a booking is and the
+ * lot can never be oversold. Bookings may hold at most
+ * RESERVATION_MAX_HELD_PCT of the capacity, and each requester (Telegram
+ * chat, web requester) at most RESERVATION_PER_REQUESTER at a time; who
+ * may book at all is decided by the front ends (RESERVATION_CHAT_IDS,
+ * RESERVATION_API_TOKEN). Reservations are keyed by a plate, or by a
+ * six-character token issued when no plate is given, in a fixed-size
+ * open-addressing hash table; expiry runs off a timer wheel with
+ * RESERVATION_WHEEL_TICK_S resolution, so neither lookups nor expiry
+ * ever scan the whole store.
+ *
+ * At the gate the driver checks in with the code (Telegram /arrive or
+ * POST /reserve?arrive=); that marks the lane. The gate task then needs
+ * one array read per entry event (reservationWaiting) to tell the booked
+ * car from a walk-in, and consumes the booking (reservationClaim) only
+ * once the car has its slot. A car already waiting in the beam is let in
+ * at once.
+ */
+
+#ifndef RESERVATION_H
+#define RESERVATION_H
+
+#include <Arduino.h>
+
+#define RESERVATION_CODE_MAX 12     // Plate or token, normalised, incl. NUL
+
+typedef enum {
+    RESERVE_OK = 0,
+    RESERVE_FULL,               // Every free slot is already taken or held
+    RESERVE_HELD_LIMIT,         // Bookings hold RESERVATION_MAX_HELD_PCT already
+    RESERVE_REQUESTER_LIMIT,    // RESERVATION_PER_REQUESTER open for this requester
+    RESERVE_UNAUTHORIZED,       // Front end refused the caller
+    RESERVE_TABLE_FULL,         // RESERVATION_MAX open reservations
+    RESERVE_DUPLICATE,          // That plate already has one
+    RESERVE_INVALID,            // Bad code, duration or lane
+    RESERVE_NOT_FOUND
+} ReserveResult;
+
+typedef struct {
+    char code[RESERVATION_CODE_MAX];
+    uint32_t expiresInSec;
+} ReservationInfo;
+
+typedef struct {
+    uint32_t created;
+    uint32_t arrived;           // Claimed at the gate
+    uint32_t expired;
+    uint32_t cancelled;
+    uint32_t revoked;           // Dropped because the free count fell below the holds
+    uint32_t refused;           // Any create that did not return RESERVE_OK
+} ReservationCounters;
+
+/**
+ * @brief Reset the store; call once in setup() before any task starts
+ * @param onArrival Runs on the caller's task after a check-in; should
+ *        wake the lane's gate task (EVENT_RESERVED_ARRIVAL)
+ */
+void reservationBegin(void (*onArrival)(int lane));
+
+/**
+ * @brief Book a slot for holdMin minutes (0 = RESERVATION_HOLD_MIN)
+ * @param plate Plate to key it on, or NULL/"" to be issued a token
+ * @param requester Who asks, already authorised by the caller (e.g.
+ *        "tg:<chat id>"); counted against RESERVATION_PER_REQUESTER
+ * @param out Code to check in with and time left (may be NULL)
+ */
+ReserveResult reservationCreate(const char *plate, uint32_t holdMin, const char *requester, ReservationInfo *out);
+
+/**
+ * @brief Drop a reservation and give its slot back to walk-ins
+ */
+ReserveResult reservationCancel(const char *code);
+
+/**
+ * @brief Driver is at a lane's barrier; the next entry there is theirs
+ */
+ReserveResult reservationArrive(const char *code, int lane);
+
+/**
+ * @brief Gate task, on every entry event: has a reservation checked in
+ *        at this lane? (one array read, nothing is consumed)
+ */
+bool reservationWaiting(int lane);
+
+/**
+ * @brief Gate task, once the held slot is taken: consume the reservation
+ *        that checked in at this lane (O(1), one short critical section)
+ * @return false if it was cancelled or expired since reservationWaiting()
+ */
+bool reservationClaim(int lane);
+
+/**
+ * @brief Advance the expiry wheel; call from wifiTask
+ */
+void reservationMaintain();
+
+/**
+ * @brief Open reservations
+ */
+int reservationActive();
+
+void reservationGetCounters(ReservationCounters *out);
+
+const char *reservationResultName(ReserveResult result);
+
+#endif // RESERVATION_H
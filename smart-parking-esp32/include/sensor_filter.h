@@ -0,0 +1,38 @@
+/**
+ * @file sensor_filter.h
+ * @brief Median-gated EMA for slow, noisy scalar sensors (DHT22)
+ *
+ * Each raw sample goes into a short window; a sample further than
+ * outlierDelta from the window median is rejected, everything else
+ * feeds an exponential moving average. Rejected samples still enter the
+ * window, so a real step change is accepted once it holds for most of
+ * the window instead of being rejected forever.
+ */
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SENSOR_FILTER_WINDOW 5
+
+typedef struct {
+    float window[SENSOR_FILTER_WINDOW];
+    uint8_t count;          // Samples in the window (up to SENSOR_FILTER_WINDOW)
+    uint8_t next;           // Slot for the next sample
+    float alpha;            // EMA weight of a new sample
+    float outlierDelta;     // Largest accepted distance from the median
+    float value;            // Filtered value (valid once count > 0)
+    uint32_t rejected;
+} SensorFilter;
+
+void sensorFilterInit(SensorFilter *filter, float alpha, float outlierDelta);
+
+/**
+ * @brief Add a raw sample
+ * @return false if it was rejected as an outlier (value unchanged)
+ */
+bool sensorFilterAdd(SensorFilter *filter, float sample);
+
+#endif // SENSOR_FILTER_H
@@ -0,0 +1,45 @@
+/**
+ * @file servo_motion.h
+ * @brief Ramped barrier servo motion on LEDC PWM
+ *
+ * Each servo gets its own LEDC channel (50 Hz, 16-bit duty), so the pulse
+ * train is generated in hardware. A 10 ms esp_timer walks the commanded
+ * angle along a trapezoidal velocity profile (SERVO_MAX_SPEED_DPS,
+ * SERVO_ACCEL_DPS2) and only runs while a servo is moving. Moves can be
+ * retargeted mid-swing; the profile decelerates and reverses smoothly.
+ */
+
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include <Arduino.h>
+
+typedef struct {
+    int8_t channel;         // LEDC channel, -1 = not attached
+    float position;         // Commanded angle (deg)
+    float velocity;         // deg/s, signed
+    float target;
+} ServoMotion;
+
+/**
+ * @brief Attach a servo to a GPIO and park it at startAngle (no ramp)
+ * @return false if LEDC could not be configured
+ */
+bool servoMotionAttach(ServoMotion *servo, int pin, uint8_t channel, float startAngle);
+
+/**
+ * @brief Start a ramped move; safe to call while a move is in progress
+ */
+void servoMotionMoveTo(ServoMotion *servo, float angle);
+
+/**
+ * @brief true while the servo has not reached its target
+ */
+bool servoMotionBusy(const ServoMotion *servo);
+
+/**
+ * @brief Duration of a move of the given size from rest to rest
+ */
+uint32_t servoMotionTravelMs(float degrees);
+
+#endif // SERVO_MOTION_H
@@ -0,0 +1,64 @@
+/**
+ * @file slot_map.h
+ * @brief Per-bay occupancy bitmap with scan-to-scan debounce
+ *
+ * Two bits per bay: the last raw scan and the debounced state. A bay
+ * changes state only after two consecutive scans agree, and the update is
+ * done 32 bays at a time with word operations, so 512 bays cost 128 bytes
+ * and a few hundred cycles per scan.
+ *
+ * Bit k of word k / 32 is bay k (1 = occupied).
+ */
+
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <Arduino.h>
+
+#define SLOT_MAP_MAX 512
+#define SLOT_MAP_WORDS ((SLOT_MAP_MAX + 31) / 32)
+
+// {"total":N,"occupied":N,"free":N,"bitmap":"<hex>"} plus NUL
+#define SLOT_JSON_MAX (64 + SLOT_MAP_WORDS * 8)
+
+/**
+ * @brief Reset to `count` free bays (clamped to SLOT_MAP_MAX)
+ */
+void slotMapInit(int count);
+
+/**
+ * @brief Accept a scan as-is, without debounce (first scan at boot)
+ */
+void slotMapPrime(const uint32_t *scan);
+
+/**
+ * @brief Feed one raw scan (SLOT_MAP_WORDS words)
+ * @return Number of bays whose debounced state changed
+ */
+int slotMapUpdate(const uint32_t *scan);
+
+int slotMapCount();
+int slotMapOccupiedCount();
+bool slotMapOccupied(int slot);
+
+/**
+ * @brief Lowest-numbered free bay, or -1 if all are taken
+ */
+int slotMapFirstFree();
+
+/**
+ * @brief Copy the debounced bitmap (SLOT_MAP_WORDS words)
+ */
+void slotMapCopy(uint32_t *words);
+
+/**
+ * @brief Serialize for /slots
+ *
+ * "bitmap" is one hex byte per 8 bays in bay order; bay k is bit k % 8
+ * of byte k / 8.
+ *
+ * @return Bytes written, or 0 if the buffer is too small
+ */
+size_t slotMapToJson(char *buf, size_t len);
+
+#endif // SLOT_MAP_H
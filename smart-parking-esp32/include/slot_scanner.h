@@ -0,0 +1,46 @@
+/**
+ * @file slot_scanner.h
+ * @brief Batched scan of per-bay presence sensors behind expanders
+ *
+ * Backends (SLOT_SENSOR_TYPE):
+ * - SLOT_SENSOR_NONE: no bay sensors, the gate counter is the only source
+ * - SLOT_SENSOR_SHIFT_REGISTER: chain of 74HC165 read in a single SPI
+ *   transfer per cycle (8 bays per chip, up to SLOT_MAP_MAX bays)
+ * - SLOT_SENSOR_MCP23017: up to 7 MCP23017 on the LCD's I2C bus (the LCD
+ *   sits at 0x27), one 2-byte read per chip, 16 bays each
+ *
+ * The scan task debounces into slot_map and reconciles the gate counter
+ * with the bitmap when the two disagree for longer than a car needs to
+ * drive from the gate to its bay.
+ */
+
+#ifndef SLOT_SCANNER_H
+#define SLOT_SCANNER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define SLOT_SENSOR_NONE 0
+#define SLOT_SENSOR_SHIFT_REGISTER 1
+#define SLOT_SENSOR_MCP23017 2
+
+#ifndef SLOT_SENSOR_TYPE
+    #define SLOT_SENSOR_TYPE SLOT_SENSOR_NONE
+#endif
+
+/**
+ * @brief Set up the expander bus and seed slot_map from a first scan
+ *
+ * With sensors present the gate counter starts from the real occupancy
+ * instead of "all free". Call after parkingStateInit() and, for the
+ * MCP23017 backend, after Wire.begin().
+ */
+void slotScannerBegin();
+
+/**
+ * @brief Periodic scan, debounce and counter reconciliation
+ * Runs on Core 0 (Hardware)
+ */
+void slotScanTask(void *parameter);
+
+#endif // SLOT_SCANNER_H
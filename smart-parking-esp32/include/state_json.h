@@ -0,0 +1,44 @@
+/**
+ * @file state_json.h
+ * @brief Zero-allocation JSON serializer for ParkingState
+ *
+ * Writes straight into a caller-supplied buffer with snprintf, so the
+ * /data path does not touch the heap.
+ */
+
+#ifndef STATE_JSON_H
+#define STATE_JSON_H
+
+#include "parking_state.h"
+#include "forecast.h"
+
+// Worst-case size of the /data object, including the terminating NUL
+#define STATE_JSON_MAX 416
+
+/**
+ * @brief Serialize a snapshot as the /data JSON object
+ *
+ * "time" and "date" are formatted from bootEpoch + uptimeSec. With a
+ * forecast, "fullInMin" is the expected minutes until no walk-in slot is
+ * left (null if not expected within the horizon or still learning) and
+ * "forecastReady" tells the two apart. On a federated node (siteTotal >
+ * 0) "siteAvailable", "siteTotal", "siteNodes" and "redirect" (a node
+ * name or null) are added.
+ *
+ * @param forecast May be NULL (keys left out)
+ * @return Bytes written (excluding NUL), or 0 if the buffer is too small
+ */
+size_t stateToJson(const ParkingState *state, uint32_t uptimeSec, const ForecastResult *forecast, char *buf, size_t len);
+
+/**
+ * @brief Serialize only the fields that differ between two snapshots
+ *
+ * Uses the same keys as stateToJson so clients can merge a delta into
+ * the object they already hold.
+ *
+ * @param prev Last snapshot sent to the client
+ * @return Bytes written, or 0 if nothing changed or the buffer is too small
+ */
+size_t stateDeltaToJson(const ParkingState *prev, const ParkingState *cur, char *buf, size_t len);
+
+#endif // STATE_JSON_H
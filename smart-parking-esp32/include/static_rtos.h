@@ -0,0 +1,82 @@
+/**
+ * @file static_rtos.h
+ * @brief Statically allocated FreeRTOS tasks and queues
+ *
+ * Stacks, TCBs and queue storage are reserved at link time (.bss), so
+ * starting them makes no heap allocation, their RAM is part of the
+ * build's memory report, and a bad stack size or priority is a compile
+ * error instead of a boot-time failure.
+ *
+ * ESP-IDF counts stacks in bytes (StackType_t is uint8_t), so StackBytes
+ * is both the config.h value and the array length.
+ */
+
+#ifndef STATIC_RTOS_H
+#define STATIC_RTOS_H
+
+#include <Arduino.h>
+
+#define STATIC_TASK_MIN_STACK 2048      // Anything calling Serial.printf needs this much
+
+template<uint32_t StackBytes, UBaseType_t Priority, BaseType_t Core>
+class StaticTask {
+    static_assert(StackBytes >= STATIC_TASK_MIN_STACK, "task stack below STATIC_TASK_MIN_STACK");
+    static_assert(StackBytes % sizeof(StackType_t) == 0, "task stack is not a whole number of StackType_t");
+    static_assert(Priority > tskIDLE_PRIORITY && Priority < configMAX_PRIORITIES, "task priority out of range");
+    static_assert(Core >= 0 && Core < portNUM_PROCESSORS, "no such core");
+
+public:
+    static constexpr uint32_t stackBytes = StackBytes;
+    static constexpr UBaseType_t priority = Priority;
+
+    /**
+     * @brief Create the task; call at most once per object
+     */
+    TaskHandle_t start(TaskFunction_t function, const char *name, void *parameter = NULL) {
+        return xTaskCreateStaticPinnedToCore(function, name, sizeof(stack) / sizeof(stack[0]),
+                                             parameter, Priority, stack, &tcb, Core);
+    }
+
+private:
+    StackType_t stack[StackBytes / sizeof(StackType_t)];
+    StaticTask_t tcb;
+};
+
+/**
+ * @brief StaticTask for a feature that config.h can leave out
+ *
+ * Disabled, it reserves no stack or TCB and start() creates nothing, so
+ * a task nobody configured costs no .bss.
+ */
+template<bool Enabled, uint32_t StackBytes, UBaseType_t Priority, BaseType_t Core>
+class OptionalStaticTask : public StaticTask<StackBytes, Priority, Core> {};
+
+template<uint32_t StackBytes, UBaseType_t Priority, BaseType_t Core>
+class OptionalStaticTask<false, StackBytes, Priority, Core> {
+public:
+    static constexpr uint32_t stackBytes = 0;
+    static constexpr UBaseType_t priority = Priority;
+
+    TaskHandle_t start(TaskFunction_t, const char *, void * = NULL) {
+        return NULL;
+    }
+};
+
+template<typename T, UBaseType_t Length>
+class StaticQueue {
+    static_assert(Length > 0, "queue needs at least one slot");
+
+public:
+    /**
+     * @brief Create the queue; call at most once per object
+     */
+    QueueHandle_t create() {
+        return xQueueCreateStatic(Length, sizeof(T), storage, &control);
+    }
+
+private:
+    uint8_t storage[Length * sizeof(T)];
+    StaticQueue_t control;
+};
+
+#endif // STATIC_RTOS_H
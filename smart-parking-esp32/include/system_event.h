@@ -0,0 +1,32 @@
+/**
+ * @file system_event.h
+ * @brief Event types shared by the gate queues and the flash journal
+ */
+
+#ifndef SYSTEM_EVENT_H
+#define SYSTEM_EVENT_H
+
+#include <Arduino.h>
+
+typedef enum {
+    EVENT_CAR_ENTRY,
+    EVENT_CAR_EXIT,
+    EVENT_GATE_OPEN,
+    EVENT_GATE_CLOSE,
+    EVENT_PARKING_FULL,
+    EVENT_COUNT_CORRECTED,      // Free-slot count overwritten (bay sensors)
+    EVENT_BEAM_CLEAR,           // Car left the IR beam (gate queues only, not journaled)
+    EVENT_REMOTE_OPEN,          // Open without a car, e.g. MQTT "open" (gate queues only)
+    EVENT_RESERVED_ARRIVAL      // A reservation checked in at this lane (gate queues only)
+} EventType;
+
+typedef struct {
+    EventType type;
+    int value;                  // Lane index on the gate queues
+    uint32_t seq;               // traceNextSeq() for traced car events, 0 otherwise
+    int64_t detectedUs;         // esp_timer_get_time() at the sensor edge
+    int64_t queuedUs;           // ...just before the queue send
+    int64_t dequeuedUs;         // ...when the gate task received it
+} SystemEvent;
+
+#endif // SYSTEM_EVENT_H
@@ -0,0 +1,23 @@
+/**
+ * @file telegram_commands.h
+ * @brief Telegram bot commands: sorted dispatch table and reply templates
+ *
+ * Commands are looked up by binary search in a static table sorted by
+ * name (checked at compile time). Each reply is formatted from a fixed
+ * template into one static buffer and queued on the outbox, so a command
+ * costs no String building and no heap allocation. "/status@BotName",
+ * the form Telegram uses in groups, matches "/status".
+ */
+
+#ifndef TELEGRAM_COMMANDS_H
+#define TELEGRAM_COMMANDS_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Run one incoming message and queue the reply; call from
+ *        telegramTask
+ */
+void telegramHandleCommand(const char *chatId, const char *text);
+
+#endif // TELEGRAM_COMMANDS_H
@@ -0,0 +1,91 @@
+/**
+ * @file telegram_outbox.h
+ * @brief Outbound Telegram queue with batching, rate limiting and
+ *        alert subscriptions
+ *
+ * Replies and alerts are queued without blocking and sent by a dedicated
+ * task over its own persistent TLS session, so a slow sendMessage never
+ * holds up command polling and alerts go out as soon as they happen.
+ *
+ * Chats subscribe to alert topics with /subscribe; the list (up to
+ * TELEGRAM_MAX_SUBSCRIBERS) is kept in NVS. An alert is formatted and
+ * queued once and fanned out by the sender to TELEGRAM_ALERT_CHAT_ID and
+ * every chat subscribed to its topic.
+ */
+
+#ifndef TELEGRAM_OUTBOX_H
+#define TELEGRAM_OUTBOX_H
+
+#include <Arduino.h>
+
+// Alert topics, combined as a bit mask per subscriber
+typedef enum {
+    TELEGRAM_TOPIC_FULL = 1 << 0,       // Lot full for walk-ins
+    TELEGRAM_TOPIC_FREED = 1 << 1,      // First slot free again after full
+    TELEGRAM_TOPIC_SYSTEM = 1 << 2,     // Device health (heap, ...)
+    TELEGRAM_TOPIC_ALL = 0x07
+} TelegramTopic;
+
+/**
+ * @brief Create the queue, load the subscribers and configure the
+ *        sending TLS client
+ */
+void telegramOutboxBegin();
+
+/**
+ * @brief Queue a Markdown message (never blocks)
+ *
+ * Text longer than TELEGRAM_MSG_MAX is truncated.
+ *
+ * @return false if the outbox is full and the message was dropped
+ */
+bool telegramSend(const char *chatId, const char *text);
+
+/**
+ * @brief Queue an alert for TELEGRAM_ALERT_CHAT_ID and the topic's
+ *        subscribers (never blocks; one queue entry however many chats)
+ * @return false if nobody would receive it or the outbox is full
+ */
+bool telegramAlert(TelegramTopic topic, const char *text);
+
+/**
+ * @brief Add topics to a chat's subscription (persisted)
+ * @return false if the subscriber list is full
+ */
+bool telegramSubscribe(const char *chatId, uint8_t topics);
+
+/**
+ * @brief Remove topics from a chat's subscription (persisted); a chat
+ *        left with none is dropped
+ */
+void telegramUnsubscribe(const char *chatId, uint8_t topics);
+
+/**
+ * @brief Topics a chat is subscribed to (0 = none)
+ */
+uint8_t telegramSubscription(const char *chatId);
+
+int telegramSubscriberCount();
+
+/**
+ * @brief Topic mask from a name: "full", "freed", "system" or "all"
+ * @return 0 if unknown
+ */
+uint8_t telegramTopicFromName(const char *name);
+
+/**
+ * @brief Messages dropped because the outbox was full
+ */
+uint32_t telegramOutboxDropped();
+
+/**
+ * @brief Telegram send task - drains the outbox
+ * Runs on Core 1 (Communication)
+ *
+ * Waits for a token from the rate limiter, then merges every queued
+ * message for the same chat (or the same alert topic) into one
+ * sendMessage call per recipient.
+ */
+void telegramSendTask(void *parameter);
+
+#endif // TELEGRAM_OUTBOX_H
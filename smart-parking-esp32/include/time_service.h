@@ -0,0 +1,65 @@
+/**
+ * @file time_service.h
+ * @brief Local timekeeping: occasional network sync, on-demand formatting
+ *
+ * SNTP re-syncs every TIME_SYNC_INTERVAL_MS in the background; between
+ * syncs the time is the last synced epoch plus the esp_timer offset, so
+ * reading the clock never touches the network. If SNTP has not answered
+ * the time API is queried with a single HTTPS request.
+ *
+ * All epochs here are local wall-clock seconds (UTC plus GMT_OFFSET_SEC
+ * and DAYLIGHT_OFFSET_SEC), so formatting needs no TZ database.
+ */
+
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+
+#define TIME_TEXT_LEN 9     // "HH:MM:SS"
+#define DATE_TEXT_LEN 11    // "YYYY/MM/DD"
+
+/**
+ * @brief Start SNTP; call once after WiFi.begin()
+ */
+void timeServiceBegin();
+
+/**
+ * @brief Run the API fallback when SNTP is late; call from wifiTask
+ *
+ * Returns immediately unless a fallback is due, in which case it blocks
+ * for at most one HTTPS request.
+ */
+void timeServiceMaintain(bool wifiConnected);
+
+/**
+ * @brief true once any sync has succeeded
+ */
+bool timeServiceValid();
+
+/**
+ * @brief Local epoch seconds now (0 if never synced)
+ */
+uint32_t timeServiceNow();
+
+/**
+ * @brief Local epoch at esp_timer zero, i.e. now() - uptime (0 if never synced)
+ *
+ * Changes only when a sync corrects the clock, so it can be published
+ * with the parking state and clients can count seconds themselves.
+ */
+uint32_t timeServiceBootEpoch();
+
+/**
+ * @brief Milliseconds until the next whole second (for tick-aligned redraws)
+ */
+uint32_t timeServiceMsToNextSecond();
+
+/**
+ * @brief Format a local epoch; 0 gives "--:--:--" and "----/--/--"
+ * @param timeText TIME_TEXT_LEN bytes (may be NULL)
+ * @param dateText DATE_TEXT_LEN bytes (may be NULL)
+ */
+void timeFormatEpoch(uint32_t localEpoch, char *timeText, char *dateText);
+
+#endif // TIME_SERVICE_H
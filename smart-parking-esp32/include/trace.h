@@ -0,0 +1,51 @@
+/**
+ * @file trace.h
+ * @brief Per-event latency trace from IR edge to servo command
+ *
+ * Every car event gets a sequence number and is timestamped (esp_timer,
+ * microseconds) at four points: the sensor edge, the queue send, the
+ * gate task's receive and the servo write. When the gate task finishes
+ * with an event it appends one record to a fixed ring. Each gate task
+ * claims its slot with an atomic increment, so appends never block;
+ * readers validate each slot with a per-slot stamp and skip records that
+ * were unfinished or overwritten while copying.
+ *
+ * The ring is dumped as CSV with a p50/p99 summary on GET /trace, or on
+ * the serial console by sending 't'.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "system_event.h"
+#include "chunk_writer.h"
+
+typedef enum {
+    TRACE_OPENED,       // Barrier commanded open
+    TRACE_HELD,         // Barrier already open; its hold time was extended
+    TRACE_DENIED        // Lot full, barrier untouched
+} TraceOutcome;
+
+/**
+ * @brief Create the reader lock; call once in setup()
+ */
+void traceBegin();
+
+/**
+ * @brief Next event sequence number (gaps = events dropped before the gate)
+ */
+uint32_t traceNextSeq();
+
+/**
+ * @brief Append the finished event (gate tasks only)
+ * @param actuatedUs Time of the servo write, 0 if none happened
+ */
+void traceRecord(const SystemEvent *event, int64_t actuatedUs, TraceOutcome outcome);
+
+/**
+ * @brief Stream the ring as CSV, oldest first, with a latency summary
+ */
+bool traceWrite(ChunkSink sink, void *ctx);
+
+#endif // TRACE_H
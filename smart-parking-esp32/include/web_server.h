@@ -0,0 +1,36 @@
+/**
+ * @file web_server.h
+ * @brief HTTP dashboard server: routes /, /data, /slots, /history, /metrics, /trace and /events
+ *
+ * Two interchangeable engines, chosen at build time:
+ * - WEB_ASYNC_BACKEND 0: Arduino WebServer, polled by webServerTask
+ * - WEB_ASYNC_BACKEND 1: ESP-IDF esp_http_server, event-driven in its own
+ *   task with keep-alive and concurrent connections (env:esp32dev_async)
+ */
+
+#ifndef WEB_SERVER_H
+#define WEB_SERVER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifndef WEB_ASYNC_BACKEND
+    #define WEB_ASYNC_BACKEND 0
+#endif
+
+/**
+ * @brief Register the routes and start listening
+ *
+ * Also wires the /events stream to this backend's sockets.
+ */
+void webServerBegin();
+
+#if !WEB_ASYNC_BACKEND
+/**
+ * @brief Web server task (synchronous backend only)
+ * Runs on Core 1 (Communication)
+ */
+void webServerTask(void *parameter);
+#endif
+
+#endif // WEB_SERVER_H
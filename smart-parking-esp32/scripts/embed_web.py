@@ -0,0 +1,54 @@
+"""
+PlatformIO pre-build step: gzip web/index.html into include/dashboard_html.h
+
+The dashboard is served straight from flash with Content-Encoding: gzip,
+so the page is compressed once here instead of on every request. The ETag
+is derived from the page contents and changes whenever the page does.
+
+Also runnable by hand: python scripts/embed_web.py
+"""
+
+import gzip
+import hashlib
+import os
+
+SOURCE = os.path.join("web", "index.html")
+TARGET = os.path.join("include", "dashboard_html.h")
+
+
+def embed(project_dir):
+    src = os.path.join(project_dir, SOURCE)
+    dst = os.path.join(project_dir, TARGET)
+
+    if os.path.exists(dst) and os.path.getmtime(dst) >= os.path.getmtime(src):
+        return
+
+    with open(src, "rb") as f:
+        html = f.read()
+
+    # mtime=0 keeps the output (and the ETag) reproducible between builds
+    packed = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(html).hexdigest()[:16]
+
+    lines = []
+    for i in range(0, len(packed), 16):
+        chunk = packed[i:i + 16]
+        lines.append("    " + ", ".join("0x%02x" % b for b in chunk) + ",")
+
+    with open(dst, "w") as f:
+        f.write("// Generated by scripts/embed_web.py from %s - do not edit\n" % SOURCE.replace(os.sep, "/"))
+        f.write("#ifndef DASHBOARD_HTML_H\n#define DASHBOARD_HTML_H\n\n#include <Arduino.h>\n\n")
+        f.write("#define DASHBOARD_ETAG \"\\\"%s\\\"\"\n\n" % etag)
+        f.write("const size_t DASHBOARD_HTML_GZ_LEN = %d;  // %d bytes uncompressed\n\n" % (len(packed), len(html)))
+        f.write("const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {\n")
+        f.write("\n".join(lines))
+        f.write("\n};\n\n#endif // DASHBOARD_HTML_H\n")
+
+    print("[embed_web] %s: %d -> %d bytes (gzip), ETag %s" % (SOURCE, len(html), len(packed), etag))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    embed(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    embed(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -0,0 +1,529 @@
+/**
+ * @file bench.cpp
+ * @brief Host benchmark: replays synthetic traffic through the firmware's
+ *        sensor -> queue -> gate pipeline and times the /data serializer
+ *
+ * Build and run (PlatformIO):
+ *   pio run -e native && .pio/build/native/program [serviceUs] [fixed]
+ *
+ * The real lane, ir_sensor, gate_flow, gate_fsm, parking_state,
+ * state_json and trace code is linked against sim/shim, with lanes and
+ * barriers taken from LANE_TABLE. Simulated time is event-driven: GPIO edges fire the ISR,
+ * the "sensor task" runs when notified or when a debounce window expires,
+ * and each barrier's "gate task" takes one event at a time and is busy
+ * for serviceUs per event (servo write, journal append, LCD queue on the
+ * device). Host wall time is measured separately and reported per
+ * event, so two builds can be compared on the same machine. "fixed"
+ * ignores beam-clear events, i.e. every cycle waits out GATE_OPEN_TIME_MS.
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <new>
+#include "config.h"
+#include "ir_sensor.h"
+#include "gate_fsm.h"
+#include "gate_flow.h"
+#include "parking_state.h"
+#include "state_json.h"
+#include "system_event.h"
+#include "trace.h"
+#include "servo_motion.h"
+#include "time_service.h"
+#include "lane.h"
+
+#define SIM_DEFAULT_SERVICE_US 300
+#define SIM_DATA_ITERATIONS 200000
+
+// ============================================================================
+// Allocation Counting
+// ============================================================================
+static volatile uint64_t allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+#ifdef __GLIBC__
+// Also catch C allocations (snprintf internals, strdup...) on glibc hosts
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *malloc(size_t size) { allocations++; return __libc_malloc(size); }
+extern "C" void *calloc(size_t count, size_t size) { allocations++; return __libc_calloc(count, size); }
+#endif
+
+// ============================================================================
+// Traffic Generation
+// ============================================================================
+
+typedef struct {
+    int64_t atUs;
+    uint8_t pin;
+    uint8_t level;
+} SimEdge;
+
+typedef struct {
+    const char *name;
+    std::vector<SimEdge> edges;
+    uint32_t cars;
+} Scenario;
+
+static uint32_t rngState = 0x2545F491;
+
+static uint32_t rngNext() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static int64_t rngRange(int64_t lo, int64_t hi) {
+    return lo + (int64_t)(rngNext() % (uint32_t)(hi - lo + 1));
+}
+
+// Exponential inter-arrival time with the given mean
+static int64_t rngExpUs(int64_t meanUs) {
+    double u = (rngNext() + 1.0) / 4294967297.0;
+    return (int64_t)(-log(u) * meanUs);
+}
+
+/**
+ * @brief One car breaking a beam, with optional contact bounce on both edges
+ */
+static void addBeamBreak(Scenario *s, uint8_t pin, int64_t atUs, int64_t blockUs, int bounces) {
+    s->edges.push_back({ atUs, pin, LOW });
+    int64_t t = atUs;
+    for(int b = 0; b < bounces; b++) {
+        t += rngRange(100, 400);
+        s->edges.push_back({ t, pin, HIGH });
+        t += rngRange(100, 400);
+        s->edges.push_back({ t, pin, LOW });
+    }
+
+    int64_t clearUs = atUs + blockUs;
+    s->edges.push_back({ clearUs, pin, HIGH });
+    t = clearUs;
+    for(int b = 0; b < bounces; b++) {
+        t += rngRange(100, 400);
+        s->edges.push_back({ t, pin, LOW });
+        t += rngRange(100, 400);
+        s->edges.push_back({ t, pin, HIGH });
+    }
+    s->cars++;
+}
+
+static void sortEdges(Scenario *s) {
+    std::stable_sort(s->edges.begin(), s->edges.end(),
+                     [](const SimEdge &a, const SimEdge &b) { return a.atUs < b.atUs; });
+}
+
+/**
+ * @brief IR pins of every lane in one direction
+ * @return Number of pins written
+ */
+static int lanePins(LaneDirection direction, uint8_t *pins) {
+    int count = 0;
+    for(int l = 0; l < laneCount(); l++) {
+        if(laneConfig(l)->direction == direction) pins[count++] = laneConfig(l)->irPin;
+    }
+    return count;
+}
+
+/**
+ * @brief Poisson arrivals on every lane; a lane's next car never arrives
+ *        before the previous one has cleared the beam
+ */
+static Scenario makePoisson(const char *name, int bouncesMin, int bouncesMax) {
+    Scenario s = { name, {}, 0 };
+    int64_t next[LANE_MAX];
+
+    for(int lane = 0; lane < laneCount(); lane++) next[lane] = 1000000 + 4000000 * lane;
+    for(int i = 0; i < 500; i++) {
+        for(int lane = 0; lane < laneCount(); lane++) {
+            int64_t blockUs = rngRange(400000, 900000);
+            addBeamBreak(&s, laneConfig(lane)->irPin, next[lane], blockUs, (int)rngRange(bouncesMin, bouncesMax));
+            next[lane] += blockUs + 200000 + rngExpUs(20000000);
+        }
+    }
+    sortEdges(&s);
+    return s;
+}
+
+// Platoons of cars a second apart, larger than the lot, dealt round-robin
+// over the lanes of each direction
+static Scenario makeBursty() {
+    Scenario s = { "bursty", {}, 0 };
+    uint8_t entryPins[LANE_MAX], exitPins[LANE_MAX];
+    int entries = lanePins(LANE_ENTRY, entryPins);
+    int exits = lanePins(LANE_EXIT, exitPins);
+    int64_t t = 1000000;
+
+    for(int p = 0; p < 100; p++) {
+        int64_t car = t;
+        for(int i = 0; entries > 0 && i < 8; i++) {
+            addBeamBreak(&s, entryPins[i % entries], car, rngRange(300000, 600000), 0);
+            if(i % entries == entries - 1) car += rngRange(800000, 1500000);
+        }
+        car = t + 30000000;
+        for(int i = 0; exits > 0 && i < 8; i++) {
+            addBeamBreak(&s, exitPins[i % exits], car, rngRange(300000, 600000), 0);
+            if(i % exits == exits - 1) car += rngRange(800000, 1500000);
+        }
+        t += 60000000;
+    }
+    sortEdges(&s);
+    return s;
+}
+
+// Every beam broken in the same microsecond
+static Scenario makeSimultaneous() {
+    Scenario s = { "simultaneous", {}, 0 };
+    int64_t t = 1000000;
+    for(int i = 0; i < 500; i++) {
+        for(int lane = 0; lane < laneCount(); lane++) addBeamBreak(&s, laneConfig(lane)->irPin, t, 500000, 0);
+        t += 5000000;
+    }
+    sortEdges(&s);
+    return s;
+}
+
+// Every lane firing just outside the debounce window: stresses the queues
+static Scenario makeFlood() {
+    Scenario s = { "flood", {}, 0 };
+    int64_t t = 1000000;
+    for(int i = 0; i < 2000; i++) {
+        for(int lane = 0; lane < laneCount(); lane++) {
+            addBeamBreak(&s, laneConfig(lane)->irPin, t + 100 * lane, IR_DEBOUNCE_US + 500, 0);
+        }
+        t += 2 * IR_DEBOUNCE_US + 1000;
+    }
+    sortEdges(&s);
+    return s;
+}
+
+// ============================================================================
+// Pipeline (mirrors sensorTask / gateTask, entry/exit path from gate_flow)
+// ============================================================================
+
+typedef struct {
+    uint32_t detected;
+    uint32_t queueDrops;
+    uint32_t opened;
+    uint32_t held;
+    uint32_t denied;
+    uint32_t cycles;            // Barrier open -> closed again
+    uint64_t cycleMsSum;
+    uint32_t maxDepth[LANE_MAX];
+    double depthUsSum[LANE_MAX];        // Integral of queue depth over simulated time
+    int64_t depthSinceUs[LANE_MAX];
+    std::vector<uint32_t> latencyUs;    // Edge -> gate decision (servo write if opened)
+} RunStats;
+
+static QueueHandle_t queues[LANE_MAX];
+static bool inCycle[LANE_MAX];              // Opened since it was last idle
+static uint32_t cycleStartMs[LANE_MAX];
+static int64_t gateBusyUntilUs[LANE_MAX];   // One gate task per barrier
+static bool earlyClose = true;
+
+// Call before a queue's depth changes
+static void accountDepth(int lane, RunStats *stats) {
+    stats->depthUsSum[lane] += (double)uxQueueMessagesWaiting(queues[lane]) * (simNowUs - stats->depthSinceUs[lane]);
+    stats->depthSinceUs[lane] = simNowUs;
+}
+
+static void reportBeam(int lane, bool blocked, int64_t detectedUs, RunStats *stats) {
+    SystemEvent event;
+    if(!blocked) event.type = EVENT_BEAM_CLEAR;
+    else event.type = laneConfig(lane)->direction == LANE_ENTRY ? EVENT_CAR_ENTRY : EVENT_CAR_EXIT;
+    event.value = lane;
+    event.seq = blocked ? traceNextSeq() : 0;
+    event.detectedUs = detectedUs;
+    event.dequeuedUs = 0;
+    event.queuedUs = esp_timer_get_time();
+
+    if(blocked) stats->detected++;
+    accountDepth(lane, stats);
+    if(xQueueSend(queues[lane], &event, 0) != pdTRUE) {
+        stats->queueDrops++;
+        return;
+    }
+    uint32_t depth = uxQueueMessagesWaiting(queues[lane]);
+    if(depth > stats->maxDepth[lane]) stats->maxDepth[lane] = depth;
+}
+
+static void sensorStep(RunStats *stats) {
+    IrEdge edge;
+
+    while(irSensorPoll(&edge)) {
+        reportBeam(edge.channel, edge.level == LOW, edge.timeUs, stats);
+    }
+}
+
+static RunStats *runStats = NULL;
+
+// Servo writes happen when the gate task finishes its service time
+static int64_t simActuate(int barrier, GateAction action) {
+    int64_t actuatedUs = gateBusyUntilUs[barrier];
+    if(action == GATE_ACTION_OPEN && !inCycle[barrier]) {
+        inCycle[barrier] = true;
+        cycleStartMs[barrier] = (uint32_t)(actuatedUs / 1000);
+    }
+    return actuatedUs;
+}
+
+static void simCounted(int, EventType type, bool, int) {
+    if(type == EVENT_PARKING_FULL) runStats->denied++;
+}
+
+static void simDecided(const SystemEvent *event, TraceOutcome outcome, int64_t) {
+    runStats->latencyUs.push_back((uint32_t)(gateBusyUntilUs[laneBarrier(event->value)] - event->detectedUs));
+    if(outcome == TRACE_OPENED) runStats->opened++;
+    else if(outcome == TRACE_HELD) runStats->held++;
+}
+
+// No reservations on the bench: every entry is a walk-in
+static const GateFlowHooks simGateHooks = { simActuate, NULL, NULL, simCounted, simDecided };
+
+/**
+ * @brief Oldest waiting event among a barrier's lanes (queue set order)
+ * @return Lane index, or -1 if all of them are empty
+ */
+static int nextLane(int barrier) {
+    SystemEvent head;
+    int64_t oldestUs = INT64_MAX;
+    int lane = -1;
+
+    for(int l = 0; l < laneCount(); l++) {
+        if(laneBarrier(l) != barrier || xQueuePeek(queues[l], &head, 0) != pdTRUE) continue;
+        if(head.queuedUs < oldestUs) {
+            oldestUs = head.queuedUs;
+            lane = l;
+        }
+    }
+    return lane;
+}
+
+/**
+ * @brief Let every free gate task take events; each costs serviceUs
+ */
+static void gateStep(int64_t serviceUs, RunStats *stats) {
+    for(int barrier = 0; barrier < laneBarrierCount(); barrier++) {
+        int lane;
+        while(gateBusyUntilUs[barrier] <= simNowUs && (lane = nextLane(barrier)) >= 0) {
+            SystemEvent event;
+            accountDepth(lane, stats);
+            xQueueReceive(queues[lane], &event, 0);
+            event.dequeuedUs = simNowUs;
+
+            // Beam clear: no servo work, modelled as free
+            if(event.type == EVENT_BEAM_CLEAR) {
+                if(earlyClose) gateFlowBeamClear(lane, (uint32_t)(simNowUs / 1000));
+                continue;
+            }
+            gateBusyUntilUs[barrier] = simNowUs + serviceUs;
+            uint32_t decidedMs = (uint32_t)(gateBusyUntilUs[barrier] / 1000);
+            if(event.type == EVENT_CAR_ENTRY) gateFlowEntry(lane, &event, decidedMs);
+            else gateFlowExit(lane, &event, decidedMs);
+        }
+    }
+
+    uint32_t nowMs = (uint32_t)(simNowUs / 1000);
+    for(int i = 0; i < laneBarrierCount(); i++) {
+        GateState before = gateFlowFsm(i)->state;
+        gateFlowTick(i, nowMs);
+        if(before == GATE_CLOSING && gateFlowFsm(i)->state == GATE_IDLE) {
+            inCycle[i] = false;
+            stats->cycles++;
+            stats->cycleMsSum += nowMs - cycleStartMs[i];
+        }
+    }
+}
+
+static int64_t nextWakeUs(const Scenario *s, size_t nextEdge) {
+    int64_t next = INT64_MAX;
+
+    if(nextEdge < s->edges.size()) next = s->edges[nextEdge].atUs;
+
+    TickType_t ticks = irSensorNextTimeout();
+    if(ticks != portMAX_DELAY) next = std::min(next, simNowUs + (int64_t)ticks * 1000);
+
+    for(int l = 0; l < laneCount(); l++) {
+        if(uxQueueMessagesWaiting(queues[l]) == 0) continue;
+        next = std::min(next, std::max(simNowUs, gateBusyUntilUs[laneBarrier(l)]));
+    }
+
+    uint32_t nowMs = (uint32_t)(simNowUs / 1000);
+    for(int i = 0; i < laneBarrierCount(); i++) {
+        int32_t ms = gateFsmTimeToNext(gateFlowFsm(i), nowMs);
+        if(ms >= 0) next = std::min(next, (int64_t)(nowMs + (ms > 0 ? ms : 1)) * 1000);
+    }
+    return next;
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, uint32_t pct) {
+    if(sorted.empty()) return 0;
+    size_t rank = (sorted.size() * pct + 99) / 100;      // Nearest-rank
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void runScenario(const Scenario *s, int64_t serviceUs) {
+    RunStats stats = {};
+    uint32_t droppedBefore = irSensorDroppedEdges();
+
+    uint8_t pins[LANE_MAX];
+
+    simNowUs = 0;
+    parkingStateInit(TOTAL_PARKING_SLOTS);
+    uint32_t travelMs = servoMotionTravelMs(SERVO_OPEN_ANGLE - SERVO_CLOSED_ANGLE);
+    runStats = &stats;
+    gateFlowBegin(&simGateHooks, travelMs);
+    for(int i = 0; i < laneBarrierCount(); i++) {
+        inCycle[i] = false;
+        gateBusyUntilUs[i] = 0;
+    }
+    for(int l = 0; l < laneCount(); l++) pins[l] = laneConfig(l)->irPin;
+    irSensorBegin(pins, laneCount(), NULL);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t nextEdge = 0;
+    while(true) {
+        int64_t wake = nextWakeUs(s, nextEdge);
+        if(wake == INT64_MAX) break;
+        simNowUs = std::max(simNowUs, wake);
+
+        while(nextEdge < s->edges.size() && s->edges[nextEdge].atUs <= simNowUs) {
+            simSetPin(s->edges[nextEdge].pin, s->edges[nextEdge].level);
+            nextEdge++;
+        }
+        sensorStep(&stats);
+        gateStep(serviceUs, &stats);
+    }
+    double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    for(int lane = 0; lane < laneCount(); lane++) accountDepth(lane, &stats);
+
+    std::sort(stats.latencyUs.begin(), stats.latencyUs.end());
+    double events = (double)s->edges.size();
+    printf("%-13s %5u %5u %6u %5u %6u %5u %5u %6.0f  %6u %6u %6u  %7.0f %6.2f",
+           s->name, s->cars, stats.detected, stats.opened, stats.held, stats.denied, stats.queueDrops,
+           irSensorDroppedEdges() - droppedBefore,
+           stats.cycles ? (double)stats.cycleMsSum / stats.cycles : 0.0,
+           percentile(stats.latencyUs, 50), percentile(stats.latencyUs, 99),
+           stats.latencyUs.empty() ? 0 : stats.latencyUs.back(),
+           hostNs / events, events / hostNs * 1e3);
+    for(int lane = 0; lane < laneCount(); lane++) {
+        printf("  %2u/%.5f", stats.maxDepth[lane], simNowUs ? stats.depthUsSum[lane] / simNowUs : 0.0);
+    }
+    printf("\n");
+}
+
+// ============================================================================
+// /data Serializer
+// ============================================================================
+
+static void reportTimings(const char *name, std::vector<uint32_t> *ns, uint64_t allocs, size_t bytes) {
+    uint64_t sum = 0;
+    for(uint32_t v : *ns) sum += v;
+    std::sort(ns->begin(), ns->end());
+    printf("%-18s %7zu %7.1f %7u %7u %7u %9.3f %7zu\n",
+           name, ns->size(), (double)sum / ns->size(), percentile(*ns, 50), percentile(*ns, 99),
+           ns->back(), (double)allocs / ns->size(), bytes);
+}
+
+static void benchSerializers() {
+    std::vector<uint32_t> full, delta;
+    full.reserve(SIM_DATA_ITERATIONS);
+    delta.reserve(SIM_DATA_ITERATIONS);
+    uint64_t fullAllocs = 0, deltaAllocs = 0;
+    size_t fullBytes = 0, deltaBytes = 0;
+    char json[STATE_JSON_MAX];
+    ParkingState prev, cur;
+    ForecastResult forecast = { true, 720, 42.5f, 17.0f };     // Widest "fullInMin"
+
+    simNowUs = 0;
+    parkingStateInit(TOTAL_PARKING_SLOTS);
+    parkingStatePublishClock(timeServiceBootEpoch());
+    parkingStatePublishNetwork(true, true);
+    parkingStatePublishSite(1480, 1960, 16, "North Ramp2");  // Widest site keys
+    parkingStateRead(&prev);
+
+    for(int i = 0; i < SIM_DATA_ITERATIONS; i++) {
+        simNowUs += 1000000;
+        parkingStatePublishEnv(20.0f + (i % 100) / 10.0f, 40.0f + (i % 50));
+        if(i % 7 == 0) parkingStatePublishGate((GateState)(i % 4));
+
+        // handleData(): snapshot + serialize
+        uint64_t before = allocations;
+        auto t0 = std::chrono::steady_clock::now();
+        parkingStateRead(&cur);
+        size_t len = stateToJson(&cur, millis() / 1000, &forecast, json, sizeof(json));
+        auto t1 = std::chrono::steady_clock::now();
+        fullAllocs += allocations - before;
+        fullBytes = std::max(fullBytes, len);
+        full.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+
+        // /events delta for one client
+        before = allocations;
+        t0 = std::chrono::steady_clock::now();
+        len = stateDeltaToJson(&prev, &cur, json, sizeof(json));
+        t1 = std::chrono::steady_clock::now();
+        deltaAllocs += allocations - before;
+        deltaBytes = std::max(deltaBytes, len);
+        delta.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        prev = cur;
+    }
+
+    printf("\n%-18s %7s %7s %7s %7s %7s %9s %7s\n", "serializer", "calls", "mean_ns", "p50_ns", "p99_ns", "max_ns", "allocs/op", "max_B");
+    reportTimings("handleData", &full, fullAllocs, fullBytes);
+    reportTimings("stateDeltaToJson", &delta, deltaAllocs, deltaBytes);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(int argc, char **argv) {
+    int64_t serviceUs = argc > 1 ? atoll(argv[1]) : SIM_DEFAULT_SERVICE_US;
+    earlyClose = !(argc > 2 && strcmp(argv[2], "fixed") == 0);
+
+    traceBegin();
+    lanesBegin();
+    for(int l = 0; l < laneCount(); l++) queues[l] = xQueueCreate(LANE_QUEUE_SIZE, sizeof(SystemEvent));
+
+    Scenario scenarios[] = {
+        makePoisson("steady", 0, 0),
+        makeBursty(),
+        makeSimultaneous(),
+        makePoisson("noisy", 2, 6),     // Contact bounce, all inside the debounce window
+        makeFlood(),
+    };
+
+    printf("Pipeline: %d slots, %d lane(s), %d barrier(s), debounce %d us, queues %d, gate service %lld us\n",
+           TOTAL_PARKING_SLOTS, laneCount(), laneBarrierCount(), IR_DEBOUNCE_US, LANE_QUEUE_SIZE,
+           (long long)serviceUs);
+    for(int l = 0; l < laneCount(); l++) {
+        printf("  q%d = %s (%s, barrier %d)\n", l, laneConfig(l)->name,
+               laneConfig(l)->direction == LANE_ENTRY ? "entry" : "exit", laneBarrier(l));
+    }
+    printf("Barrier: %lu ms swing, %s\n\n", (unsigned long)servoMotionTravelMs(SERVO_OPEN_ANGLE - SERVO_CLOSED_ANGLE),
+           earlyClose ? "closes GATE_CLEAR_GUARD_MS after the beam clears" : "fixed GATE_OPEN_TIME_MS hold");
+    printf("%-13s %5s %5s %6s %5s %6s %5s %5s %6s  %6s %6s %6s  %7s %6s",
+           "scenario", "cars", "seen", "opened", "held", "denied", "qdrop", "edrop", "cyc_ms",
+           "p50_us", "p99_us", "max_us", "ns/edge", "Medge/s");
+    for(int l = 0; l < laneCount(); l++) printf("  q%d max/avg", l);
+    printf("\n");
+    for(const Scenario &s : scenarios) runScenario(&s, serviceUs);
+
+    benchSerializers();
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file Arduino.h
+ * @brief Host shim for the Arduino-ESP32 / FreeRTOS API used by the
+ *        portable firmware modules (env:native only)
+ *
+ * Single-threaded: there is no scheduler. Time is a simulated clock the
+ * benchmark advances explicitly, GPIO levels are set by the traffic
+ * generator (edges call the attached ISR immediately), queues are plain
+ * ring buffers and critical sections / mutexes are no-ops.
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// Attributes / Types
+// ============================================================================
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+typedef struct SimQueue *QueueHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef struct { int unused; } portMUX_TYPE;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define errQUEUE_FULL 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portYIELD_FROM_ISR() ((void)0)
+
+// newlib has it, older glibc does not
+static inline size_t simStrlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if(size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#define strlcpy simStrlcpy
+
+// ============================================================================
+// Simulated Time
+// ============================================================================
+extern int64_t simNowUs;
+
+static inline int64_t esp_timer_get_time() { return simNowUs; }
+static inline unsigned long millis() { return (unsigned long)(simNowUs / 1000); }
+static inline unsigned long micros() { return (unsigned long)simNowUs; }
+
+// ============================================================================
+// GPIO
+// ============================================================================
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define CHANGE 0x03
+#define SIM_GPIO_COUNT 40
+
+#define digitalPinToInterrupt(pin) (pin)
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+
+/**
+ * @brief Drive an input pin from the simulation; fires the pin's ISR on change
+ */
+void simSetPin(uint8_t pin, int level);
+
+// LEDC PWM is accepted and ignored
+static inline double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+static inline void ledcAttachPin(uint8_t, uint8_t) {}
+static inline void ledcWrite(uint8_t, uint32_t) {}
+
+// ============================================================================
+// FreeRTOS
+// ============================================================================
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+typedef struct { int dummy; } StaticSemaphore_t;
+static inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *) { return (SemaphoreHandle_t)1; }
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+// Task notifications only count; the benchmark decides when "tasks" run
+extern uint32_t simNotifications;
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *woken) {
+    simNotifications++;
+    if(woken) *woken = pdFALSE;
+}
+static inline void xTaskNotifyGive(TaskHandle_t) { simNotifications++; }
+
+// ============================================================================
+// Serial (discarded unless simSerialEcho is set)
+// ============================================================================
+extern bool simSerialEcho;
+
+class SimSerial {
+public:
+    int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void print(const char *s) { if(simSerialEcho) fputs(s, stdout); }
+    void println(const char *s = "") { if(simSerialEcho) puts(s); }
+    size_t write(const uint8_t *data, size_t len) { if(simSerialEcho) fwrite(data, 1, len, stdout); return len; }
+};
+extern SimSerial Serial;
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,29 @@
+// Host shim: esp_timer_get_time() lives in Arduino.h; timers never fire
+// (the benchmark drives time itself)
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef struct SimTimer *esp_timer_handle_t;
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+typedef struct {
+    void (*callback)(void *arg);
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+static inline esp_err_t esp_timer_create(const esp_timer_create_args_t *, esp_timer_handle_t *out) {
+    *out = (esp_timer_handle_t)1;
+    return ESP_OK;
+}
+static inline esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t) { return ESP_OK; }
+static inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t, uint64_t) { return ESP_OK; }
+static inline esp_err_t esp_timer_stop(esp_timer_handle_t) { return ESP_OK; }
+
+#endif // SIM_ESP_TIMER_H
@@ -0,0 +1,13 @@
+// Host shim: GPIO input registers backed by the simulated pin levels
+#ifndef SIM_GPIO_REG_H
+#define SIM_GPIO_REG_H
+
+#include <Arduino.h>
+
+#define GPIO_IN_REG 0
+#define GPIO_IN1_REG 1
+
+uint32_t simGpioInReg(int reg);
+#define REG_READ(reg) simGpioInReg(reg)
+
+#endif // SIM_GPIO_REG_H
@@ -0,0 +1,129 @@
+/**
+ * @file sim_hal.cpp
+ * @brief Host implementations behind sim/shim/Arduino.h
+ */
+
+#include <Arduino.h>
+#include "soc/gpio_reg.h"
+#include <stdarg.h>
+
+int64_t simNowUs = 0;
+uint32_t simNotifications = 0;
+bool simSerialEcho = false;
+SimSerial Serial;
+
+// ============================================================================
+// GPIO
+// ============================================================================
+
+typedef struct {
+    uint8_t level;
+    void (*handler)(void *);
+    void *arg;
+} SimPin;
+
+static SimPin pins[SIM_GPIO_COUNT];
+static bool pinsReady = false;
+
+static void pinsInit() {
+    if(pinsReady) return;
+    for(int i = 0; i < SIM_GPIO_COUNT; i++) pins[i].level = HIGH;    // Beams clear
+    pinsReady = true;
+}
+
+void pinMode(uint8_t, uint8_t) {
+    pinsInit();
+}
+
+int digitalRead(uint8_t pin) {
+    pinsInit();
+    return pin < SIM_GPIO_COUNT ? pins[pin].level : LOW;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int) {
+    pinsInit();
+    if(pin >= SIM_GPIO_COUNT) return;
+    pins[pin].handler = handler;
+    pins[pin].arg = arg;
+}
+
+void simSetPin(uint8_t pin, int level) {
+    pinsInit();
+    if(pin >= SIM_GPIO_COUNT || pins[pin].level == level) return;
+    pins[pin].level = level;
+    if(pins[pin].handler) pins[pin].handler(pins[pin].arg);
+}
+
+uint32_t simGpioInReg(int reg) {
+    uint32_t value = 0;
+    int first = reg == GPIO_IN_REG ? 0 : 32;
+
+    pinsInit();
+    for(int i = 0; i < 32 && first + i < SIM_GPIO_COUNT; i++) {
+        if(pins[first + i].level) value |= 1u << i;
+    }
+    return value;
+}
+
+// ============================================================================
+// Queues
+// ============================================================================
+
+struct SimQueue {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    QueueHandle_t q = (QueueHandle_t)calloc(1, sizeof(SimQueue));
+    q->items = (uint8_t *)calloc(length, itemSize);
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t) {
+    // Nothing else runs while we "block", so a full queue stays full
+    if(q->count == q->length) return errQUEUE_FULL;
+    memcpy(q->items + ((q->head + q->count) % q->length) * q->itemSize, item, q->itemSize);
+    q->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t) {
+    if(q->count == 0) return pdFALSE;
+    memcpy(item, q->items + q->head * q->itemSize, q->itemSize);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+    if(xQueuePeek(q, item, wait) != pdTRUE) return pdFALSE;
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    return q->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) {
+    return q->length - q->count;
+}
+
+// ============================================================================
+// Serial
+// ============================================================================
+
+int SimSerial::printf(const char *fmt, ...) {
+    if(!simSerialEcho) return 0;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+}
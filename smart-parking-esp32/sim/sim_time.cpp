@@ -0,0 +1,19 @@
+/**
+ * @file sim_time.cpp
+ * @brief time_service.h on the simulated clock (no SNTP, no HTTP)
+ *
+ * The firmware's time_service.cpp needs WiFi, HTTPClient and SNTP, so the
+ * native build links this instead. The clock is "synced" to a fixed epoch
+ * at simulated boot; timeFormatEpoch is the firmware's (time_format.cpp).
+ */
+
+#include "time_service.h"
+
+#define SIM_BOOT_EPOCH 1767225600u      // 2026-01-01 00:00:00 local
+
+void timeServiceBegin() {}
+void timeServiceMaintain(bool) {}
+bool timeServiceValid() { return true; }
+uint32_t timeServiceNow() { return SIM_BOOT_EPOCH + (uint32_t)(esp_timer_get_time() / 1000000); }
+uint32_t timeServiceBootEpoch() { return SIM_BOOT_EPOCH; }
+uint32_t timeServiceMsToNextSecond() { return 1000 - (uint32_t)((esp_timer_get_time() / 1000) % 1000); }
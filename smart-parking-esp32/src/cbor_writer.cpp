@@ -0,0 +1,104 @@
+/**
+ * @file cbor_writer.cpp
+ * @brief Minimal CBOR (RFC 8949) encoder into a fixed buffer
+ */
+
+#include "cbor_writer.h"
+#include <string.h>
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_SIMPLE 7
+
+static void put(CborWriter *out, const void *data, size_t len) {
+    if(out->overflow || out->len + len > out->cap) {
+        out->overflow = true;
+        return;
+    }
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+}
+
+/**
+ * @brief Major type plus argument in the shortest big-endian form
+ */
+static void putHead(CborWriter *out, uint8_t major, uint64_t arg) {
+    uint8_t head[9];
+    size_t n;
+
+    if(arg < 24) {
+        head[0] = (major << 5) | arg;
+        n = 1;
+    } else if(arg <= 0xFF) {
+        head[0] = (major << 5) | 24;
+        n = 2;
+    } else if(arg <= 0xFFFF) {
+        head[0] = (major << 5) | 25;
+        n = 3;
+    } else if(arg <= 0xFFFFFFFFull) {
+        head[0] = (major << 5) | 26;
+        n = 5;
+    } else {
+        head[0] = (major << 5) | 27;
+        n = 9;
+    }
+    for(size_t i = 1; i < n; i++) {
+        head[i] = arg >> (8 * (n - 1 - i));
+    }
+    put(out, head, n);
+}
+
+void cborWriterInit(CborWriter *out, uint8_t *buf, size_t cap) {
+    out->buf = buf;
+    out->cap = cap;
+    out->len = 0;
+    out->overflow = false;
+}
+
+void cborMap(CborWriter *out, size_t pairs) {
+    putHead(out, CBOR_MAP, pairs);
+}
+
+void cborArray(CborWriter *out, size_t items) {
+    putHead(out, CBOR_ARRAY, items);
+}
+
+void cborUint(CborWriter *out, uint64_t value) {
+    putHead(out, CBOR_UINT, value);
+}
+
+void cborInt(CborWriter *out, int64_t value) {
+    if(value >= 0) putHead(out, CBOR_UINT, value);
+    else putHead(out, CBOR_NEGINT, (uint64_t)(-1 - value));
+}
+
+void cborText(CborWriter *out, const char *text) {
+    size_t len = strlen(text);
+    putHead(out, CBOR_TEXT, len);
+    put(out, text, len);
+}
+
+void cborFloat(CborWriter *out, float value) {
+    uint32_t bits;
+    uint8_t b[5];
+
+    memcpy(&bits, &value, sizeof(bits));
+    b[0] = (CBOR_SIMPLE << 5) | 26;
+    b[1] = bits >> 24;
+    b[2] = bits >> 16;
+    b[3] = bits >> 8;
+    b[4] = bits;
+    put(out, b, sizeof(b));
+}
+
+void cborBool(CborWriter *out, bool value) {
+    uint8_t b = (CBOR_SIMPLE << 5) | (value ? 21 : 20);
+    put(out, &b, 1);
+}
+
+size_t cborLength(const CborWriter *out) {
+    return out->overflow ? 0 : out->len;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file chunk_writer.cpp
+ * @brief Buffered writer for streamed (chunked) HTTP responses
+ */
+
+#include "chunk_writer.h"
+#include <stdarg.h>
+
+void chunkWriterInit(ChunkWriter *out, ChunkSink sink, void *ctx) {
+    out->len = 0;
+    out->sink = sink;
+    out->ctx = ctx;
+    out->ok = true;
+}
+
+bool chunkFlush(ChunkWriter *out) {
+    if(out->ok && out->len > 0) out->ok = out->sink(out->ctx, out->buf, out->len);
+    out->len = 0;
+    return out->ok;
+}
+
+void chunkWrite(ChunkWriter *out, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+
+    while(len > 0 && out->ok) {
+        if(out->len == sizeof(out->buf)) chunkFlush(out);
+
+        size_t room = sizeof(out->buf) - out->len;
+        size_t n = len < room ? len : room;
+        memcpy(out->buf + out->len, p, n);
+        out->len += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void chunkPrintf(ChunkWriter *out, const char *fmt, ...) {
+    char piece[CHUNK_WRITER_SIZE];
+    va_list args;
+
+    va_start(args, fmt);
+    int n = vsnprintf(piece, sizeof(piece), fmt, args);
+    va_end(args);
+
+    if(n < 0) return;
+    if(n >= (int)sizeof(piece)) n = sizeof(piece) - 1;
+    chunkWrite(out, piece, n);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file connectivity.cpp
+ * @brief Internet reachability inferred from real traffic
+ */
+
+#include "connectivity.h"
+#include "config.h"
+#include "parking_state.h"
+#include <WiFi.h>
+
+#ifndef CONNECTIVITY_FAIL_THRESHOLD
+    #define CONNECTIVITY_FAIL_THRESHOLD 3
+#endif
+#ifndef CONNECTIVITY_IDLE_MS
+    #define CONNECTIVITY_IDLE_MS 60000
+#endif
+#ifndef CONNECTIVITY_PROBE_MIN_MS
+    #define CONNECTIVITY_PROBE_MIN_MS 15000
+#endif
+#ifndef CONNECTIVITY_PROBE_MAX_MS
+    #define CONNECTIVITY_PROBE_MAX_MS 600000
+#endif
+#ifndef CONNECTIVITY_PROBE_HOST
+    #define CONNECTIVITY_PROBE_HOST "clients3.google.com"
+#endif
+#ifndef CONNECTIVITY_PROBE_PORT
+    #define CONNECTIVITY_PROBE_PORT 80
+#endif
+#ifndef CONNECTIVITY_PROBE_TIMEOUT_MS
+    #define CONNECTIVITY_PROBE_TIMEOUT_MS 2000
+#endif
+
+static const char *sourceNames[CONN_SOURCE_COUNT] = {
+    "telegram", "mqtt", "ntp", "time api", "probe"
+};
+
+static portMUX_TYPE connLock = portMUX_INITIALIZER_UNLOCKED;
+static bool linkUp = false;
+static bool reachable = false;
+static uint8_t failures = 0;            // Consecutive, across all sources
+static uint32_t lastReportMs = 0;       // Any outcome from real traffic or a probe
+static uint32_t nextProbeMs = 0;
+static uint32_t probeBackoffMs = CONNECTIVITY_PROBE_MIN_MS;
+static volatile uint32_t generation = 0;         // Bumped on every link/reachability change
+static uint32_t probes = 0;
+
+/**
+ * @brief Push the current verdict to the parking state
+ *
+ * Reporters publish outside the lock, so repeat until no newer change
+ * slipped in between reading and publishing.
+ */
+static void publish() {
+    bool link, up;
+    uint32_t seen;
+
+    do {
+        portENTER_CRITICAL(&connLock);
+        link = linkUp;
+        up = reachable;
+        seen = generation;
+        portEXIT_CRITICAL(&connLock);
+
+        parkingStatePublishNetwork(link, up);
+    } while(seen != generation);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void connectivityReport(ConnectivitySource source, bool ok) {
+    bool changed = false;
+
+    portENTER_CRITICAL(&connLock);
+    lastReportMs = millis();
+    if(ok) {
+        failures = 0;
+        // Real traffic is fresher than any probe; start the next idle
+        // period from the shortest probe interval again
+        if(source != CONN_SOURCE_PROBE) probeBackoffMs = CONNECTIVITY_PROBE_MIN_MS;
+        if(!reachable && linkUp) {
+            reachable = true;
+            changed = true;
+        }
+    } else {
+        if(failures < UINT8_MAX) failures++;
+        if(reachable && failures >= CONNECTIVITY_FAIL_THRESHOLD) {
+            reachable = false;
+            changed = true;
+        }
+    }
+    if(changed) generation++;
+    portEXIT_CRITICAL(&connLock);
+
+    if(changed) {
+        Serial.printf("[Net] Internet %s (%s)\n", ok ? "reachable" : "unreachable", sourceNames[source]);
+        publish();
+    }
+}
+
+void connectivitySetLink(bool up) {
+    portENTER_CRITICAL(&connLock);
+    bool changed = up != linkUp;
+    if(changed) {
+        linkUp = up;
+        reachable = false;      // Unknown until traffic or a probe gets through
+        failures = 0;
+        // First probe CONNECTIVITY_PROBE_MIN_MS after the link comes up,
+        // unless real traffic reports before that
+        nextProbeMs = millis() + CONNECTIVITY_PROBE_MIN_MS;
+        lastReportMs = nextProbeMs - CONNECTIVITY_IDLE_MS;
+        probeBackoffMs = CONNECTIVITY_PROBE_MIN_MS;
+        generation++;
+    }
+    portEXIT_CRITICAL(&connLock);
+
+    if(changed) publish();
+}
+
+uint32_t connectivityMsToNextProbe() {
+    uint32_t now = millis();
+    uint32_t wait;
+
+    portENTER_CRITICAL(&connLock);
+    if(!linkUp) {
+        wait = UINT32_MAX;
+    } else {
+        int32_t idle = (int32_t)(lastReportMs + CONNECTIVITY_IDLE_MS - now);
+        int32_t backoff = (int32_t)(nextProbeMs - now);
+        int32_t ms = idle > backoff ? idle : backoff;
+        wait = ms > 0 ? ms : 0;
+    }
+    portEXIT_CRITICAL(&connLock);
+
+    return wait;
+}
+
+void connectivityMaintain() {
+    if(connectivityMsToNextProbe() != 0) return;
+
+    WiFiClient probe;
+    bool ok = probe.connect(CONNECTIVITY_PROBE_HOST, CONNECTIVITY_PROBE_PORT, CONNECTIVITY_PROBE_TIMEOUT_MS);
+    probe.stop();
+
+    portENTER_CRITICAL(&connLock);
+    probes++;
+    nextProbeMs = millis() + probeBackoffMs;
+    probeBackoffMs = probeBackoffMs * 2 > CONNECTIVITY_PROBE_MAX_MS ? CONNECTIVITY_PROBE_MAX_MS : probeBackoffMs * 2;
+    portEXIT_CRITICAL(&connLock);
+
+    connectivityReport(CONN_SOURCE_PROBE, ok);
+}
+
+bool connectivityReachable() {
+    return reachable;
+}
+
+uint32_t connectivityProbeCount() {
+    return probes;
+}
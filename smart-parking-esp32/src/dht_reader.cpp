@@ -0,0 +1,172 @@
+/**
+ * @file dht_reader.cpp
+ * @brief DHT11/DHT22 reader on the RMT receiver, interrupts left enabled
+ */
+
+#include "dht_reader.h"
+#include "config.h"
+#include <driver/rmt.h>
+#include <driver/gpio.h>
+
+#ifndef DHT_RMT_CHANNEL
+    #define DHT_RMT_CHANNEL 4
+#endif
+#ifndef POWER_SAVE_MODE
+    #define POWER_SAVE_MODE 0
+#endif
+
+// The RMT counts APB ticks: a capture must not see light sleep or a
+// lower APB clock. An APB_FREQ_MAX lock rules out both
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+    #include <esp_pm.h>
+    static esp_pm_lock_handle_t apbLock = NULL;
+#endif
+
+// Timings in microseconds (RMT tick = 1 us)
+#define DHT_START_LOW_MS 2          // Host start pulse (DHT22 >= 1 ms, DHT11 >= 18 ms)
+#define DHT11_START_LOW_MS 20
+#define DHT_RX_IDLE_US 200          // Capture ends once the line is quiet this long
+#define DHT_RX_TIMEOUT_MS 20        // 40 bits take < 5 ms
+#define DHT_PREAMBLE_MIN_US 40      // Sensor answers 80 us low, 80 us high
+#define DHT_PREAMBLE_MAX_US 120
+#define DHT_BIT_ONE_US 48           // High pulse 26-28 us = 0, 70 us = 1
+#define DHT_MAX_PULSES 128
+
+static gpio_num_t dhtPin;
+static uint8_t dhtType = DHT22;
+static RingbufHandle_t rxBuffer = NULL;
+
+static void holdApb(bool hold) {
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+    if(apbLock == NULL) return;
+    if(hold) esp_pm_lock_acquire(apbLock);
+    else esp_pm_lock_release(apbLock);
+#else
+    (void)hold;
+#endif
+}
+
+/**
+ * @brief Decode captured pulses into the five data bytes
+ */
+static DhtStatus decode(const rmt_item32_t *items, size_t count, uint8_t data[5]) {
+    uint8_t levels[DHT_MAX_PULSES];
+    uint16_t durations[DHT_MAX_PULSES];
+    size_t pulses = 0;
+
+    // Each item holds two pulses; a zero duration ends the capture
+    for(size_t i = 0; i < count && pulses + 2 <= DHT_MAX_PULSES; i++) {
+        if(items[i].duration0 == 0) break;
+        levels[pulses] = items[i].level0;
+        durations[pulses++] = items[i].duration0;
+        if(items[i].duration1 == 0) break;
+        levels[pulses] = items[i].level1;
+        durations[pulses++] = items[i].duration1;
+    }
+
+    // Skip the tail of our start pulse and the release, up to the preamble
+    size_t start = 0;
+    while(start + 1 < pulses) {
+        if(levels[start] == 0 && levels[start + 1] == 1 &&
+           durations[start] >= DHT_PREAMBLE_MIN_US && durations[start] <= DHT_PREAMBLE_MAX_US &&
+           durations[start + 1] >= DHT_PREAMBLE_MIN_US && durations[start + 1] <= DHT_PREAMBLE_MAX_US) {
+            break;
+        }
+        start++;
+    }
+    if(start + 1 >= pulses) return DHT_ERR_NO_RESPONSE;
+    start += 2;
+
+    // 40 bits of (50 us low, 26/70 us high)
+    if(pulses - start < 80) return DHT_ERR_SHORT;
+    memset(data, 0, 5);
+    for(int bit = 0; bit < 40; bit++) {
+        size_t high = start + 2 * bit + 1;
+        if(levels[high] != 1) return DHT_ERR_SHORT;
+        data[bit / 8] = (data[bit / 8] << 1) | (durations[high] > DHT_BIT_ONE_US ? 1 : 0);
+    }
+
+    if((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) return DHT_ERR_CHECKSUM;
+    return DHT_OK;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool dhtReaderBegin(uint8_t pin, uint8_t type) {
+    dhtPin = (gpio_num_t)pin;
+    dhtType = type;
+
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX(dhtPin, (rmt_channel_t)DHT_RMT_CHANNEL);
+    config.clk_div = 80;                        // 80 MHz APB -> 1 us ticks
+    config.mem_block_num = 1;                   // 64 items = 128 pulses, ~85 needed
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = 80;  // Ignore glitches under 1 us (APB cycles)
+    config.rx_config.idle_threshold = DHT_RX_IDLE_US;
+
+    if(rmt_config(&config) != ESP_OK ||
+       rmt_driver_install((rmt_channel_t)DHT_RMT_CHANNEL, 512, 0) != ESP_OK) {
+        Serial.println("[DHT] RMT driver install failed");
+        return false;
+    }
+    rmt_get_ringbuf_handle((rmt_channel_t)DHT_RMT_CHANNEL, &rxBuffer);
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "dht", &apbLock);
+#endif
+
+    // RMT listens on the input; the host drives the same pin open drain
+    gpio_set_direction(dhtPin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(dhtPin, GPIO_PULLUP_ONLY);
+    gpio_set_level(dhtPin, 1);
+    return true;
+}
+
+DhtStatus dhtRead(DhtReading *out) {
+    uint8_t data[5];
+    size_t size = 0;
+
+    if(rxBuffer == NULL) return DHT_ERR_TIMEOUT;
+
+    // Start pulse: a sleep, not a busy wait; a longer low is harmless.
+    // Awake at full APB from here until the capture is stopped
+    uint32_t lowMs = dhtType == DHT11 ? DHT11_START_LOW_MS : DHT_START_LOW_MS;
+    holdApb(true);
+    gpio_set_level(dhtPin, 0);
+    vTaskDelay(pdMS_TO_TICKS(lowMs) + 1);
+
+    // Arm the capture right before releasing the line
+    rmt_rx_start((rmt_channel_t)DHT_RMT_CHANNEL, true);
+    gpio_set_level(dhtPin, 1);
+
+    rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(rxBuffer, &size, pdMS_TO_TICKS(DHT_RX_TIMEOUT_MS));
+    rmt_rx_stop((rmt_channel_t)DHT_RMT_CHANNEL);
+    holdApb(false);
+    if(items == NULL) return DHT_ERR_TIMEOUT;
+
+    DhtStatus status = decode(items, size / sizeof(rmt_item32_t), data);
+    vRingbufferReturnItem(rxBuffer, items);
+    if(status != DHT_OK) return status;
+
+    if(dhtType == DHT11) {
+        out->humidity = data[0] + data[1] * 0.1f;
+        out->temperature = data[2] + (data[3] & 0x0F) * 0.1f;
+        if(data[3] & 0x80) out->temperature = -out->temperature;
+    } else {
+        out->humidity = ((data[0] << 8) | data[1]) * 0.1f;
+        out->temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+        if(data[2] & 0x80) out->temperature = -out->temperature;
+    }
+    return DHT_OK;
+}
+
+const char *dhtStatusName(DhtStatus status) {
+    switch(status) {
+        case DHT_OK:              return "ok";
+        case DHT_ERR_TIMEOUT:     return "no capture";
+        case DHT_ERR_NO_RESPONSE: return "no response";
+        case DHT_ERR_SHORT:       return "short frame";
+        case DHT_ERR_CHECKSUM:    return "checksum";
+        default:                  return "?";
+    }
+}
@@ -0,0 +1,401 @@
+/**
+ * @file federation.cpp
+ * @brief Site-wide occupancy across several controllers over UDP multicast
+ */
+
+#include "federation.h"
+#include "config.h"
+#include "parking_state.h"
+#include <WiFi.h>
+#include <AsyncUDP.h>
+#include <esp_system.h>
+
+#ifndef FED_NODE_NAME
+    #define FED_NODE_NAME ""
+#endif
+#ifndef FED_GROUP
+    #define FED_GROUP "239.255.80.1"
+#endif
+#ifndef FED_PORT
+    #define FED_PORT 45454
+#endif
+#ifndef FED_TTL
+    #define FED_TTL 1
+#endif
+#ifndef FED_MAX_PEERS
+    #define FED_MAX_PEERS 15
+#endif
+#ifndef FED_DELTA_MIN_MS
+    #define FED_DELTA_MIN_MS 20
+#endif
+#ifndef FED_SYNC_RATE
+    #define FED_SYNC_RATE 2
+#endif
+#ifndef FED_SYNC_MIN_MS
+    #define FED_SYNC_MIN_MS 1000
+#endif
+#ifndef FED_EXPIRE_SYNCS
+    #define FED_EXPIRE_SYNCS 3
+#endif
+
+#define FED_MAGIC 0x4650            // "PF"
+#define FED_PROTOCOL_VERSION 1
+#define FED_KIND_DELTA 0
+#define FED_KIND_SYNC 1
+#define FED_NAME_MAX PARKING_NODE_NAME_MAX
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t kind;               // FED_KIND_*
+    uint32_t node;
+    uint32_t boot;              // Random per boot; a new one restarts seq
+    uint32_t seq;               // Bumped on every change of the record
+    int16_t available;          // Walk-in free slots
+    int16_t total;
+    uint16_t syncMs;            // Sender's longest sync gap, for expiry
+    uint8_t digestCount;        // FedDigest entries that follow (syncs only)
+    char name[FED_NAME_MAX];    // NUL-padded
+} FedHeader;
+
+typedef struct __attribute__((packed)) {
+    uint32_t node;
+    uint32_t seq;
+} FedDigest;
+
+#define FED_PACKET_MAX (sizeof(FedHeader) + FED_MAX_PEERS * sizeof(FedDigest))
+
+static_assert(FED_MAX_PEERS <= UINT8_MAX, "FED_MAX_PEERS does not fit digestCount");
+
+typedef struct {
+    uint32_t node;
+    uint32_t boot;
+    uint32_t seq;
+    int16_t available;
+    int16_t total;
+    uint16_t syncMs;
+    unsigned long heardMs;
+    char name[FED_NAME_MAX];
+} FedPeer;
+
+static bool enabled = false;
+static TaskHandle_t federationTaskHandle = NULL;
+static AsyncUDP udp;
+static IPAddress group;
+
+// This node's record (written by federationTask only)
+static uint32_t selfNode = 0;
+static uint32_t selfBoot = 0;
+static volatile uint32_t selfSeq = 0;
+static int16_t selfAvailable = 0;
+static int16_t selfTotal = 0;
+static char selfName[FED_NAME_MAX];
+
+// Peer table, shared with the UDP receive callback (fedLock)
+static portMUX_TYPE fedLock = portMUX_INITIALIZER_UNLOCKED;
+static FedPeer peers[FED_MAX_PEERS];
+static int peerCount = 0;
+static bool repairDue = false;      // A peer's digest is behind on this node
+static FederationStats stats;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void wakeTask() {
+    if(federationTaskHandle != NULL) xTaskNotifyGive(federationTaskHandle);
+}
+
+static void onStateChanged() {
+    wakeTask();
+}
+
+/**
+ * @brief Copy a node name, keeping it safe for JSON and the LCD
+ */
+static void copyName(char *out, const char *in, size_t inLen) {
+    size_t i = 0;
+
+    for(; i < inLen && i < FED_NAME_MAX - 1 && in[i] != '\0'; i++) {
+        char c = in[i];
+        out[i] = (c < 0x20 || c > 0x7e || c == '"' || c == '\\') ? '?' : c;
+    }
+    out[i] = '\0';
+}
+
+/**
+ * @brief Sync period for the current site size (caller holds fedLock)
+ */
+static uint32_t syncIntervalMs() {
+    uint32_t interval = (uint32_t)(peerCount + 1) * 1000 / FED_SYNC_RATE;
+    return interval < FED_SYNC_MIN_MS ? FED_SYNC_MIN_MS : interval;
+}
+
+// ============================================================================
+// Receiving (AsyncUDP task)
+// ============================================================================
+
+static FedPeer *findPeer(uint32_t node) {
+    for(int i = 0; i < peerCount; i++) {
+        if(peers[i].node == node) return &peers[i];
+    }
+    return NULL;
+}
+
+static void onPacket(void *arg, AsyncUDPPacket &packet) {
+    FedHeader header;
+    size_t length = packet.length();
+    bool changed = false;
+
+    if(length < sizeof(header)) {
+        portENTER_CRITICAL(&fedLock);
+        stats.rxRejected++;
+        portEXIT_CRITICAL(&fedLock);
+        return;
+    }
+    memcpy(&header, packet.data(), sizeof(header));
+    if(header.node == selfNode) return;     // Our own, looped back
+
+    const FedDigest *digest = (const FedDigest *)(packet.data() + sizeof(header));
+    bool valid = header.magic == FED_MAGIC && header.version == FED_PROTOCOL_VERSION &&
+                 header.digestCount <= FED_MAX_PEERS &&
+                 length == sizeof(header) + header.digestCount * sizeof(FedDigest);
+
+    portENTER_CRITICAL(&fedLock);
+    FedPeer *peer = valid ? findPeer(header.node) : NULL;
+    if(valid && peer == NULL && peerCount < FED_MAX_PEERS) {
+        peer = &peers[peerCount++];
+        memset(peer, 0, sizeof(*peer));
+        peer->node = header.node;
+    }
+
+    if(peer == NULL) {
+        stats.rxRejected++;
+    } else {
+        stats.rxPackets++;
+        stats.rxBytes += length;
+        peer->heardMs = millis();
+        peer->syncMs = header.syncMs;
+
+        if(peer->boot != header.boot || header.seq > peer->seq) {
+            // Skipped numbers were deltas lost on the way; this record replaces them
+            if(peer->boot == header.boot) stats.rxLost += header.seq - peer->seq - 1;
+            peer->boot = header.boot;
+            peer->seq = header.seq;
+            peer->available = header.available;
+            peer->total = header.total;
+            copyName(peer->name, header.name, sizeof(header.name));
+            changed = true;
+        } else if(header.seq < peer->seq) {
+            stats.rxStale++;        // Overtaken by a later record
+        }
+
+        // Anti-entropy: answer a digest that is missing or behind on us
+        if(header.kind == FED_KIND_SYNC) {
+            bool current = false;
+            for(int i = 0; i < header.digestCount; i++) {
+                FedDigest entry;
+                memcpy(&entry, &digest[i], sizeof(entry));
+                if(entry.node == selfNode) {
+                    current = entry.seq == selfSeq;
+                    break;
+                }
+            }
+            if(!current) {
+                repairDue = true;
+                changed = true;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&fedLock);
+
+    if(changed) wakeTask();
+}
+
+// ============================================================================
+// Sending (federationTask)
+// ============================================================================
+
+static bool sendRecord(uint8_t kind, uint32_t syncMs) {
+    static uint8_t packet[FED_PACKET_MAX];
+    FedHeader header;
+    size_t length = sizeof(header);
+
+    header.magic = FED_MAGIC;
+    header.version = FED_PROTOCOL_VERSION;
+    header.kind = kind;
+    header.node = selfNode;
+    header.boot = selfBoot;
+    header.seq = selfSeq;
+    header.available = selfAvailable;
+    header.total = selfTotal;
+    header.syncMs = syncMs > UINT16_MAX ? UINT16_MAX : syncMs;
+    header.digestCount = 0;
+    memset(header.name, 0, sizeof(header.name));
+    strlcpy(header.name, selfName, sizeof(header.name));
+
+    if(kind == FED_KIND_SYNC) {
+        portENTER_CRITICAL(&fedLock);
+        for(int i = 0; i < peerCount; i++) {
+            FedDigest entry = { peers[i].node, peers[i].seq };
+            memcpy(packet + length, &entry, sizeof(entry));
+            length += sizeof(entry);
+        }
+        header.digestCount = peerCount;
+        portEXIT_CRITICAL(&fedLock);
+    }
+    memcpy(packet, &header, sizeof(header));
+
+    if(udp.writeTo(packet, length, group, FED_PORT) != length) return false;
+    portENTER_CRITICAL(&fedLock);
+    stats.txBytes += length;
+    if(kind == FED_KIND_SYNC) stats.txSyncs++;
+    else stats.txDeltas++;
+    portEXIT_CRITICAL(&fedLock);
+    return true;
+}
+
+/**
+ * @brief Drop silent peers and publish the aggregate and redirect hint
+ * @return ms until the next peer would expire
+ */
+static uint32_t refreshAggregate() {
+    int available = selfAvailable;
+    int total = selfTotal;
+    int bestRoom = 0;
+    char redirect[FED_NAME_MAX] = "";
+    uint32_t nextExpiry = UINT32_MAX;
+
+    portENTER_CRITICAL(&fedLock);
+    unsigned long now = millis();       // Not before the callback's last heardMs
+    for(int i = 0; i < peerCount; ) {
+        uint32_t expiry = (uint32_t)FED_EXPIRE_SYNCS * peers[i].syncMs;
+        uint32_t silent = now - peers[i].heardMs;
+        if(silent >= expiry) {
+            peers[i] = peers[--peerCount];
+            stats.expired++;
+            continue;
+        }
+        if(expiry - silent < nextExpiry) nextExpiry = expiry - silent;
+
+        available += peers[i].available;
+        total += peers[i].total;
+        if(selfAvailable <= 0 && peers[i].available > bestRoom) {
+            bestRoom = peers[i].available;
+            strlcpy(redirect, peers[i].name, sizeof(redirect));
+        }
+        i++;
+    }
+    int nodes = peerCount + 1;
+    portEXIT_CRITICAL(&fedLock);
+
+    parkingStatePublishSite(available, total, nodes, redirect);
+    return nextExpiry;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool federationBegin() {
+    uint8_t mac[6];
+
+    if(FED_NODE_NAME[0] == '\0') return false;
+
+    WiFi.macAddress(mac);
+    selfNode = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+    selfBoot = esp_random();
+    copyName(selfName, FED_NODE_NAME, sizeof(FED_NODE_NAME));
+    group.fromString(FED_GROUP);
+    parkingStateAddListener(onStateChanged);
+
+    enabled = true;
+    Serial.printf("[Federation] Node \"%s\" (%08lx) on %s:%d\n", selfName, (unsigned long)selfNode, FED_GROUP, FED_PORT);
+    return true;
+}
+
+bool federationEnabled() {
+    return enabled;
+}
+
+void federationGetStats(FederationStats *out) {
+    portENTER_CRITICAL(&fedLock);
+    *out = stats;
+    out->peers = peerCount;
+    out->syncIntervalMs = syncIntervalMs();
+    portEXIT_CRITICAL(&fedLock);
+}
+
+void federationTask(void *parameter) {
+    bool listening = false;
+    bool deltaDue = false;
+    unsigned long lastDeltaMs = 0;
+    unsigned long nextSyncMs = 0;
+
+    federationTaskHandle = xTaskGetCurrentTaskHandle();
+    Serial.println("[Federation] Started on Core 1");
+
+    while(1) {
+        unsigned long now = millis();
+        uint32_t wait = FED_SYNC_MIN_MS;
+
+        // Join (again) whenever the station has an address
+        bool wifi = WiFi.status() == WL_CONNECTED;
+        if(wifi && !listening && udp.listenMulticast(group, FED_PORT, FED_TTL)) {
+            udp.onPacket(onPacket);
+            listening = true;
+            nextSyncMs = now;           // Announce now; peers answer our empty digest
+            Serial.printf("[Federation] Joined %s:%d\n", FED_GROUP, FED_PORT);
+        } else if(!wifi && listening) {
+            udp.close();
+            listening = false;
+        }
+
+        // A new record for every change of the walk-in count or capacity
+        ParkingState state;
+        parkingStateRead(&state);
+        int16_t available = state.availableSlots - state.reservedSlots;
+        if(available != selfAvailable || state.totalSlots != selfTotal) {
+            selfAvailable = available;
+            selfTotal = state.totalSlots;
+            selfSeq = selfSeq + 1;
+            deltaDue = true;
+        }
+
+        if(listening) {
+            portENTER_CRITICAL(&fedLock);
+            bool repair = repairDue;
+            uint32_t interval = syncIntervalMs();
+            portEXIT_CRITICAL(&fedLock);
+
+            if(deltaDue || repair) {
+                uint32_t sinceDelta = now - lastDeltaMs;
+                if(sinceDelta >= FED_DELTA_MIN_MS) {
+                    portENTER_CRITICAL(&fedLock);
+                    repairDue = false;
+                    if(repair && !deltaDue) stats.txRepairs++;
+                    portEXIT_CRITICAL(&fedLock);
+                    sendRecord(FED_KIND_DELTA, interval * 5 / 4);
+                    lastDeltaMs = now;
+                    deltaDue = false;
+                } else {
+                    wait = FED_DELTA_MIN_MS - sinceDelta;
+                }
+            }
+
+            // Jittered +-25% so nodes that booted together drift apart
+            if((long)(now - nextSyncMs) >= 0) {
+                sendRecord(FED_KIND_SYNC, interval * 5 / 4);
+                nextSyncMs = now + interval * 3 / 4 + esp_random() % (interval / 2 + 1);
+            }
+            uint32_t untilSync = nextSyncMs - now;
+            if(untilSync < wait) wait = untilSync;
+        }
+
+        uint32_t untilExpiry = refreshAggregate();
+        if(untilExpiry < wait) wait = untilExpiry;
+
+        // Own changes and peer records wake the task early
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait) > 0 ? pdMS_TO_TICKS(wait) : 1);
+    }
+}
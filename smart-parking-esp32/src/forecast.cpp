@@ -0,0 +1,278 @@
+/**
+ * @file forecast.cpp
+ * @brief Weekday/hour traffic model and the "full in N minutes" estimate
+ */
+
+#include "forecast.h"
+#include "config.h"
+#include "parking_state.h"
+#include "time_service.h"
+#include <Preferences.h>
+
+#ifndef FORECAST_EMA_ALPHA
+    #define FORECAST_EMA_ALPHA 0.25f
+#endif
+#ifndef FORECAST_HORIZON_H
+    #define FORECAST_HORIZON_H 12
+#endif
+#ifndef FORECAST_MIN_OBSERVED_SEC
+    #define FORECAST_MIN_OBSERVED_SEC 1800
+#endif
+
+#define FORECAST_DAYS 7
+#define FORECAST_HOURS 24
+#define FORECAST_VERSION 1
+
+static_assert(FORECAST_HORIZON_H * 60 <= INT16_MAX, "FORECAST_HORIZON_H does not fit minutesToFull");
+
+typedef struct {
+    float arrivals;             // Cars per hour (EMA over weeks)
+    float departures;
+    uint8_t samples;            // Hours folded in, saturating
+} ForecastBucket;
+
+typedef struct {
+    uint32_t version;
+    ForecastBucket buckets[FORECAST_DAYS][FORECAST_HOURS];
+} ForecastModel;
+
+static portMUX_TYPE modelLock = portMUX_INITIALIZER_UNLOCKED;
+static ForecastModel model;
+
+// Written by the gate tasks, drained by forecastMaintain
+static volatile uint32_t pendingArrivals = 0;
+static volatile uint32_t pendingDepartures = 0;
+static volatile uint32_t carEvents = 0;
+
+// Hour being counted (wifiTask only)
+static uint32_t currentHour = 0;            // Local epoch / 3600, 0 = none yet
+static uint32_t observedSince = 0;
+static uint32_t hourArrivals = 0;
+static uint32_t hourDepartures = 0;
+
+// Last estimate; valid while the key matches (modelLock)
+typedef struct {
+    uint32_t carEvents;
+    uint32_t modelUpdates;
+    int walkInFree;
+    uint32_t hour;
+} CacheKey;
+
+static uint32_t modelUpdates = 0;
+static bool cacheValid = false;
+static CacheKey cacheKey;
+static ForecastResult cached;
+static uint32_t cachedFullAt = 0;           // Local epoch; 0 = not within the horizon
+
+// ============================================================================
+// Model
+// ============================================================================
+
+static inline ForecastBucket *bucketAt(uint32_t localEpoch) {
+    uint32_t days = localEpoch / 86400;
+    return &model.buckets[(days + 4) % FORECAST_DAYS][localEpoch / 3600 % FORECAST_HOURS];    // 1970-01-01 was a Thursday
+}
+
+/**
+ * @brief One EMA step for a finished hour; the first sample is taken as is
+ */
+static void foldHour(uint32_t hour, float arrivals, float departures) {
+    portENTER_CRITICAL(&modelLock);
+    ForecastBucket *bucket = bucketAt(hour * 3600);
+    if(bucket->samples == 0) {
+        bucket->arrivals = arrivals;
+        bucket->departures = departures;
+    } else {
+        bucket->arrivals += FORECAST_EMA_ALPHA * (arrivals - bucket->arrivals);
+        bucket->departures += FORECAST_EMA_ALPHA * (departures - bucket->departures);
+    }
+    if(bucket->samples < UINT8_MAX) bucket->samples++;
+    modelUpdates++;
+    portEXIT_CRITICAL(&modelLock);
+}
+
+/**
+ * @brief Rates for an hour: its own bucket, else the mean of the same
+ *        hour on the weekdays that have data (caller holds modelLock)
+ * @return false if that hour has never been seen
+ */
+static bool ratesAt(uint32_t localEpoch, float *arrivals, float *departures) {
+    const ForecastBucket *bucket = bucketAt(localEpoch);
+    if(bucket->samples > 0) {
+        *arrivals = bucket->arrivals;
+        *departures = bucket->departures;
+        return true;
+    }
+
+    uint32_t hour = localEpoch / 3600 % FORECAST_HOURS;
+    float arrivalSum = 0;
+    float departureSum = 0;
+    int seen = 0;
+    for(int day = 0; day < FORECAST_DAYS; day++) {
+        if(model.buckets[day][hour].samples == 0) continue;
+        arrivalSum += model.buckets[day][hour].arrivals;
+        departureSum += model.buckets[day][hour].departures;
+        seen++;
+    }
+    if(seen == 0) return false;
+    *arrivals = arrivalSum / seen;
+    *departures = departureSum / seen;
+    return true;
+}
+
+static void saveModel() {
+    static ForecastModel copy;      // 2 KB, too big for wifiTask's stack
+    Preferences prefs;
+
+    portENTER_CRITICAL(&modelLock);
+    copy = model;
+    portEXIT_CRITICAL(&modelLock);
+
+    if(!prefs.begin("forecast", false)) return;
+    prefs.putBytes("model", &copy, sizeof(copy));
+    prefs.end();
+}
+
+// ============================================================================
+// Estimate
+// ============================================================================
+
+/**
+ * @brief Walk the hours ahead until the expected net inflow uses up the
+ *        free slots (caller holds modelLock)
+ * @return Local epoch when the lot is expected full, 0 if not within
+ *         FORECAST_HORIZON_H or some hour has no data
+ */
+static uint32_t predictFullAt(uint32_t now, int walkInFree, int capacity, ForecastResult *out) {
+    float free = walkInFree;
+    uint32_t t = now;
+
+    out->ready = ratesAt(now, &out->arrivalsPerHour, &out->departuresPerHour);
+    if(!out->ready) return 0;
+
+    while(t < now + FORECAST_HORIZON_H * 3600) {
+        float arrivals;
+        float departures;
+        if(!ratesAt(t, &arrivals, &departures)) {
+            out->ready = false;
+            return 0;
+        }
+
+        uint32_t secondsLeft = 3600 - t % 3600;
+        float net = arrivals - departures;
+        if(net > 0 && free <= net * secondsLeft / 3600) {
+            return t + (uint32_t)(free / net * 3600);
+        }
+        free -= net * secondsLeft / 3600;
+        if(free > capacity) free = capacity;
+        t += secondsLeft;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void forecastBegin() {
+    Preferences prefs;
+    int learned = 0;
+
+    memset(&model, 0, sizeof(model));
+    if(prefs.begin("forecast", true)) {
+        if(prefs.getBytesLength("model") == sizeof(model)) prefs.getBytes("model", &model, sizeof(model));
+        prefs.end();
+    }
+    if(model.version != FORECAST_VERSION) {
+        memset(&model, 0, sizeof(model));
+        model.version = FORECAST_VERSION;
+    }
+
+    for(int day = 0; day < FORECAST_DAYS; day++) {
+        for(int hour = 0; hour < FORECAST_HOURS; hour++) learned += model.buckets[day][hour].samples > 0;
+    }
+    Serial.printf("[Forecast] %d/%d weekday-hours learned\n", learned, FORECAST_DAYS * FORECAST_HOURS);
+}
+
+void forecastRecord(EventType type) {
+    if(type == EVENT_CAR_ENTRY) __atomic_fetch_add(&pendingArrivals, 1, __ATOMIC_RELAXED);
+    else if(type == EVENT_CAR_EXIT) __atomic_fetch_add(&pendingDepartures, 1, __ATOMIC_RELAXED);
+    else return;
+    __atomic_fetch_add(&carEvents, 1, __ATOMIC_RELAXED);
+}
+
+void forecastMaintain() {
+    uint32_t arrivals = __atomic_exchange_n(&pendingArrivals, 0, __ATOMIC_RELAXED);
+    uint32_t departures = __atomic_exchange_n(&pendingDepartures, 0, __ATOMIC_RELAXED);
+
+    // Cars seen before the clock is set cannot be placed in an hour
+    if(!timeServiceValid()) return;
+
+    uint32_t now = timeServiceNow();
+    uint32_t hour = now / 3600;
+    if(currentHour == 0) {
+        currentHour = hour;
+        observedSince = now;
+    }
+
+    if(hour != currentHour) {
+        // Cars counted since the last call fall into the new hour; it is
+        // at most one wifiTask period of them
+        bool contiguous = hour == currentHour + 1;
+        uint32_t hourEnd = (currentHour + 1) * 3600;
+        uint32_t observed = hourEnd > observedSince ? hourEnd - observedSince : 0;
+        if(contiguous && observed >= FORECAST_MIN_OBSERVED_SEC) {
+            float scale = 3600.0f / (observed < 3600 ? observed : 3600);
+            foldHour(currentHour, hourArrivals * scale, hourDepartures * scale);
+            saveModel();
+        }
+        // After a gap (clock stepped, task stalled) the new hour is only
+        // watched from now on
+        currentHour = hour;
+        observedSince = contiguous ? hour * 3600 : now;
+        hourArrivals = 0;
+        hourDepartures = 0;
+    }
+    hourArrivals += arrivals;
+    hourDepartures += departures;
+}
+
+void forecastGet(ForecastResult *out) {
+    ParkingState state;
+    CacheKey key;
+
+    parkingStateRead(&state);
+    uint32_t now = timeServiceValid() ? timeServiceNow() : 0;
+
+    key.carEvents = carEvents;
+    key.walkInFree = state.availableSlots - state.reservedSlots;
+    key.hour = now / 3600;
+
+    portENTER_CRITICAL(&modelLock);
+    key.modelUpdates = modelUpdates;
+    // A passed deadline with slots still free means the rates were off
+    bool stale = !cacheValid || memcmp(&key, &cacheKey, sizeof(key)) != 0 || (cachedFullAt != 0 && now >= cachedFullAt);
+    if(stale && now != 0) {
+        if(key.walkInFree > 0) {
+            cachedFullAt = predictFullAt(now, key.walkInFree, state.totalSlots - state.reservedSlots, &cached);
+        } else {
+            ratesAt(now, &cached.arrivalsPerHour, &cached.departuresPerHour);
+            cached.ready = true;
+            cachedFullAt = now;
+        }
+        cacheKey = key;
+        cacheValid = true;
+    }
+    *out = cached;
+    uint32_t fullAt = cachedFullAt;
+    portEXIT_CRITICAL(&modelLock);
+
+    if(now == 0) {
+        out->ready = false;
+        out->minutesToFull = -1;
+    } else if(key.walkInFree <= 0) {
+        out->minutesToFull = 0;
+    } else {
+        out->minutesToFull = (fullAt != 0 && out->ready) ? (fullAt - now + 59) / 60 : -1;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file gate_flow.cpp
+ * @brief Entry/exit path from a lane event to a barrier action
+ */
+
+#include "gate_flow.h"
+#include "parking_state.h"
+#include "lane.h"
+#include "config.h"
+
+#ifndef GATE_OPEN_TIME_MS
+    #define GATE_OPEN_TIME_MS 2000
+#endif
+#ifndef GATE_CLEAR_GUARD_MS
+    #define GATE_CLEAR_GUARD_MS 300
+#endif
+
+static const GateFlowHooks *hooks = NULL;
+static GateFsm fsms[LANE_MAX];
+static uint8_t waitingLanes[LANE_MAX];     // Bits (1 << lane) of granted cars still in the beam
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int64_t actuate(int barrier, GateAction action) {
+    if(action == GATE_ACTION_CLOSE) waitingLanes[barrier] = 0;     // Hold expired with a car still in the beam
+    return action == GATE_ACTION_NONE ? 0 : hooks->actuate(barrier, action);
+}
+
+static void decide(const SystemEvent *event, TraceOutcome outcome, int64_t actuatedUs) {
+    traceRecord(event, actuatedUs, outcome);
+    if(hooks->decided != NULL) hooks->decided(event, outcome, actuatedUs);
+}
+
+/**
+ * @brief Hand a car whose slot is settled to its lane's barrier
+ */
+static TraceOutcome admit(int lane, const SystemEvent *event, uint32_t nowMs) {
+    int barrier = laneBarrier(lane);
+    GateAction action = gateFsmRequest(&fsms[barrier], nowMs);
+
+    waitingLanes[barrier] |= 1 << lane;
+    int64_t actuatedUs = actuate(barrier, action);
+    TraceOutcome outcome = action == GATE_ACTION_OPEN ? TRACE_OPENED : TRACE_HELD;
+    decide(event, outcome, outcome == TRACE_OPENED ? actuatedUs : 0);
+    return outcome;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void gateFlowBegin(const GateFlowHooks *gateHooks, uint32_t travelMs) {
+    hooks = gateHooks;
+    for(int b = 0; b < laneBarrierCount(); b++) {
+        gateFsmInit(&fsms[b], travelMs, GATE_OPEN_TIME_MS, GATE_CLEAR_GUARD_MS);
+        waitingLanes[b] = 0;
+    }
+}
+
+const GateFsm *gateFlowFsm(int barrier) {
+    return &fsms[barrier];
+}
+
+TraceOutcome gateFlowEntry(int lane, const SystemEvent *event, uint32_t nowMs) {
+    int remaining;
+
+    // Take the slot now, not after the gate closes, so entries on
+    // parallel lanes can never oversell the lot. A booking is only
+    // consumed once its car has the slot; turned away, it stays checked in
+    bool reserved = hooks->reservationWaiting != NULL && hooks->reservationWaiting(lane);
+    bool usedHold = false;
+    bool taken = reserved ? parkingStateTakeHeldSlot(&remaining, &usedHold) : parkingStateTakeSlot(&remaining);
+    if(taken && reserved && !hooks->claimReservation(lane)) {
+        // Cancelled or expired meanwhile, and that already dropped its
+        // hold: put back the one just used so other bookings keep theirs
+        if(usedHold) parkingStateRestoreHeldSlot();
+        reserved = false;
+    }
+    if(!taken) {
+        hooks->counted(lane, EVENT_PARKING_FULL, reserved, remaining);
+        decide(event, TRACE_DENIED, 0);
+        return TRACE_DENIED;
+    }
+
+    hooks->counted(lane, EVENT_CAR_ENTRY, reserved, remaining);
+    return admit(lane, event, nowMs);
+}
+
+TraceOutcome gateFlowExit(int lane, const SystemEvent *event, uint32_t nowMs) {
+    int remaining;
+
+    parkingStateReleaseSlot(&remaining);
+    hooks->counted(lane, EVENT_CAR_EXIT, false, remaining);
+    return admit(lane, event, nowMs);
+}
+
+void gateFlowBeamClear(int lane, uint32_t nowMs) {
+    int barrier = laneBarrier(lane);
+    uint8_t bit = 1 << lane;
+
+    // Denied cars, and cars whose hold already expired, never set the bit
+    if(!(waitingLanes[barrier] & bit)) return;
+
+    waitingLanes[barrier] &= ~bit;
+    if(waitingLanes[barrier] == 0) gateFsmRelease(&fsms[barrier], nowMs);
+}
+
+void gateFlowRemoteOpen(int barrier, uint32_t nowMs) {
+    // No lane bit is set: nothing in the beam is waiting for this opening
+    actuate(barrier, gateFsmRequest(&fsms[barrier], nowMs));
+}
+
+void gateFlowTick(int barrier, uint32_t nowMs) {
+    actuate(barrier, gateFsmTick(&fsms[barrier], nowMs));
+}
@@ -0,0 +1,91 @@
+/**
+ * @file gate_fsm.cpp
+ * @brief Timer-driven barrier state machine
+ */
+
+#include "gate_fsm.h"
+
+/**
+ * @brief Wrap-safe "now has reached deadline" check
+ */
+static inline bool reached(uint32_t nowMs, uint32_t deadlineMs) {
+    return (int32_t)(nowMs - deadlineMs) >= 0;
+}
+
+void gateFsmInit(GateFsm *fsm, uint32_t travelMs, uint32_t holdMs, uint32_t guardMs) {
+    fsm->state = GATE_IDLE;
+    fsm->deadlineMs = 0;
+    fsm->travelMs = travelMs;
+    fsm->holdMs = holdMs;
+    fsm->guardMs = guardMs;
+    fsm->released = false;
+}
+
+GateAction gateFsmRequest(GateFsm *fsm, uint32_t nowMs) {
+    fsm->released = false;
+
+    switch(fsm->state) {
+        case GATE_IDLE:
+        case GATE_CLOSING:
+            fsm->state = GATE_OPENING;
+            fsm->deadlineMs = nowMs + fsm->travelMs;
+            return GATE_ACTION_OPEN;
+
+        case GATE_OPEN:
+            fsm->deadlineMs = nowMs + fsm->holdMs;
+            return GATE_ACTION_NONE;
+
+        case GATE_OPENING:
+        default:
+            // Hold time starts once the barrier is fully up
+            return GATE_ACTION_NONE;
+    }
+}
+
+void gateFsmRelease(GateFsm *fsm, uint32_t nowMs) {
+    fsm->released = true;
+
+    uint32_t closeAt = nowMs + fsm->guardMs;
+    if(fsm->state == GATE_OPEN && (int32_t)(fsm->deadlineMs - closeAt) > 0) {
+        fsm->deadlineMs = closeAt;
+    }
+}
+
+GateAction gateFsmTick(GateFsm *fsm, uint32_t nowMs) {
+    if(fsm->state == GATE_IDLE || !reached(nowMs, fsm->deadlineMs)) {
+        return GATE_ACTION_NONE;
+    }
+
+    switch(fsm->state) {
+        case GATE_OPENING:
+            fsm->state = GATE_OPEN;
+            fsm->deadlineMs = nowMs + (fsm->released ? fsm->guardMs : fsm->holdMs);
+            return GATE_ACTION_NONE;
+
+        case GATE_OPEN:
+            fsm->state = GATE_CLOSING;
+            fsm->deadlineMs = nowMs + fsm->travelMs;
+            return GATE_ACTION_CLOSE;
+
+        case GATE_CLOSING:
+        default:
+            fsm->state = GATE_IDLE;
+            return GATE_ACTION_NONE;
+    }
+}
+
+int32_t gateFsmTimeToNext(const GateFsm *fsm, uint32_t nowMs) {
+    if(fsm->state == GATE_IDLE) return -1;
+    int32_t remaining = (int32_t)(fsm->deadlineMs - nowMs);
+    return remaining > 0 ? remaining : 0;
+}
+
+const char *gateStateName(GateState state) {
+    switch(state) {
+        case GATE_OPENING: return "Opening";
+        case GATE_OPEN:    return "Open";
+        case GATE_CLOSING: return "Closing";
+        case GATE_IDLE:
+        default:           return "Closed";
+    }
+}
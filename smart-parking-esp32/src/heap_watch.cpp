@@ -0,0 +1,121 @@
+/**
+ * @file heap_watch.cpp
+ * @brief Heap-fragmentation watch
+ */
+
+#include "heap_watch.h"
+#include "config.h"
+#include "telegram_outbox.h"
+#include <esp_heap_caps.h>
+
+#ifndef MEM_SAMPLE_INTERVAL_MS
+    #define MEM_SAMPLE_INTERVAL_MS 60000
+#endif
+#ifndef MEM_TREND_SAMPLES
+    #define MEM_TREND_SAMPLES 60
+#endif
+#ifndef MEM_FRAG_ALERT_BYTES
+    #define MEM_FRAG_ALERT_BYTES 20480
+#endif
+
+static_assert(MEM_TREND_SAMPLES >= 2, "trend needs two samples");
+
+#define MEM_HEAP_CAPS MALLOC_CAP_8BIT
+
+// ============================================================================
+// Heap Watch
+// ============================================================================
+
+static uint32_t largestSamples[MEM_TREND_SAMPLES];
+static uint16_t sampleHead = 0;         // Next slot to write
+static uint16_t sampleCount = 0;
+static uint32_t lastSampleMs = 0;
+static uint32_t minLargestBlock = UINT32_MAX;
+static bool fragmented = false;
+
+static volatile uint32_t failedAllocs = 0;
+static volatile uint32_t largestFailedAlloc = 0;
+
+/**
+ * @brief Called by the heap for every request it could not serve
+ *
+ * Runs in the failing caller's context, possibly inside a library, so it
+ * only counts; the report goes out from heapWatchMaintain().
+ */
+static void onAllocFailed(size_t size, uint32_t caps, const char *functionName) {
+    __atomic_add_fetch(&failedAllocs, 1, __ATOMIC_RELAXED);
+    if(size > largestFailedAlloc) largestFailedAlloc = size;
+}
+
+static void takeSample() {
+    uint32_t largest = heap_caps_get_largest_free_block(MEM_HEAP_CAPS);
+
+    largestSamples[sampleHead] = largest;
+    sampleHead = (sampleHead + 1) % MEM_TREND_SAMPLES;
+    if(sampleCount < MEM_TREND_SAMPLES) sampleCount++;
+    if(largest < minLargestBlock) minLargestBlock = largest;
+    lastSampleMs = millis();
+}
+
+/**
+ * @brief Raise the alert below the threshold, clear it a quarter above
+ */
+static void checkFragmentation() {
+    uint32_t largest = largestSamples[(sampleHead + MEM_TREND_SAMPLES - 1) % MEM_TREND_SAMPLES];
+    uint32_t freeBytes = heap_caps_get_free_size(MEM_HEAP_CAPS);
+
+    if(!fragmented && largest < MEM_FRAG_ALERT_BYTES) {
+        char msg[160];
+        fragmented = true;
+        Serial.printf("[Mem] Heap fragmented: largest block %lu B of %lu B free\n",
+                      (unsigned long)largest, (unsigned long)freeBytes);
+        snprintf(msg, sizeof(msg), "*⚠️ Heap fragmented*\n\nLargest free block %lu B of %lu B free; TLS sessions may fail.",
+                 (unsigned long)largest, (unsigned long)freeBytes);
+        telegramAlert(TELEGRAM_TOPIC_SYSTEM, msg);
+    } else if(fragmented && largest >= MEM_FRAG_ALERT_BYTES + MEM_FRAG_ALERT_BYTES / 4) {
+        fragmented = false;
+        Serial.printf("[Mem] Heap recovered: largest block %lu B\n", (unsigned long)largest);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void heapWatchBegin() {
+    heap_caps_register_failed_alloc_callback(onAllocFailed);
+    takeSample();
+}
+
+void heapWatchMaintain() {
+    if(millis() - lastSampleMs < MEM_SAMPLE_INTERVAL_MS) return;
+    takeSample();
+    checkFragmentation();
+}
+
+void heapWatchReport(const char *when) {
+    Serial.printf("[Mem] %s: heap %lu B free, largest block %lu B, min free %lu B\n",
+                  when,
+                  (unsigned long)heap_caps_get_free_size(MEM_HEAP_CAPS),
+                  (unsigned long)heap_caps_get_largest_free_block(MEM_HEAP_CAPS),
+                  (unsigned long)heap_caps_get_minimum_free_size(MEM_HEAP_CAPS));
+}
+
+void heapWatchStats(HeapStats *out) {
+    out->freeBytes = heap_caps_get_free_size(MEM_HEAP_CAPS);
+    out->minFreeBytes = heap_caps_get_minimum_free_size(MEM_HEAP_CAPS);
+    out->largestBlock = heap_caps_get_largest_free_block(MEM_HEAP_CAPS);
+    out->minLargestBlock = minLargestBlock < out->largestBlock ? minLargestBlock : out->largestBlock;
+    out->failedAllocs = failedAllocs;
+    out->largestFailedAlloc = largestFailedAlloc;
+    out->fragmented = fragmented;
+
+    // Oldest to newest sample over the window; samples are evenly spaced
+    out->largestTrendPerHour = 0;
+    if(sampleCount >= 2) {
+        uint32_t newest = largestSamples[(sampleHead + MEM_TREND_SAMPLES - 1) % MEM_TREND_SAMPLES];
+        uint32_t oldest = largestSamples[(sampleHead + MEM_TREND_SAMPLES - sampleCount) % MEM_TREND_SAMPLES];
+        int64_t spanMs = (int64_t)(sampleCount - 1) * MEM_SAMPLE_INTERVAL_MS;
+        out->largestTrendPerHour = (int32_t)(((int64_t)newest - oldest) * 3600000 / spanMs);
+    }
+}
@@ -0,0 +1,248 @@
+/**
+ * @file history.cpp
+ * @brief On-device downsampled time series for /history
+ */
+
+#include "history.h"
+#include "parking_state.h"
+#include "time_service.h"
+#include "config.h"
+#include <esp_timer.h>
+
+#ifndef HISTORY_FINE_PERIOD_SEC
+    #define HISTORY_FINE_PERIOD_SEC 60
+#endif
+#ifndef HISTORY_FINE_COUNT
+    #define HISTORY_FINE_COUNT 1440
+#endif
+#ifndef HISTORY_COARSE_FACTOR
+    #define HISTORY_COARSE_FACTOR 15
+#endif
+#ifndef HISTORY_COARSE_COUNT
+    #define HISTORY_COARSE_COUNT 2880
+#endif
+
+#define HISTORY_FLAG_UPTIME 0x01    // Times are uptime seconds
+#define HISTORY_COPY_BATCH 32       // Samples copied per critical section
+
+static_assert(sizeof(HistorySample) == 8, "HistorySample must stay 8 bytes");
+
+typedef struct {
+    HistorySample *samples;
+    uint32_t capacity;
+    uint32_t periodSec;
+    uint32_t total;             // Samples ever written; newest is total - 1
+    uint32_t lastEndUptime;     // Uptime (s) at the end of the newest bucket
+} HistoryTier;
+
+static HistorySample fineSamples[HISTORY_FINE_COUNT];
+static HistorySample coarseSamples[HISTORY_COARSE_COUNT];
+
+static HistoryTier tiers[] = {
+    { fineSamples,   HISTORY_FINE_COUNT,   HISTORY_FINE_PERIOD_SEC,                         0, 0 },
+    { coarseSamples, HISTORY_COARSE_COUNT, HISTORY_FINE_PERIOD_SEC * HISTORY_COARSE_FACTOR, 0, 0 },
+};
+#define TIER_COUNT (sizeof(tiers) / sizeof(tiers[0]))
+
+static portMUX_TYPE historyLock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t sampleTimer = NULL;
+static volatile uint32_t gateCycles = 0;
+
+// Running sums for the open fine bucket (esp_timer task only)
+static struct {
+    uint32_t seconds;
+    uint32_t occupiedSum;
+    uint16_t occupiedMax;
+    float temperatureSum;
+    float humiditySum;
+    uint32_t gateCyclesAtStart;
+} acc;
+
+// ============================================================================
+// Sampling
+// ============================================================================
+
+static inline uint8_t saturate8(uint32_t v) {
+    return v > 255 ? 255 : (uint8_t)v;
+}
+
+static void pushSample(HistoryTier *tier, const HistorySample *sample, uint32_t endUptime) {
+    portENTER_CRITICAL(&historyLock);
+    tier->samples[tier->total % tier->capacity] = *sample;
+    tier->total++;
+    tier->lastEndUptime = endUptime;
+    portEXIT_CRITICAL(&historyLock);
+}
+
+/**
+ * @brief Merge the newest HISTORY_COARSE_FACTOR fine buckets
+ */
+static void closeCoarse(uint32_t endUptime) {
+    HistoryTier *fine = &tiers[0];
+    uint32_t occupiedSum = 0, cycles = 0;
+    int32_t temperatureSum = 0;
+    uint32_t humiditySum = 0;
+    HistorySample merged = { 0, 0, 0, 0, 0 };
+
+    // Only the esp_timer task writes the fine ring, so no lock is needed to read it here
+    for(uint32_t i = 0; i < HISTORY_COARSE_FACTOR; i++) {
+        const HistorySample *s = &fine->samples[(fine->total - 1 - i) % fine->capacity];
+        occupiedSum += s->occupiedAvg10;
+        temperatureSum += s->temperature10;
+        humiditySum += s->humidity2;
+        cycles += s->gateCycles;
+        if(s->occupiedMax > merged.occupiedMax) merged.occupiedMax = s->occupiedMax;
+    }
+
+    merged.occupiedAvg10 = occupiedSum / HISTORY_COARSE_FACTOR;
+    merged.temperature10 = temperatureSum / HISTORY_COARSE_FACTOR;
+    merged.humidity2 = humiditySum / HISTORY_COARSE_FACTOR;
+    merged.gateCycles = saturate8(cycles);
+    pushSample(&tiers[1], &merged, endUptime);
+}
+
+/**
+ * @brief 1 s esp_timer callback: accumulate, close buckets when due
+ */
+static void onSampleTimer(void *arg) {
+    ParkingState state;
+    parkingStateRead(&state);
+
+    uint16_t occupied = state.totalSlots - state.availableSlots;
+    acc.occupiedSum += occupied;
+    if(occupied > acc.occupiedMax) acc.occupiedMax = occupied;
+    acc.temperatureSum += state.temperature;
+    acc.humiditySum += state.humidity;
+
+    if(++acc.seconds < HISTORY_FINE_PERIOD_SEC) return;
+
+    uint32_t cycles = gateCycles;
+    HistorySample sample;
+    sample.occupiedAvg10 = (acc.occupiedSum * 10 + acc.seconds / 2) / acc.seconds;
+    sample.occupiedMax = acc.occupiedMax;
+    sample.temperature10 = (int16_t)lroundf(acc.temperatureSum * 10 / acc.seconds);
+    sample.humidity2 = saturate8(lroundf(acc.humiditySum * 2 / acc.seconds));
+    sample.gateCycles = saturate8(cycles - acc.gateCyclesAtStart);
+
+    uint32_t endUptime = esp_timer_get_time() / 1000000LL;
+    pushSample(&tiers[0], &sample, endUptime);
+    if(tiers[0].total % HISTORY_COARSE_FACTOR == 0) closeCoarse(endUptime);
+
+    memset(&acc, 0, sizeof(acc));
+    acc.gateCyclesAtStart = cycles;
+}
+
+// ============================================================================
+// Streaming
+// ============================================================================
+
+static const HistoryTier *selectTier(uint32_t resolutionSec) {
+    for(size_t i = 0; i < TIER_COUNT; i++) {
+        if(tiers[i].periodSec >= resolutionSec) return &tiers[i];
+    }
+    return &tiers[TIER_COUNT - 1];
+}
+
+const char *historyContentType(const HistoryQuery *query) {
+    return query->binary ? "application/octet-stream" : "text/csv";
+}
+
+bool historyStream(const HistoryQuery *query, ChunkSink sink, void *ctx) {
+    static ChunkWriter out;     // One /history request at a time per server task
+    const HistoryTier *tier = selectTier(query->resolutionSec);
+    uint32_t total, lastEndUptime;
+
+    portENTER_CRITICAL(&historyLock);
+    total = tier->total;
+    lastEndUptime = tier->lastEndUptime;
+    portEXIT_CRITICAL(&historyLock);
+
+    // Report wall-clock times when we can, uptime otherwise
+    uint32_t bootEpoch = timeServiceBootEpoch();
+    uint32_t lastEnd = lastEndUptime + bootEpoch;
+    uint8_t flags = bootEpoch ? 0 : HISTORY_FLAG_UPTIME;
+
+    // Sample n ends at lastEnd - (total - 1 - n) * period
+    uint32_t oldest = total > tier->capacity ? total - tier->capacity : 0;
+    uint32_t first = oldest, end = total;
+    if(query->from) {
+        while(first < end && lastEnd - (total - 1 - first) * tier->periodSec < query->from) first++;
+    }
+    if(query->to) {
+        while(end > first && lastEnd - (total - end) * tier->periodSec > query->to) end--;
+    }
+
+    chunkWriterInit(&out, sink, ctx);
+
+    uint32_t firstTime = lastEnd - (total - 1 - first) * tier->periodSec;
+    if(query->binary) {
+        uint8_t header[16] = { 'P', 'K', 'H', '1' };
+        uint16_t period = tier->periodSec;
+        uint16_t count = end - first;
+        memcpy(header + 4, &period, 2);
+        memcpy(header + 6, &count, 2);
+        memcpy(header + 8, &firstTime, 4);
+        header[12] = flags;
+        chunkWrite(&out, header, sizeof(header));
+    } else {
+        chunkPrintf(&out, "# period=%lu clock=%s\ntime,occupied_avg,occupied_max,gate_cycles,temperature,humidity\n",
+                    (unsigned long)tier->periodSec, bootEpoch ? "epoch" : "uptime");
+    }
+
+    HistorySample chunk[HISTORY_COPY_BATCH];
+    for(uint32_t n = first; n < end && out.ok; ) {
+        uint32_t count = end - n < HISTORY_COPY_BATCH ? end - n : HISTORY_COPY_BATCH;
+
+        // Samples overwritten since the snapshot are skipped, never torn
+        portENTER_CRITICAL(&historyLock);
+        uint32_t valid = tier->total > tier->capacity ? tier->total - tier->capacity : 0;
+        for(uint32_t i = 0; i < count; i++) chunk[i] = tier->samples[(n + i) % tier->capacity];
+        portEXIT_CRITICAL(&historyLock);
+
+        for(uint32_t i = 0; i < count; i++) {
+            if(n + i < valid) continue;
+            if(query->binary) {
+                chunkWrite(&out, &chunk[i], sizeof(HistorySample));
+            } else {
+                const HistorySample *s = &chunk[i];
+                chunkPrintf(&out, "%lu,%u.%u,%u,%u,%.1f,%.1f\n",
+                            (unsigned long)(lastEnd - (total - 1 - (n + i)) * tier->periodSec),
+                            s->occupiedAvg10 / 10, s->occupiedAvg10 % 10, s->occupiedMax,
+                            s->gateCycles, s->temperature10 / 10.0f, s->humidity2 / 2.0f);
+            }
+        }
+        n += count;
+    }
+
+    return chunkFlush(&out);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void historyBegin() {
+    const esp_timer_create_args_t args = {
+        .callback = onSampleTimer,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "history",
+        .skip_unhandled_events = true,
+    };
+
+    memset(&acc, 0, sizeof(acc));
+    if(esp_timer_create(&args, &sampleTimer) != ESP_OK ||
+       esp_timer_start_periodic(sampleTimer, 1000000) != ESP_OK) {
+        Serial.println("[History] Failed to start sampling timer");
+        return;
+    }
+    Serial.printf("[History] %lu x %lus + %lu x %lus buckets\n",
+                  (unsigned long)tiers[0].capacity, (unsigned long)tiers[0].periodSec,
+                  (unsigned long)tiers[1].capacity, (unsigned long)tiers[1].periodSec);
+}
+
+void historyCountGateCycle() {
+    portENTER_CRITICAL(&historyLock);
+    gateCycles = gateCycles + 1;
+    portEXIT_CRITICAL(&historyLock);
+}
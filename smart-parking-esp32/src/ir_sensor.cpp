@@ -0,0 +1,189 @@
+/**
+ * @file ir_sensor.cpp
+ * @brief Interrupt-driven IR beam sensing with software debounce
+ */
+
+#include "ir_sensor.h"
+#include "config.h"
+#include "soc/gpio_reg.h"
+
+#ifndef IR_DEBOUNCE_US
+    #define IR_DEBOUNCE_US 5000
+#endif
+#ifndef IR_EDGE_BUFFER_SIZE
+    #define IR_EDGE_BUFFER_SIZE 16
+#endif
+#ifndef POWER_SAVE_MODE
+    #define POWER_SAVE_MODE 0
+#endif
+
+#if POWER_SAVE_MODE
+    // Edge interrupts cannot wake light sleep; level interrupts re-armed
+    // for the opposite level after every edge behave like CHANGE and can
+    // wake the chip from light sleep
+    #include "hal/gpio_ll.h"
+    #define IR_WAKE_ON_LEVEL 1
+#else
+    #define IR_WAKE_ON_LEVEL 0
+#endif
+
+static_assert((IR_EDGE_BUFFER_SIZE & (IR_EDGE_BUFFER_SIZE - 1)) == 0,
+              "IR_EDGE_BUFFER_SIZE must be a power of two");
+
+// ============================================================================
+// Shared State (ISR producer, sensor task consumer)
+// ============================================================================
+static DRAM_ATTR uint8_t channelPins[IR_MAX_CHANNELS];
+static int channelCount = 0;
+
+static IrEdge edgeRing[IR_EDGE_BUFFER_SIZE];
+static volatile uint32_t ringHead = 0;   // Written by the ISR only
+static volatile uint32_t ringTail = 0;   // Written by the sensor task only
+static volatile uint32_t droppedEdges = 0;
+static TaskHandle_t taskToWake = NULL;
+
+static IrDebounce debouncers[IR_MAX_CHANNELS];
+
+// ============================================================================
+// ISR
+// ============================================================================
+
+/**
+ * @brief Read a GPIO input straight from the register (safe in an ISR)
+ */
+static inline uint8_t IRAM_ATTR readPinFast(uint8_t pin) {
+    if(pin < 32) return (REG_READ(GPIO_IN_REG) >> pin) & 0x1;
+    return (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 0x1;
+}
+
+/**
+ * @brief Edge interrupt - timestamp, enqueue, wake the sensor task
+ */
+static void IRAM_ATTR irEdgeISR(void *arg) {
+    uint8_t channel = (uint8_t)(uintptr_t)arg;
+    uint8_t level = readPinFast(channelPins[channel]);
+    uint32_t head = ringHead;
+
+#if IR_WAKE_ON_LEVEL
+    // Arm for the other level; if the pin has already gone back, this
+    // fires again at once and the new level is queued as its own edge
+    gpio_ll_set_intr_type(&GPIO, (gpio_num_t)channelPins[channel],
+                          level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+#endif
+
+    if(head - ringTail >= IR_EDGE_BUFFER_SIZE) {
+        droppedEdges++;
+    } else {
+        IrEdge *slot = &edgeRing[head & (IR_EDGE_BUFFER_SIZE - 1)];
+        slot->channel = channel;
+        slot->level = level;
+        slot->timeUs = esp_timer_get_time();
+        __sync_synchronize();
+        ringHead = head + 1;
+    }
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(taskToWake, &woken);
+    if(woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+// ============================================================================
+// Debounce
+// ============================================================================
+
+bool irDebounceFeed(IrDebounce *d, bool blocked, int64_t timeUs, int64_t windowUs) {
+    if(timeUs - d->lastChangeUs < windowUs) {
+        d->pending = true;
+        return false;
+    }
+    if(blocked == d->blocked) return false;
+
+    d->blocked = blocked;
+    d->lastChangeUs = timeUs;
+    d->pending = false;
+    return true;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void irSensorBegin(const uint8_t *pins, int count, TaskHandle_t notifyTask) {
+    taskToWake = notifyTask;
+    channelCount = count < IR_MAX_CHANNELS ? count : IR_MAX_CHANNELS;
+    int64_t now = esp_timer_get_time();
+
+    for(int c = 0; c < channelCount; c++) {
+        channelPins[c] = pins[c];
+        pinMode(channelPins[c], INPUT);
+        // Start "clear" with a resample pending, so a car already in the
+        // beam at boot is still reported (same as the polling loop did)
+        debouncers[c].blocked = false;
+        debouncers[c].pending = true;
+        debouncers[c].lastChangeUs = now - IR_DEBOUNCE_US;
+#if IR_WAKE_ON_LEVEL
+        int mode = digitalRead(channelPins[c]) ? ONLOW_WE : ONHIGH_WE;
+#else
+        int mode = CHANGE;
+#endif
+        attachInterruptArg(digitalPinToInterrupt(channelPins[c]), irEdgeISR,
+                           (void *)(uintptr_t)c, mode);
+    }
+
+    Serial.printf("[Sensor] ISR mode, %d channels, debounce %d us%s\n", channelCount, IR_DEBOUNCE_US,
+                  IR_WAKE_ON_LEVEL ? ", wakes from light sleep" : "");
+}
+
+bool irSensorPoll(IrEdge *edge) {
+    while(ringTail != ringHead) {
+        IrEdge raw = edgeRing[ringTail & (IR_EDGE_BUFFER_SIZE - 1)];
+        __sync_synchronize();
+        ringTail = ringTail + 1;
+
+        if(irDebounceFeed(&debouncers[raw.channel], raw.level == LOW, raw.timeUs, IR_DEBOUNCE_US)) {
+            *edge = raw;
+            return true;
+        }
+    }
+
+    // Settle channels that bounced inside their window
+    int64_t now = esp_timer_get_time();
+    for(int c = 0; c < channelCount; c++) {
+        IrDebounce *d = &debouncers[c];
+        if(!d->pending || now - d->lastChangeUs < IR_DEBOUNCE_US) continue;
+
+        d->pending = false;
+        bool blocked = (digitalRead(channelPins[c]) == LOW);
+        if(blocked != d->blocked) {
+            d->blocked = blocked;
+            d->lastChangeUs = now;
+            edge->channel = c;
+            edge->level = blocked ? LOW : HIGH;
+            edge->timeUs = now;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+TickType_t irSensorNextTimeout() {
+    int64_t now = esp_timer_get_time();
+    int64_t soonest = INT64_MAX;
+
+    for(int c = 0; c < channelCount; c++) {
+        if(!debouncers[c].pending) continue;
+        int64_t remaining = debouncers[c].lastChangeUs + IR_DEBOUNCE_US - now;
+        if(remaining < soonest) soonest = remaining;
+    }
+
+    if(soonest == INT64_MAX) return portMAX_DELAY;
+    if(soonest <= 0) return 0;
+
+    TickType_t ticks = pdMS_TO_TICKS((soonest + 999) / 1000);
+    return ticks > 0 ? ticks : 1;
+}
+
+uint32_t irSensorDroppedEdges() {
+    return droppedEdges;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file journal.cpp
+ * @brief Append-only event journal in the "journal" flash partition
+ */
+
+#include "journal.h"
+#include "parking_state.h"
+#include "time_service.h"
+#include "metrics.h"
+#include "config.h"
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <stddef.h>
+
+#ifndef JOURNAL_PARTITION_LABEL
+    #define JOURNAL_PARTITION_LABEL "journal"
+#endif
+#ifndef JOURNAL_BATCH
+    #define JOURNAL_BATCH 8
+#endif
+#ifndef JOURNAL_BATCH_MAX
+    #define JOURNAL_BATCH_MAX 32
+#endif
+#ifndef JOURNAL_FLUSH_MS
+    #define JOURNAL_FLUSH_MS 2000
+#endif
+
+#define JOURNAL_SECTOR_SIZE 4096
+#define JOURNAL_RECORD_SIZE ((uint32_t)sizeof(JournalRecord))
+#define RECORDS_PER_SECTOR (JOURNAL_SECTOR_SIZE / JOURNAL_RECORD_SIZE)
+#define ERASED_SEQ 0xFFFFFFFFu
+
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord must stay 16 bytes");
+static_assert(JOURNAL_SECTOR_SIZE % sizeof(JournalRecord) == 0, "records must not straddle sectors");
+
+static const esp_partition_t *partition = NULL;
+static uint32_t writeOffset = 0;   // Next free record, byte offset in the partition
+static uint32_t nextSeq = 1;
+static SemaphoreHandle_t flashMutex = NULL;
+static StaticSemaphore_t flashMutexBuffer;
+
+// RAM batch filled by journalAppend, drained by journalFlush
+static portMUX_TYPE batchLock = portMUX_INITIALIZER_UNLOCKED;
+static JournalRecord batch[JOURNAL_BATCH_MAX];
+static int batchCount = 0;
+static volatile uint32_t droppedRecords = 0;
+static TaskHandle_t flushTask = NULL;
+
+// ============================================================================
+// Record Helpers
+// ============================================================================
+
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while(len--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for(int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static inline uint16_t recordCrc(const JournalRecord *rec) {
+    return crc16((const uint8_t *)rec, offsetof(JournalRecord, crc));
+}
+
+static inline bool recordErased(const JournalRecord *rec) {
+    return rec->seq == ERASED_SEQ;
+}
+
+static inline bool recordValid(const JournalRecord *rec) {
+    return !recordErased(rec) && rec->crc == recordCrc(rec);
+}
+
+// ============================================================================
+// Boot Scan
+// ============================================================================
+
+/**
+ * @brief Find the head: newest sector by first seq, then its last record
+ *
+ * Reads one record per sector plus one whole sector, so restoring state
+ * takes a few milliseconds regardless of how full the journal is.
+ */
+static bool findHead(JournalRecord *last) {
+    static JournalRecord sector[RECORDS_PER_SECTOR];   // 4 KB, too big for the stack
+    uint32_t sectors = partition->size / JOURNAL_SECTOR_SIZE;
+    int32_t headSector = -1;
+    uint32_t headSeq = 0;
+
+    for(uint32_t s = 0; s < sectors; s++) {
+        JournalRecord first;
+        if(esp_partition_read(partition, s * JOURNAL_SECTOR_SIZE, &first, sizeof(first)) != ESP_OK) continue;
+        if(recordValid(&first) && (headSector < 0 || first.seq > headSeq)) {
+            headSector = s;
+            headSeq = first.seq;
+        }
+    }
+
+    if(headSector < 0) {
+        writeOffset = 0;
+        nextSeq = 1;
+        return false;
+    }
+
+    uint32_t base = headSector * JOURNAL_SECTOR_SIZE;
+    esp_partition_read(partition, base, sector, sizeof(sector));
+
+    // Stop at the first erased slot; torn records (bad CRC) are skipped over
+    uint32_t i = 0;
+    for(; i < RECORDS_PER_SECTOR && !recordErased(&sector[i]); i++) {
+        if(recordValid(&sector[i])) *last = sector[i];
+    }
+
+    writeOffset = base + i * JOURNAL_RECORD_SIZE;
+    if(writeOffset >= partition->size) writeOffset = 0;
+    nextSeq = last->seq + 1;
+    return true;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool journalBegin(JournalRecord *last) {
+    flashMutex = xSemaphoreCreateMutexStatic(&flashMutexBuffer);
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, JOURNAL_PARTITION_LABEL);
+
+    if(partition == NULL || partition->size < 2 * JOURNAL_SECTOR_SIZE) {
+        Serial.println("[Journal] No \"" JOURNAL_PARTITION_LABEL "\" partition - journal disabled");
+        partition = NULL;
+        return false;
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool found = findHead(last);
+
+    Serial.printf("[Journal] %lu KB, head at 0x%05lx, %s in %lu us\n",
+                  (unsigned long)(partition->size / 1024), (unsigned long)writeOffset,
+                  found ? "restored" : "empty", (unsigned long)(esp_timer_get_time() - start));
+    return found;
+}
+
+bool journalAppend(EventType type, int value) {
+    if(partition == NULL) return false;
+
+    ParkingState state;
+    parkingStateRead(&state);
+
+    JournalRecord rec;
+    uint32_t now = timeServiceNow();
+    rec.timestamp = now ? now : millis() / 1000;
+    rec.flags = now ? 0 : JOURNAL_FLAG_UPTIME;
+    rec.type = (uint8_t)type;
+    rec.value = (int16_t)value;
+    rec.available = (uint16_t)state.availableSlots;
+
+    bool queued = false;
+    bool wake = false;
+
+    portENTER_CRITICAL(&batchLock);
+    if(batchCount < JOURNAL_BATCH_MAX) {
+        batch[batchCount++] = rec;
+        queued = true;
+        wake = (batchCount == JOURNAL_BATCH);
+    }
+    portEXIT_CRITICAL(&batchLock);
+
+    if(!queued) droppedRecords++;
+    if(wake && flushTask != NULL) xTaskNotifyGive(flushTask);
+    return queued;
+}
+
+void journalFlush() {
+    static JournalRecord out[JOURNAL_BATCH_MAX];
+
+    if(partition == NULL || !metricsMutexTake(METRICS_MUTEX_JOURNAL, flashMutex, portMAX_DELAY)) return;
+
+    portENTER_CRITICAL(&batchLock);
+    int count = batchCount;
+    memcpy(out, batch, count * sizeof(JournalRecord));
+    batchCount = 0;
+    portEXIT_CRITICAL(&batchLock);
+
+    for(int i = 0; i < count; i++) {
+        out[i].seq = nextSeq++;
+        out[i].crc = recordCrc(&out[i]);
+    }
+
+    // One program operation per sector touched (normally just one)
+    int done = 0;
+    while(done < count) {
+        if(writeOffset % JOURNAL_SECTOR_SIZE == 0) {
+            esp_partition_erase_range(partition, writeOffset, JOURNAL_SECTOR_SIZE);
+        }
+
+        uint32_t room = (JOURNAL_SECTOR_SIZE - writeOffset % JOURNAL_SECTOR_SIZE) / JOURNAL_RECORD_SIZE;
+        int chunk = (count - done) < (int)room ? (count - done) : (int)room;
+
+        if(esp_partition_write(partition, writeOffset, &out[done], chunk * JOURNAL_RECORD_SIZE) != ESP_OK) {
+            Serial.printf("[Journal] Write failed at 0x%05lx\n", (unsigned long)writeOffset);
+        }
+
+        writeOffset += chunk * JOURNAL_RECORD_SIZE;
+        if(writeOffset >= partition->size) writeOffset = 0;
+        done += chunk;
+    }
+
+    xSemaphoreGive(flashMutex);
+}
+
+uint32_t journalDropped() {
+    return droppedRecords;
+}
+
+void journalTask(void *parameter) {
+    flushTask = xTaskGetCurrentTaskHandle();
+    Serial.println("[Journal] Started on Core 0");
+
+    while(1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JOURNAL_FLUSH_MS));
+        journalFlush();
+    }
+}
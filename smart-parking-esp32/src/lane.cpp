@@ -0,0 +1,67 @@
+/**
+ * @file lane.cpp
+ * @brief Entry/exit lanes and the barriers they drive, from LANE_TABLE
+ */
+
+#include "lane.h"
+
+static int8_t barrierOfLane[LANE_MAX];
+static uint8_t barrierPins[LANE_MAX];
+static uint8_t barrierLanes[LANE_MAX];
+static int barrierCount = 0;
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void lanesBegin() {
+    barrierCount = 0;
+    for(int l = 0; l < LANE_COUNT; l++) {
+        int b = 0;
+        while(b < barrierCount && barrierPins[b] != laneTable[l].servoPin) b++;
+        if(b == barrierCount) {
+            barrierPins[b] = laneTable[l].servoPin;
+            barrierLanes[b] = 0;
+            barrierCount++;
+        }
+        barrierOfLane[l] = b;
+        barrierLanes[b] |= 1 << l;
+    }
+
+    Serial.printf("[Lane] %d lanes, %d barriers\n", LANE_COUNT, barrierCount);
+}
+
+int laneCount() {
+    return LANE_COUNT;
+}
+
+const LaneConfig *laneConfig(int lane) {
+    return &laneTable[lane];
+}
+
+int laneFind(const char *arg) {
+    char *end;
+    long index = strtol(arg, &end, 10);
+    if(end != arg && *end == '\0') return (index >= 0 && index < laneCount()) ? index : -1;
+
+    for(int l = 0; l < laneCount(); l++) {
+        if(strcasecmp(laneTable[l].name, arg) == 0) return l;
+    }
+    return -1;
+}
+
+int laneBarrier(int lane) {
+    return barrierOfLane[lane];
+}
+
+int laneBarrierCount() {
+    return barrierCount;
+}
+
+uint8_t laneBarrierPin(int barrier) {
+    return barrierPins[barrier];
+}
+
+uint8_t laneBarrierLanes(int barrier) {
+    return barrierLanes[barrier];
+}
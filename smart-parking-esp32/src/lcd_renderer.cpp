@@ -0,0 +1,105 @@
+/**
+ * @file lcd_renderer.cpp
+ * @brief Frame-buffer renderer for the 16x2 I2C LCD
+ */
+
+#include "lcd_renderer.h"
+#include <LiquidCrystal_I2C.h>
+#include <stdarg.h>
+
+#define LCD_CELLS (LCD_ROWS * LCD_COLS)
+
+static LiquidCrystal_I2C *display = NULL;
+static LcdFrame shown;      // What the display currently holds
+
+// ============================================================================
+// Frame Composition
+// ============================================================================
+
+void lcdFrameClear(LcdFrame *frame) {
+    memset(frame->cells, ' ', sizeof(frame->cells));
+}
+
+void lcdFramePrintf(LcdFrame *frame, int row, const char *fmt, ...) {
+    char line[LCD_COLS + 1];
+    va_list args;
+
+    if(row < 0 || row >= LCD_ROWS) return;
+
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if(n < 0) n = 0;
+    if(n > LCD_COLS) n = LCD_COLS;
+    memcpy(frame->cells[row], line, n);
+    memset(frame->cells[row] + n, ' ', LCD_COLS - n);
+}
+
+// ============================================================================
+// Diff
+// ============================================================================
+
+static inline char cellAt(const LcdFrame *frame, int index) {
+    return frame->cells[index / LCD_COLS][index % LCD_COLS];
+}
+
+static inline bool cellChanged(const LcdFrame *shown, const LcdFrame *next, int index) {
+    return cellAt(shown, index) != cellAt(next, index);
+}
+
+int lcdFrameNextRun(const LcdFrame *shown, const LcdFrame *next, int from, int *len) {
+    int start = from;
+
+    while(start < LCD_CELLS && !cellChanged(shown, next, start)) start++;
+    if(start >= LCD_CELLS) return -1;
+
+    // Extend to the last changed cell, bridging one-cell gaps but never
+    // wrapping past the end of the row (the DDRAM rows are not contiguous)
+    int rowEnd = (start / LCD_COLS + 1) * LCD_COLS;
+    int end = start + 1;
+    while(end < rowEnd) {
+        if(cellChanged(shown, next, end)) {
+            end++;
+        } else if(end + 1 < rowEnd && cellChanged(shown, next, end + 1)) {
+            end += 2;
+        } else {
+            break;
+        }
+    }
+
+    *len = end - start;
+    return start;
+}
+
+// ============================================================================
+// Display
+// ============================================================================
+
+void lcdRendererBegin(LiquidCrystal_I2C *lcd) {
+    display = lcd;
+    display->clear();
+    lcdFrameClear(&shown);
+}
+
+int lcdRendererDraw(const LcdFrame *frame) {
+    int sent = 0;
+    int len;
+    int start = lcdFrameNextRun(&shown, frame, 0, &len);
+
+    if(display == NULL) return 0;
+
+    while(start >= 0) {
+        int row = start / LCD_COLS;
+        int col = start % LCD_COLS;
+
+        display->setCursor(col, row);
+        display->write((const uint8_t *)&frame->cells[row][col], len);
+        memcpy(&shown.cells[row][col], &frame->cells[row][col], len);
+        sent += len;
+
+        start = lcdFrameNextRun(&shown, frame, start + len, &len);
+    }
+
+    return sent;
+}
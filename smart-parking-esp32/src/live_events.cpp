@@ -0,0 +1,142 @@
+/**
+ * @file live_events.cpp
+ * @brief Server-Sent Events stream (/events) pushing ParkingState deltas
+ */
+
+#include "live_events.h"
+#include "state_json.h"
+#include "metrics.h"
+#include "config.h"
+
+#ifndef SSE_MAX_CLIENTS
+    #define SSE_MAX_CLIENTS 8
+#endif
+
+static const char SSE_HEADERS[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+static const char SSE_PING[] = ": ping\n\n";
+
+static const LiveEventsTransport *io = NULL;
+static int sockets[SSE_MAX_CLIENTS];        // -1 = free slot
+static int clientCount = 0;
+static ParkingState lastSent;               // Baseline for the next delta
+static SemaphoreHandle_t clientsMutex = NULL;
+static StaticSemaphore_t clientsMutexBuffer;
+
+// ============================================================================
+// Helpers (clientsMutex held)
+// ============================================================================
+
+static void removeSlot(int i) {
+    sockets[i] = -1;
+    clientCount--;
+    Serial.printf("[Events] Viewer left (%d connected)\n", clientCount);
+}
+
+static void dropClient(int i) {
+    int sock = sockets[i];
+    removeSlot(i);
+    io->close(sock);
+}
+
+/**
+ * @brief Write a whole buffer; a short write means the viewer can't keep up
+ */
+static bool sendAll(int sock, const char *data, size_t len) {
+    return io->send(sock, data, len) == (int)len;
+}
+
+/**
+ * @brief Write one "data:" frame
+ */
+static bool sendFrame(int sock, const char *json, size_t len) {
+    char frame[STATE_JSON_MAX + 8];
+    int n = snprintf(frame, sizeof(frame), "data: %.*s\n\n", (int)len, json);
+    if(n < 0 || (size_t)n >= sizeof(frame)) return false;
+    return sendAll(sock, frame, n);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void liveEventsInit(const LiveEventsTransport *transport) {
+    io = transport;
+    for(int i = 0; i < SSE_MAX_CLIENTS; i++) sockets[i] = -1;
+    clientsMutex = xSemaphoreCreateMutexStatic(&clientsMutexBuffer);
+    parkingStateRead(&lastSent);
+}
+
+LiveEventsSubscribeResult liveEventsSubscribe(int sock) {
+    char json[STATE_JSON_MAX];
+    LiveEventsSubscribeResult result = LIVE_EVENTS_FULL;
+
+    if(!metricsMutexTake(METRICS_MUTEX_SSE_CLIENTS, clientsMutex, portMAX_DELAY)) return LIVE_EVENTS_FULL;
+
+    for(int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if(sockets[i] >= 0) continue;
+
+        // Start from the delta baseline, so the next publish brings the
+        // viewer up to date and nothing is ever applied out of order
+        size_t len = stateToJson(&lastSent, millis() / 1000, NULL, json, sizeof(json));
+        if(!sendAll(sock, SSE_HEADERS, sizeof(SSE_HEADERS) - 1) || !sendFrame(sock, json, len)) {
+            result = LIVE_EVENTS_SEND_FAILED;
+            break;
+        }
+
+        sockets[i] = sock;
+        clientCount++;
+        result = LIVE_EVENTS_SUBSCRIBED;
+        Serial.printf("[Events] Viewer joined (%d connected)\n", clientCount);
+        break;
+    }
+
+    xSemaphoreGive(clientsMutex);
+    return result;
+}
+
+void liveEventsForget(int sock) {
+    if(clientsMutex == NULL || !metricsMutexTake(METRICS_MUTEX_SSE_CLIENTS, clientsMutex, portMAX_DELAY)) return;
+
+    for(int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if(sockets[i] == sock) removeSlot(i);
+    }
+
+    xSemaphoreGive(clientsMutex);
+}
+
+void liveEventsPublish(const ParkingState *state) {
+    char json[STATE_JSON_MAX];
+
+    if(!metricsMutexTake(METRICS_MUTEX_SSE_CLIENTS, clientsMutex, portMAX_DELAY)) return;
+
+    size_t len = stateDeltaToJson(&lastSent, state, json, sizeof(json));
+    lastSent = *state;
+
+    if(len > 0) {
+        for(int i = 0; i < SSE_MAX_CLIENTS; i++) {
+            if(sockets[i] >= 0 && !sendFrame(sockets[i], json, len)) dropClient(i);
+        }
+    }
+
+    xSemaphoreGive(clientsMutex);
+}
+
+void liveEventsHeartbeat() {
+    if(!metricsMutexTake(METRICS_MUTEX_SSE_CLIENTS, clientsMutex, portMAX_DELAY)) return;
+
+    for(int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if(sockets[i] >= 0 && !sendAll(sockets[i], SSE_PING, sizeof(SSE_PING) - 1)) dropClient(i);
+    }
+
+    xSemaphoreGive(clientsMutex);
+}
+
+int liveEventsClientCount() {
+    return clientCount;
+}
@@ -10,7 +10,7 @@
  * - Telegram bot for remote monitoring
  * - Environmental monitoring (DHT22)
  * - Automatic barrier gate control
- * - 8 concurrent FreeRTOS tasks on dual cores
+ * - 10 concurrent FreeRTOS tasks on dual cores
  */
 
 // ============================================================================
@@ -19,28 +19,45 @@
 #include <WiFi.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
-#include <WebServer.h>
-#include <ESP32Servo.h>
 #include <WiFiClientSecure.h>
 #include <UniversalTelegramBot.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
-#include <time.h>
-#include "DHT.h"
+#include <Preferences.h>
 #include "config.h"  // Configuration file
+#include "ir_sensor.h"
+#include "gate_fsm.h"
+#include "gate_flow.h"
+#include "parking_state.h"
+#include "state_json.h"
+#include "live_events.h"
+#include "web_server.h"
+#include "telegram_outbox.h"
+#include "telegram_commands.h"
+#include "lcd_renderer.h"
+#include "time_service.h"
+#include "slot_scanner.h"
+#include "system_event.h"
+#include "journal.h"
+#include "history.h"
+#include "servo_motion.h"
+#include "metrics.h"
+#include "trace.h"
+#include "lane.h"
+#include "power.h"
+#include "mqtt_uplink.h"
+#include "connectivity.h"
+#include "dht_reader.h"
+#include "sensor_filter.h"
+#include "static_rtos.h"
+#include "heap_watch.h"
+#include "reservation.h"
+#include "ota_update.h"
+#include "forecast.h"
+#include "federation.h"
 
 // ============================================================================
 // Hardware Pin Definitions (from config.h or fallback)
 // ============================================================================
-#ifndef IR_ENTRY_PIN
-    #define IR_ENTRY_PIN 18
-#endif
-#ifndef IR_EXIT_PIN
-    #define IR_EXIT_PIN 19
-#endif
-#ifndef SERVO_PIN
-    #define SERVO_PIN 25
-#endif
+// IR and servo pins come from LANE_TABLE (lane.h)
 #ifndef GREEN_LED_PIN
     #define GREEN_LED_PIN 26
 #endif
@@ -53,6 +70,12 @@
 #ifndef DHT_TYPE
     #define DHT_TYPE DHT22
 #endif
+#ifndef SENSOR_USE_ISR
+    #define SENSOR_USE_ISR 1
+#endif
+#ifndef SENSOR_CHECK_INTERVAL
+    #define SENSOR_CHECK_INTERVAL 50
+#endif
 
 // ============================================================================
 // Configuration Constants
@@ -60,20 +83,68 @@
 #ifndef TOTAL_PARKING_SLOTS
     #define TOTAL_PARKING_SLOTS 4
 #endif
-#ifndef TIME_API_URL
-    #define TIME_API_URL "https://timeapi.io/api/Time/current/zone"
+#ifndef GATE_CLEAR_GUARD_MS
+    #define GATE_CLEAR_GUARD_MS 300
+#endif
+#ifndef SERVO_LEDC_CHANNEL
+    #define SERVO_LEDC_CHANNEL 0
+#endif
+#ifndef LANE_QUEUE_SIZE
+    #define LANE_QUEUE_SIZE 5
+#endif
+#ifndef LCD_ADDRESS
+    #define LCD_ADDRESS 0x27
+#endif
+#ifndef LCD_I2C_CLOCK_HZ
+    #define LCD_I2C_CLOCK_HZ 100000
+#endif
+#ifndef LCD_MESSAGE_HOLD_MS
+    #define LCD_MESSAGE_HOLD_MS 500
+#endif
+#ifndef TELEGRAM_LONG_POLL_SEC
+    #define TELEGRAM_LONG_POLL_SEC 25
+#endif
+#ifndef TELEGRAM_MSG_MAX
+    #define TELEGRAM_MSG_MAX 512
+#endif
+#ifndef TELEGRAM_REPLY_MAX
+    #define TELEGRAM_REPLY_MAX 256
+#endif
+#ifndef SSE_KEEPALIVE_MS
+    #define SSE_KEEPALIVE_MS 15000
+#endif
+#ifndef DHT_READ_INTERVAL
+    #define DHT_READ_INTERVAL 2000
+#endif
+#ifndef DHT_TEMP_STEP_C
+    #define DHT_TEMP_STEP_C 0.5
+#endif
+#ifndef DHT_HUM_STEP_PCT
+    #define DHT_HUM_STEP_PCT 2.0
+#endif
+#ifndef DHT_EMA_ALPHA
+    #define DHT_EMA_ALPHA 0.3
+#endif
+#ifndef DHT_OUTLIER_TEMP_C
+    #define DHT_OUTLIER_TEMP_C 3.0
 #endif
-#ifndef TIME_ZONE
-    #define TIME_ZONE "Africa/Cairo"
+#ifndef DHT_OUTLIER_HUM_PCT
+    #define DHT_OUTLIER_HUM_PCT 10.0
 #endif
-#ifndef NTP_SERVER
-    #define NTP_SERVER "pool.ntp.org"
+#ifndef WIFI_CHECK_INTERVAL
+    #define WIFI_CHECK_INTERVAL 10000
 #endif
-#ifndef GMT_OFFSET_SEC
-    #define GMT_OFFSET_SEC 7200
+#ifndef POWER_SAVE_MODE
+    #define POWER_SAVE_MODE 0
 #endif
-#ifndef DAYLIGHT_OFFSET_SEC
-    #define DAYLIGHT_OFFSET_SEC 0
+
+// Light sleep needs every task to block; the sync web server and the
+// polling sensor loop wake the CPU every few milliseconds
+#if POWER_SAVE_MODE && !SENSOR_USE_ISR
+    #error "POWER_SAVE_MODE needs SENSOR_USE_ISR 1 (the IR pins are the wake sources)"
+#endif
+#if POWER_SAVE_MODE && !WEB_ASYNC_BACKEND
+    #warning "POWER_SAVE_MODE with the polled WebServer never sleeps; use WEB_ASYNC_BACKEND 1"
 #endif
 
 // WiFi Credentials (use config.h or define here)
@@ -94,92 +165,130 @@
     #define BOT_TOKEN "your_telegram_bot_token"
 #endif
 
-// FreeRTOS Core Assignment
-static const BaseType_t pro_cpu = 0;  // Hardware tasks
-static const BaseType_t app_cpu = 1;  // Communication tasks
+// ============================================================================
+// FreeRTOS Task Configuration
+// ============================================================================
+// Stacks, priorities and cores come from config.h alone; a missing one
+// fails the build where it is used
+
+// Optional tasks only get a stack when their feature is configured
+static constexpr bool MQTT_BUILT = sizeof(MQTT_BROKER_HOST) > 1;
+static constexpr bool OTA_BUILT = sizeof(OTA_PUBLIC_KEY_PEM) > 1;
+static constexpr bool FED_BUILT = sizeof(FED_NODE_NAME) > 1;
+
+// The gate path must win every contest on its core
+static_assert(SENSOR_TASK_PRIORITY > GATE_TASK_PRIORITY, "the sensor task must preempt the gate tasks it feeds");
+static_assert(GATE_TASK_PRIORITY > LED_TASK_PRIORITY && GATE_TASK_PRIORITY > DHT_TASK_PRIORITY &&
+              GATE_TASK_PRIORITY > JOURNAL_TASK_PRIORITY && GATE_TASK_PRIORITY > SLOT_SCAN_TASK_PRIORITY,
+              "gate tasks must outrank the other Core 0 tasks");
+static_assert(HARDWARE_CORE != COMM_CORE, "hardware and communication tasks share a core");
 
 // ============================================================================
 // Task Handles
 // ============================================================================
 TaskHandle_t sensorTaskHandle = NULL;
-TaskHandle_t gateTaskHandle = NULL;
+TaskHandle_t gateTaskHandles[LANE_MAX];    // One per barrier
 TaskHandle_t ledTaskHandle = NULL;
 TaskHandle_t lcdTaskHandle = NULL;
 TaskHandle_t webServerTaskHandle = NULL;
 TaskHandle_t dhtTaskHandle = NULL;
 TaskHandle_t telegramTaskHandle = NULL;
+TaskHandle_t telegramSendTaskHandle = NULL;
 TaskHandle_t wifiTaskHandle = NULL;
+TaskHandle_t eventsTaskHandle = NULL;
+TaskHandle_t slotScanTaskHandle = NULL;
+TaskHandle_t journalTaskHandle = NULL;
+TaskHandle_t mqttTaskHandle = NULL;
+TaskHandle_t consoleTaskHandle = NULL;     // Arduino loop task (serial console)
 
 // ============================================================================
 // FreeRTOS Synchronization Primitives
 // ============================================================================
-// Queues for inter-task communication
-QueueHandle_t entryQueue;
-QueueHandle_t exitQueue;
+// Queues for inter-task communication (lane queues live in lanes[])
 QueueHandle_t lcdQueue;
+SemaphoreHandle_t gateStatusMutex;  // Gate tasks take turns publishing the combined state
 
-// Mutexes for thread-safe access
-SemaphoreHandle_t slotsMutex;
-SemaphoreHandle_t gateStatusMutex;
-SemaphoreHandle_t lcdMutex;
-SemaphoreHandle_t dhtMutex;
-SemaphoreHandle_t timeMutex;
-
-// ============================================================================
-// Global Variables (Protected by Mutexes)
-// ============================================================================
-const int TOTAL_SLOTS = TOTAL_PARKING_SLOTS;
-int availableSlots = TOTAL_PARKING_SLOTS;
-String gateStatus = "Closed";
-float temperature = 0.0;
-float humidity = 0.0;
-String currentTime = "00:00:00";
-String currentDate = "2024/01/01";
-bool wifiConnected = false;
-bool internetConnected = false;
+// The LCD is owned by lcdTask; other tasks post to lcdQueue
+// (shared parking state lives in parking_state.h)
 
 // ============================================================================
 // Hardware Objects
 // ============================================================================
-Servo barrierServo;
-LiquidCrystal_I2C lcd(0x27, 16, 2);
-WebServer server(80);
-DHT dht(DHT_PIN, DHT_TYPE);
-WiFiClientSecure secured_client;
+LiquidCrystal_I2C lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
+WiFiClientSecure secured_client;   // Polling session (replies go via telegram_outbox)
 UniversalTelegramBot bot(BOT_TOKEN, secured_client);
 
 // ============================================================================
 // Custom Types
 // ============================================================================
-typedef enum {
-    EVENT_CAR_ENTRY,
-    EVENT_CAR_EXIT,
-    EVENT_GATE_OPEN,
-    EVENT_GATE_CLOSE,
-    EVENT_PARKING_FULL
-} EventType;
+// EventType / SystemEvent live in system_event.h (shared with the journal)
 
 typedef struct {
-    EventType type;
-    int value;
-} SystemEvent;
+    char line1[LCD_COLS + 1];
+    char line2[LCD_COLS + 1];
+} LCDMessage;
 
 typedef struct {
-    char line1[17];
-    char line2[17];
-} LCDMessage;
+    const char *name;
+    char taskName[8];
+    ServoMotion servo;
+    bool awake;                 // Holding a powerStayAwake() reference
+    QueueSetHandle_t events;    // Queues of every lane this barrier serves
+} Barrier;
+
+typedef struct {
+    const LaneConfig *config;
+    QueueHandle_t queue;        // Sensor task -> the barrier's gate task
+    Barrier *barrier;
+    bool deniedWaiting;         // Gate task's view: a turned-away car is still in the beam
+} Lane;
 
 // ============================================================================
-// Function Declarations
+// Lanes and Barriers (from LANE_TABLE, see lane.h)
 // ============================================================================
-// Time functions
-bool checkInternetConnection();
-void initTime(const char *ntpServer, long gmtOffsetSec, int daylightOffsetSec);
-String getTimeFromAPI();
-String getDateFromAPI();
-String getCurrentTime();
-String getCurrentDate();
+static_assert(LANE_MAX <= IR_MAX_CHANNELS, "every lane needs an IR channel");
+
+Lane lanes[LANE_MAX];
+Barrier barriers[LANE_MAX];
 
+// Capacity for logs; the parking state holds the authoritative copy
+static int lotCapacity = TOTAL_PARKING_SLOTS;
+
+// ============================================================================
+// Task Table (static stacks, TCBs and queues sized from config.h)
+// ============================================================================
+// Core 0 (Hardware)
+static StaticTask<SENSOR_TASK_STACK, SENSOR_TASK_PRIORITY, HARDWARE_CORE> sensorTaskMem;
+static StaticTask<GATE_TASK_STACK, GATE_TASK_PRIORITY, HARDWARE_CORE> gateTaskMem[LANE_BARRIER_COUNT];
+static StaticTask<LED_TASK_STACK, LED_TASK_PRIORITY, HARDWARE_CORE> ledTaskMem;
+static StaticTask<DHT_TASK_STACK, DHT_TASK_PRIORITY, HARDWARE_CORE> dhtTaskMem;
+static StaticTask<JOURNAL_TASK_STACK, JOURNAL_TASK_PRIORITY, HARDWARE_CORE> journalTaskMem;
+#if SLOT_SENSOR_TYPE != SLOT_SENSOR_NONE
+static StaticTask<SLOT_SCAN_TASK_STACK, SLOT_SCAN_TASK_PRIORITY, HARDWARE_CORE> slotScanTaskMem;
+#endif
+
+// Core 1 (Communication)
+static StaticTask<LCD_TASK_STACK, LCD_TASK_PRIORITY, COMM_CORE> lcdTaskMem;
+#if !WEB_ASYNC_BACKEND
+static StaticTask<WEB_TASK_STACK, WEB_TASK_PRIORITY, COMM_CORE> webServerTaskMem;
+#endif
+static StaticTask<TELEGRAM_TASK_STACK, TELEGRAM_TASK_PRIORITY, COMM_CORE> telegramTaskMem;
+static StaticTask<TELEGRAM_SEND_TASK_STACK, TELEGRAM_SEND_TASK_PRIORITY, COMM_CORE> telegramSendTaskMem;
+static StaticTask<WIFI_TASK_STACK, WIFI_TASK_PRIORITY, COMM_CORE> wifiTaskMem;
+static StaticTask<EVENTS_TASK_STACK, EVENTS_TASK_PRIORITY, COMM_CORE> eventsTaskMem;
+static OptionalStaticTask<MQTT_BUILT, MQTT_TASK_STACK, MQTT_TASK_PRIORITY, COMM_CORE> mqttTaskMem;
+static OptionalStaticTask<OTA_BUILT, OTA_TASK_STACK, OTA_TASK_PRIORITY, COMM_CORE> otaTaskMem;
+static OptionalStaticTask<FED_BUILT, FED_TASK_STACK, FED_TASK_PRIORITY, COMM_CORE> federationTaskMem;
+
+// Queues and mutexes (queue sets have no static variant in FreeRTOS)
+static StaticQueue<SystemEvent, LANE_QUEUE_SIZE> laneQueueMem[LANE_COUNT];
+static StaticQueue<LCDMessage, LCD_QUEUE_SIZE> lcdQueueMem;
+static StaticSemaphore_t gateStatusMutexMem;
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+// Network functions
 // Task functions
 void wifiTask(void *parameter);
 void sensorTask(void *parameter);
@@ -187,145 +296,90 @@ void gateTask(void *parameter);
 void ledTask(void *parameter);
 void dhtTask(void *parameter);
 void lcdTask(void *parameter);
-void webServerTask(void *parameter);
 void telegramTask(void *parameter);
+void eventsTask(void *parameter);
+
 
-// Web server handlers
-void handleData();
-String getHTML();
 
 // ============================================================================
-// TIME FUNCTIONS
+// REMOTE COMMANDS (MQTT, reservations)
 // ============================================================================
 
 /**
- * @brief Check if internet is accessible
- * @return true if connected to internet
+ * @brief Queue a remote open on a lane; its gate task does the rest
  */
-bool checkInternetConnection() {
-    if (WiFi.status() != WL_CONNECTED) return false;
-    
-    HTTPClient http;
-    http.begin("http://clients3.google.com/generate_204");
-    http.setTimeout(3000);
-    int httpCode = http.GET();
-    http.end();
+static bool remoteOpenLane(int lane) {
+    SystemEvent event;
     
-    return (httpCode == 204);
+    event.type = EVENT_REMOTE_OPEN;
+    event.value = lane;
+    event.seq = 0;
+    event.detectedUs = esp_timer_get_time();
+    event.queuedUs = event.detectedUs;
+    event.dequeuedUs = 0;
+    return metricsQueueSend((MetricsQueueId)(METRICS_QUEUE_LANE + lane), &event, 0);
 }
 
 /**
- * @brief Initialize NTP time synchronization
+ * @brief A reservation checked in; its lane's gate task decides when to open
  */
-void initTime(const char *ntpServer, long gmtOffsetSec, int daylightOffsetSec) {
-    configTime(gmtOffsetSec, daylightOffsetSec, ntpServer);
-    Serial.println("[Time] NTP configured");
-}
-
-/**
- * @brief Get time from external API (fallback if NTP fails)
- */
-String getTimeFromAPI() {
-    if (WiFi.status() != WL_CONNECTED) {
-        return "00:00:00";
-    }
-    
-    HTTPClient http;
-    String url = String(TIME_API_URL) + "?timeZone=" + TIME_ZONE;
-    
-    http.begin(url);
-    http.setTimeout(5000);
-    http.addHeader("Accept", "application/json");
-    
-    int httpCode = http.GET();
-    
-    if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        StaticJsonDocument<512> doc;
-        
-        if (!deserializeJson(doc, payload)) {
-            int hour = doc["hour"];
-            int minute = doc["minute"];
-            int seconds = doc["seconds"];
-            
-            char formattedTime[20];
-            sprintf(formattedTime, "%02d:%02d:%02d", hour, minute, seconds);
-            
-            http.end();
-            return String(formattedTime);
-        }
-    }
+static void onReservationArrival(int lane) {
+    SystemEvent event;
     
-    http.end();
-    return "00:00:00";
+    event.type = EVENT_RESERVED_ARRIVAL;
+    event.value = lane;
+    event.seq = 0;              // Numbered by the gate task if it lets a car in
+    event.detectedUs = esp_timer_get_time();
+    event.queuedUs = event.detectedUs;
+    event.dequeuedUs = 0;
+    metricsQueueSend((MetricsQueueId)(METRICS_QUEUE_LANE + lane), &event, 0);
 }
 
 /**
- * @brief Get date from external API (fallback if NTP fails)
+ * @brief Change the lot capacity and keep it across reboots (NVS)
+ *
+ * Refused with bay sensors fitted: there the capacity is the bay count.
  */
-String getDateFromAPI() {
-    if (WiFi.status() != WL_CONNECTED) {
-        return "2024/01/01";
-    }
-    
-    HTTPClient http;
-    String url = String(TIME_API_URL) + "?timeZone=" + TIME_ZONE;
-    
-    http.begin(url);
-    http.setTimeout(5000);
-    http.addHeader("Accept", "application/json");
-    
-    int httpCode = http.GET();
+static bool remoteSetCapacity(int totalSlots) {
+#if SLOT_SENSOR_TYPE != SLOT_SENSOR_NONE
+    return false;
+#else
+    Preferences prefs;
     
-    if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        StaticJsonDocument<512> doc;
-        
-        if (!deserializeJson(doc, payload)) {
-            int year = doc["year"];
-            int month = doc["month"];
-            int day = doc["day"];
-            
-            char formattedDate[20];
-            sprintf(formattedDate, "%04d/%02d/%02d", year, month, day);
-            
-            http.end();
-            return String(formattedDate);
-        }
+    parkingStateSetTotal(totalSlots);
+    lotCapacity = totalSlots;
+    if(prefs.begin("parking", false)) {
+        prefs.putShort("capacity", totalSlots);
+        prefs.end();
     }
-    
-    http.end();
-    return "2024/01/01";
+    journalAppend(EVENT_COUNT_CORRECTED, totalSlots);
+    Serial.printf("[Parking] Capacity set to %d\n", totalSlots);
+    return true;
+#endif
 }
 
+// ============================================================================
+// BOOT TIMING
+// ============================================================================
+
 /**
- * @brief Get current time (NTP first, then API fallback)
+ * @brief Log a startup step with its time since reset
+ *
+ * esp_timer starts with the application, so the ROM and second-stage
+ * bootloader (~0.3 s) are not included.
  */
-String getCurrentTime() {
-    struct tm timeinfo;
-    
-    if (getLocalTime(&timeinfo, 1000)) {
-        char buffer[20];
-        strftime(buffer, sizeof(buffer), "%H:%M:%S", &timeinfo);
-        return String(buffer);
-    }
-    
-    return getTimeFromAPI();
+static void logBootMilestone(const char *what) {
+    Serial.printf("[Boot] %s at %lu ms\n", what, (unsigned long)(esp_timer_get_time() / 1000));
 }
 
+static int tasksStarted = 0;
+
 /**
- * @brief Get current date (NTP first, then API fallback)
+ * @brief Count a task setup() started (NULL = not created)
  */
-String getCurrentDate() {
-    struct tm timeinfo;
-    
-    if (getLocalTime(&timeinfo, 1000)) {
-        char buffer[20];
-        strftime(buffer, sizeof(buffer), "%Y/%m/%d", &timeinfo);
-        return String(buffer);
-    }
-    
-    return getDateFromAPI();
+static TaskHandle_t countTask(TaskHandle_t handle) {
+    if(handle != NULL) tasksStarted++;
+    return handle;
 }
 
 // ============================================================================
@@ -333,223 +387,345 @@ String getCurrentDate() {
 // ============================================================================
 
 /**
- * @brief WiFi monitoring and time update task
+ * @brief WiFi events (WiFi driver task) - wake wifiTask to republish at once
+ */
+static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if(wifiTaskHandle != NULL) xTaskNotifyGive(wifiTaskHandle);
+}
+
+/**
+ * @brief WiFi monitoring and time sync task
  * Runs on Core 1 (Communication)
+ *
+ * Checks the link every WIFI_CHECK_INTERVAL, or at once when the driver
+ * reports a connect/disconnect. Internet reachability comes from the
+ * other network tasks (connectivity.h); this task only probes when they
+ * have been quiet. Until the clock has synced it wakes every second so
+ * the SNTP fallback and the LCD clock are not held back.
  */
 void wifiTask(void *parameter) {
-    unsigned long lastTimeUpdate = 0;
     unsigned long lastWiFiCheck = 0;
-    const unsigned long TIME_UPDATE_INTERVAL = 5000;
-    const unsigned long WIFI_CHECK_INTERVAL = 10000;
+    bool wifiConnected = false;
+    bool everConnected = false;
+    bool linkEvent = true;
+    
+    WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
     
     while(1) {
         unsigned long now = millis();
         
-        // Check WiFi connection periodically
-        if(now - lastWiFiCheck >= WIFI_CHECK_INTERVAL) {
+        // Check WiFi connection periodically, or right after a link event
+        if(linkEvent || now - lastWiFiCheck >= WIFI_CHECK_INTERVAL) {
             bool prevWiFi = wifiConnected;
             wifiConnected = (WiFi.status() == WL_CONNECTED);
             
             if(wifiConnected != prevWiFi) {
                 if(wifiConnected) {
-                    Serial.println("[WiFi] Connected!");
+                    Serial.print("[WiFi] Connected! IP: ");
+                    Serial.println(WiFi.localIP());
+                    if(!everConnected) logBootMilestone("WiFi up");
+                    everConnected = true;
                 } else {
                     Serial.println("[WiFi] Disconnected! Reconnecting...");
                     WiFi.reconnect();
                 }
             }
             
-            if(wifiConnected) {
-                internetConnected = checkInternetConnection();
-            } else {
-                internetConnected = false;
-            }
-            
+            connectivitySetLink(wifiConnected);
             lastWiFiCheck = now;
         }
         
-        // Update time periodically
-        if(now - lastTimeUpdate >= TIME_UPDATE_INTERVAL) {
-            if(wifiConnected) {
-                String newTime = getCurrentTime();
-                String newDate = getCurrentDate();
-                
-                if(xSemaphoreTake(timeMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                    currentTime = newTime;
-                    currentDate = newDate;
-                    xSemaphoreGive(timeMutex);
-                }
-            }
-            
-            lastTimeUpdate = now;
-        }
+        connectivityMaintain();     // Active probe only after a quiet spell
+        heapWatchMaintain();        // Heap trend and fragmentation alert
+        reservationMaintain();      // Expire unclaimed reservations
+        otaMaintain(wifiConnected); // Confirm a freshly updated image
+        forecastMaintain();         // Learn from the hour that just ended
+        
+        // SNTP runs in the background; this only steps in when it is late
+        timeServiceMaintain(wifiConnected);
+        parkingStatePublishClock(timeServiceBootEpoch());
         
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        uint32_t waitMs = timeServiceValid() ? WIFI_CHECK_INTERVAL : WIFI_UNSYNCED_INTERVAL;
+        uint32_t probeMs = connectivityMsToNextProbe();
+        if(probeMs < waitMs) waitMs = probeMs;
+        linkEvent = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs)) > 0;
     }
 }
 
+/**
+ * @brief Send a beam edge to the lane's gate task
+ * @param blocked true = car arrived (EVENT_CAR_*), false = beam cleared
+ */
+static void reportBeam(int lane, bool blocked, int64_t detectedUs) {
+    const LaneConfig *config = lanes[lane].config;
+    SystemEvent event;
+    
+    if(!blocked) event.type = EVENT_BEAM_CLEAR;
+    else event.type = config->direction == LANE_ENTRY ? EVENT_CAR_ENTRY : EVENT_CAR_EXIT;
+    event.value = lane;
+    event.seq = blocked ? traceNextSeq() : 0;   // Only cars are traced
+    event.detectedUs = detectedUs;
+    event.dequeuedUs = 0;
+    event.queuedUs = esp_timer_get_time();
+
+    if(!metricsQueueSend((MetricsQueueId)(METRICS_QUEUE_LANE + lane), &event, 0)) {
+        Serial.printf("[Sensor] %s queue full - event dropped!\n", config->name);
+        return;
+    }
+    if(blocked) Serial.printf("\n[Sensor] CAR DETECTED AT %s!\n", config->name);
+}
+
 /**
  * @brief IR sensor monitoring task
  * Runs on Core 0 (Hardware) - Highest Priority
+ *
+ * In ISR mode the task sleeps until an edge arrives; in polling mode it
+ * samples every lane's pin each SENSOR_CHECK_INTERVAL.
  */
 void sensorTask(void *parameter) {
-    SystemEvent event;
-    pinMode(IR_ENTRY_PIN, INPUT);
-    pinMode(IR_EXIT_PIN, INPUT);
-    bool entryDetected = false;
-    bool exitDetected = false;
-    
     Serial.println("[Sensor] Started on Core 0");
     
+#if SENSOR_USE_ISR
+    IrEdge edge;
+    uint8_t pins[LANE_MAX];
+    for(int l = 0; l < laneCount(); l++) pins[l] = lanes[l].config->irPin;
+    irSensorBegin(pins, laneCount(), xTaskGetCurrentTaskHandle());
+    
     while(1) {
-        // Check entry sensor (LOW = car detected)
-        if(digitalRead(IR_ENTRY_PIN) == LOW && !entryDetected) {
-            entryDetected = true;
-            event.type = EVENT_CAR_ENTRY;
-            event.value = 1;
-            xQueueSend(entryQueue, &event, pdMS_TO_TICKS(100));
-            
-            Serial.println("\n[Sensor] CAR DETECTED AT ENTRY!");
-            
-            vTaskDelay(pdMS_TO_TICKS(100));
-        }
-        if(digitalRead(IR_ENTRY_PIN) == HIGH) entryDetected = false;
+        ulTaskNotifyTake(pdTRUE, irSensorNextTimeout());
         
-        // Check exit sensor (LOW = car detected)
-        if(digitalRead(IR_EXIT_PIN) == LOW && !exitDetected) {
-            exitDetected = true;
-            event.type = EVENT_CAR_EXIT;
-            event.value = 1;
-            xQueueSend(exitQueue, &event, pdMS_TO_TICKS(100));
-            
-            Serial.println("\n[Sensor] CAR DETECTED AT EXIT!");
-            
-            vTaskDelay(pdMS_TO_TICKS(100));
+        // LOW = car detected, HIGH = car has passed (lets the barrier close early)
+        while(irSensorPoll(&edge)) {
+            reportBeam(edge.channel, edge.level == LOW, edge.timeUs);
+        }
+    }
+#else
+    bool detected[LANE_MAX] = { false };
+    for(int l = 0; l < laneCount(); l++) pinMode(lanes[l].config->irPin, INPUT);
+    
+    while(1) {
+        // LOW = car detected
+        for(int l = 0; l < laneCount(); l++) {
+            bool blocked = digitalRead(lanes[l].config->irPin) == LOW;
+            if(blocked != detected[l]) {
+                detected[l] = blocked;
+                reportBeam(l, blocked, esp_timer_get_time());
+            }
         }
-        if(digitalRead(IR_EXIT_PIN) == HIGH) exitDetected = false;
         
-        vTaskDelay(pdMS_TO_TICKS(50));
+        vTaskDelay(pdMS_TO_TICKS(SENSOR_CHECK_INTERVAL));
+    }
+#endif
+}
+
+static bool firstActuationDone = false;    // Boot log: any barrier opened yet
+
+/**
+ * @brief Drive a barrier servo for a state machine action (GateFlowHooks)
+ */
+static int64_t actuateBarrier(int index, GateAction action) {
+    Barrier *barrier = &barriers[index];
+    
+    if(action == GATE_ACTION_OPEN) {
+        Serial.printf("  [%s] Opening barrier (%d degrees)...\n", barrier->name, SERVO_OPEN_ANGLE);
+        servoMotionMoveTo(&barrier->servo, SERVO_OPEN_ANGLE);
+        if(!__atomic_exchange_n(&firstActuationDone, true, __ATOMIC_RELAXED)) {
+            logBootMilestone("First gate actuation");
+        }
+        journalAppend(EVENT_GATE_OPEN, index);
+        mqttUplinkRecord(EVENT_GATE_OPEN, index);
+        historyCountGateCycle();
+    } else if(action == GATE_ACTION_CLOSE) {
+        Serial.printf("  [%s] Closing barrier (%d degrees)...\n", barrier->name, SERVO_CLOSED_ANGLE);
+        servoMotionMoveTo(&barrier->servo, SERVO_CLOSED_ANGLE);
+        journalAppend(EVENT_GATE_CLOSE, index);
+        mqttUplinkRecord(EVENT_GATE_CLOSE, index);
+    }
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief Rank states so the "most open" barrier is the one published
+ */
+static int gateOpenness(GateState state) {
+    switch(state) {
+        case GATE_OPEN:    return 3;
+        case GATE_OPENING: return 2;
+        case GATE_CLOSING: return 1;
+        default:           return 0;
+    }
+}
+
+/**
+ * @brief Publish the combined barrier state (no-op when unchanged)
+ *
+ * Every gate task calls this; the mutex keeps a stale combination from
+ * one task landing after a fresher one from another.
+ */
+static void publishGateStatus() {
+    GateState shown = GATE_IDLE;
+    
+    metricsMutexTake(METRICS_MUTEX_GATE_STATUS, gateStatusMutex, portMAX_DELAY);
+    for(int i = 0; i < laneBarrierCount(); i++) {
+        GateState state = gateFlowFsm(i)->state;
+        if(gateOpenness(state) > gateOpenness(shown)) {
+            shown = state;
+        }
+    }
+    parkingStatePublishGate(shown);
+    xSemaphoreGive(gateStatusMutex);
+}
+
+/**
+ * @brief Show a two-line message on the LCD for LCD_MESSAGE_HOLD_MS
+ */
+static void showLcdMessage(const char *line1, const char *line2) {
+    LCDMessage lcdMsg;
+    
+    strlcpy(lcdMsg.line1, line1, sizeof(lcdMsg.line1));
+    strlcpy(lcdMsg.line2, line2, sizeof(lcdMsg.line2));
+    if(metricsQueueSend(METRICS_QUEUE_LCD, &lcdMsg, 0) && lcdTaskHandle != NULL) {
+        xTaskNotifyGive(lcdTaskHandle);
+    }
+}
+
+/**
+ * @brief Journal, uplink, log and LCD for a counted car (GateFlowHooks)
+ */
+static void onCarCounted(int index, EventType type, bool reserved, int remaining) {
+    Lane *lane = &lanes[index];
+    char line1[LCD_COLS + 1];
+    
+    if(type == EVENT_PARKING_FULL) {
+        Serial.printf("[Gate] PARKING FULL - %s DENIED!\n\n", lane->config->name);
+        journalAppend(EVENT_PARKING_FULL, 0);
+        mqttUplinkRecord(EVENT_PARKING_FULL, index);
+        return;
+    }
+    
+    journalAppend(type, remaining);
+    forecastRecord(type);
+    mqttUplinkRecord(type, index);
+    Serial.printf("[Gate] %s%s - New slots: %d/%d\n", lane->config->name, reserved ? " (reserved)" : "", remaining, lotCapacity);
+    if(type == EVENT_CAR_ENTRY && remaining == 0) {
+        Serial.println("  PARKING NOW FULL!");
+    }
+    
+    snprintf(line1, sizeof(line1), "%s: OPEN", lane->config->name);
+    if(type == EVENT_CAR_EXIT) showLcdMessage(line1, "Exiting...");
+    else showLcdMessage(line1, reserved ? "Reserved" : "Entering...");
+}
+
+/**
+ * @brief Time edge-to-servo latency of every opening (GateFlowHooks)
+ */
+static void onCarDecided(const SystemEvent *event, TraceOutcome outcome, int64_t actuatedUs) {
+    if(outcome == TRACE_OPENED) metricsObserveGateLatency(actuatedUs - event->detectedUs);
+}
+
+static const GateFlowHooks gateFlowHooks = { actuateBarrier, reservationWaiting, reservationClaim, onCarCounted, onCarDecided };
+
+/**
+ * @brief Remote open - lift the barrier without taking or freeing a slot
+ */
+static void handleRemoteOpen(Lane *lane, uint32_t nowMs) {
+    char line1[LCD_COLS + 1];
+    
+    Serial.printf("[Gate] %s - Remote open\n", lane->config->name);
+    snprintf(line1, sizeof(line1), "%s: OPEN", lane->config->name);
+    showLcdMessage(line1, "Remote");
+    
+    gateFlowRemoteOpen(laneBarrier(lane - lanes), nowMs);
+}
+
+/**
+ * @brief A reservation checked in at this lane
+ *
+ * A car still in the beam after being turned away as a walk-in is let in
+ * now. Otherwise (beam clear, or the car in it was already admitted) the
+ * booking stays checked in and the next entry event on the lane is the
+ * booked car.
+ */
+static void handleReservedArrival(Lane *lane, const SystemEvent *event, uint32_t nowMs) {
+    if(!lane->deniedWaiting) {
+        Serial.printf("[Gate] %s - Reservation checked in, waiting for the car\n", lane->config->name);
+        return;
     }
+    
+    // Recorded as an entry of its own, so it only now takes a trace number
+    SystemEvent entry = *event;
+    entry.type = EVENT_CAR_ENTRY;
+    entry.seq = traceNextSeq();
+    lane->deniedWaiting = gateFlowEntry(lane - lanes, &entry, nowMs) == TRACE_DENIED;
 }
 
 /**
- * @brief Gate control task - handles entry/exit events
+ * @brief Gate control task - one per barrier, parameter = Barrier *
  * Runs on Core 0 (Hardware)
+ *
+ * Blocks on the queue set of the barrier's lanes until an event arrives
+ * or the barrier's next deadline expires. Barriers never wait on each
+ * other; lanes sharing a barrier are served in arrival order.
  */
 void gateTask(void *parameter) {
+    Barrier *barrier = (Barrier *)parameter;
+    int index = barrier - barriers;
     SystemEvent event;
-    LCDMessage lcdMsg;
     
-    Serial.println("[Gate] Started on Core 0");
+    Serial.printf("[Gate] %s started on Core 0 at %lu ms\n", barrier->name, (unsigned long)(esp_timer_get_time() / 1000));
     
     while(1) {
-        // Process entry events
-        if(xQueueReceive(entryQueue, &event, pdMS_TO_TICKS(10)) == pdTRUE) {
-            if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-                if(availableSlots > 0) {
-                    Serial.printf("[Gate] ENTRY - Slots: %d/%d\n", availableSlots, TOTAL_SLOTS);
-                    
-                    xSemaphoreGive(slotsMutex);
-                    
-                    // Update gate status
-                    if(xSemaphoreTake(gateStatusMutex, portMAX_DELAY) == pdTRUE) {
-                        gateStatus = "Open";
-                        xSemaphoreGive(gateStatusMutex);
-                    }
-                    
-                    // Update LCD
-                    strcpy(lcdMsg.line1, "Gate: OPEN");
-                    strcpy(lcdMsg.line2, "Entering...");
-                    xQueueSend(lcdQueue, &lcdMsg, pdMS_TO_TICKS(100));
-                    
-                    // Open barrier
-                    Serial.println("  Opening barrier (0 degrees)...");
-                    barrierServo.write(0);
-                    
-                    // Wait for car to pass
-                    Serial.println("  Waiting 2 seconds for car passage...");
-                    vTaskDelay(pdMS_TO_TICKS(2000));
-                    
-                    // Close barrier
-                    Serial.println("  Closing barrier (90 degrees)...");
-                    barrierServo.write(90);
-                    
-                    // Update gate status
-                    if(xSemaphoreTake(gateStatusMutex, portMAX_DELAY) == pdTRUE) {
-                        gateStatus = "Closed";
-                        xSemaphoreGive(gateStatusMutex);
-                    }
-                    
-                    // Decrement available slots
-                    if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-                        availableSlots--;
-                        Serial.printf("  Entry complete! New slots: %d/%d\n", availableSlots, TOTAL_SLOTS);
-                        
-                        if(availableSlots == 0) {
-                            Serial.println("  PARKING NOW FULL!");
-                        }
-                        
-                        xSemaphoreGive(slotsMutex);
-                    }
-                    Serial.println("");
-                } else {
-                    Serial.println("[Gate] PARKING FULL - Entry DENIED!\n");
-                    xSemaphoreGive(slotsMutex);
-                }
-            }
+        // Sleep until the barrier's deadline, or forever if idle
+        uint32_t now = millis();
+        TickType_t wait = portMAX_DELAY;
+        int32_t ms = gateFsmTimeToNext(gateFlowFsm(index), now);
+        if(ms >= 0) {
+            wait = pdMS_TO_TICKS(ms);
+            if(ms > 0 && wait == 0) wait = 1;
         }
         
-        // Process exit events
-        if(xQueueReceive(exitQueue, &event, pdMS_TO_TICKS(10)) == pdTRUE) {
-            Serial.println("[Gate] EXIT PROCESSING");
-            
-            // Update gate status
-            if(xSemaphoreTake(gateStatusMutex, portMAX_DELAY) == pdTRUE) {
-                gateStatus = "Open";
-                xSemaphoreGive(gateStatusMutex);
-            }
-            
-            // Update LCD
-            strcpy(lcdMsg.line1, "Gate: OPEN");
-            strcpy(lcdMsg.line2, "Exiting...");
-            xQueueSend(lcdQueue, &lcdMsg, pdMS_TO_TICKS(100));
-            
-            // Open barrier
-            Serial.println("  Opening barrier (0 degrees)...");
-            barrierServo.write(0);
-            
-            // Wait for car to pass
-            Serial.println("  Waiting 2 seconds...");
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            
-            // Close barrier
-            Serial.println("  Closing barrier (90 degrees)...");
-            barrierServo.write(90);
-            
-            // Update gate status
-            if(xSemaphoreTake(gateStatusMutex, portMAX_DELAY) == pdTRUE) {
-                gateStatus = "Closed";
-                xSemaphoreGive(gateStatusMutex);
-            }
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(barrier->events, wait);
+        now = millis();
+        
+        for(int l = 0; ready != NULL && l < laneCount(); l++) {
+            Lane *lane = &lanes[l];
+            if(lane->queue != ready || xQueueReceive(lane->queue, &event, 0) != pdTRUE) continue;
             
-            // Increment available slots
-            if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-                if(availableSlots < TOTAL_SLOTS) {
-                    availableSlots++;
-                    Serial.printf("  Exit complete! New slots: %d/%d\n", availableSlots, TOTAL_SLOTS);
-                }
-                xSemaphoreGive(slotsMutex);
+            event.dequeuedUs = esp_timer_get_time();
+            if(event.type == EVENT_BEAM_CLEAR) {
+                lane->deniedWaiting = false;
+                gateFlowBeamClear(l, now);
+            } else if(event.type == EVENT_REMOTE_OPEN) {
+                handleRemoteOpen(lane, now);
+            } else if(event.type == EVENT_RESERVED_ARRIVAL) {
+                handleReservedArrival(lane, &event, now);
+            } else if(lane->config->direction == LANE_ENTRY) {
+                lane->deniedWaiting = gateFlowEntry(l, &event, now) == TRACE_DENIED;
+            } else {
+                gateFlowExit(l, &event, now);
             }
-            Serial.println("");
+            break;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(10));
+        gateFlowTick(index, now);
+        publishGateStatus();
+        
+        // Light sleep would stop the servo's PWM mid-swing or while open
+        bool active = gateFlowFsm(index)->state != GATE_IDLE;
+        if(active != barrier->awake) {
+            barrier->awake = active;
+            powerStayAwake(active);
+        }
     }
 }
 
 /**
  * @brief LED indicator task
  * Runs on Core 0 (Hardware)
+ *
+ * Sleeps until the shared state changes (onStateChanged).
  */
 void ledTask(void *parameter) {
     pinMode(GREEN_LED_PIN, OUTPUT);
@@ -557,358 +733,216 @@ void ledTask(void *parameter) {
     
     Serial.println("[LED] Started on Core 0");
     
+    ParkingState state;
+    
     while(1) {
-        if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-            // Green = slots available, Red = parking full
-            digitalWrite(GREEN_LED_PIN, availableSlots > 0 ? HIGH : LOW);
-            digitalWrite(RED_LED_PIN, availableSlots > 0 ? LOW : HIGH);
-            xSemaphoreGive(slotsMutex);
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+        parkingStateRead(&state);
+        // Green = slots available, Red = full (reserved slots count as taken)
+        bool open = state.availableSlots > state.reservedSlots;
+        digitalWrite(GREEN_LED_PIN, open ? HIGH : LOW);
+        digitalWrite(RED_LED_PIN, open ? LOW : HIGH);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 }
 
 /**
  * @brief DHT22 temperature/humidity sensor task
  * Runs on Core 0 (Hardware)
+ *
+ * One RMT-captured transaction per cycle, so no interrupts are masked on
+ * the gate core. Samples are median-gated and smoothed; the shared state
+ * is only updated when a value moves by DHT_TEMP_STEP_C / DHT_HUM_STEP_PCT.
  */
 void dhtTask(void *parameter) {
     Serial.println("[DHT] Started on Core 0");
     
-    float lastTemp = -999;
-    float lastHum = -999;
+    SensorFilter tempFilter;
+    SensorFilter humFilter;
+    sensorFilterInit(&tempFilter, DHT_EMA_ALPHA, DHT_OUTLIER_TEMP_C);
+    sensorFilterInit(&humFilter, DHT_EMA_ALPHA, DHT_OUTLIER_HUM_PCT);
+    
+    float lastTemp = 0;
+    float lastHum = 0;
     bool firstReading = true;
     
     while(1) {
-        float h = dht.readHumidity();
-        float t = dht.readTemperature();
+        DhtReading raw;
+        DhtStatus status = dhtRead(&raw);
         
-        if (!isnan(h) && !isnan(t)) {
-            if(xSemaphoreTake(dhtMutex, portMAX_DELAY) == pdTRUE) {
-                temperature = t;
-                humidity = h;
-                xSemaphoreGive(dhtMutex);
-                
-                // Only log significant changes
-                if(firstReading || abs(t - lastTemp) > 0.5 || abs(h - lastHum) > 2.0) {
-                    Serial.printf("[DHT] Temp: %.1fC | Humidity: %.1f%%\n", t, h);
-                    lastTemp = t;
-                    lastHum = h;
-                    firstReading = false;
-                }
+        if(status == DHT_OK) {
+            bool tempOk = sensorFilterAdd(&tempFilter, raw.temperature);
+            bool humOk = sensorFilterAdd(&humFilter, raw.humidity);
+            if(!tempOk || !humOk) {
+                Serial.printf("[DHT] Outlier ignored: %.1fC | %.1f%%\n", raw.temperature, raw.humidity);
+            }
+            
+            float t = tempFilter.value;
+            float h = humFilter.value;
+            
+            // Publish (and log) significant changes only
+            if(firstReading || fabsf(t - lastTemp) >= DHT_TEMP_STEP_C || fabsf(h - lastHum) >= DHT_HUM_STEP_PCT) {
+                parkingStatePublishEnv(t, h);
+                Serial.printf("[DHT] Temp: %.1fC | Humidity: %.1f%%\n", t, h);
+                lastTemp = t;
+                lastHum = h;
+                firstReading = false;
             }
         } else {
-            Serial.println("[DHT] Invalid reading - check wiring");
+            Serial.printf("[DHT] Invalid reading (%s) - check wiring\n", dhtStatusName(status));
         }
         
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        vTaskDelay(pdMS_TO_TICKS(DHT_READ_INTERVAL));
     }
 }
 
 /**
  * @brief LCD display task
  * Runs on Core 1 (Communication)
+ *
+ * Sleeps until the state changes, a message arrives or the clock ticks,
+ * then redraws only the characters that differ from what is on screen.
  */
 void lcdTask(void *parameter) {
     LCDMessage msg;
-    TickType_t lastUpdate = 0;
-    const TickType_t updateInterval = pdMS_TO_TICKS(500);
+    LcdFrame frame;
+    bool showingMessage = false;
+    TickType_t messageUntil = 0;
     
     Serial.println("[LCD] Started on Core 1");
+    lcdRendererBegin(&lcd);
     
     while(1) {
-        // Check for priority messages in queue
-        if(xQueueReceive(lcdQueue, &msg, pdMS_TO_TICKS(10)) == pdTRUE) {
-            if(xSemaphoreTake(lcdMutex, portMAX_DELAY) == pdTRUE) {
-                lcd.clear();
-                lcd.setCursor(0, 0);
-                lcd.print(msg.line1);
-                lcd.setCursor(0, 1);
-                lcd.print(msg.line2);
-                xSemaphoreGive(lcdMutex);
-            }
-            lastUpdate = xTaskGetTickCount();
+        // Gate messages take over the screen for a moment
+        while(xQueueReceive(lcdQueue, &msg, 0) == pdTRUE) {
+            lcdFramePrintf(&frame, 0, "%s", msg.line1);
+            lcdFramePrintf(&frame, 1, "%s", msg.line2);
+            showingMessage = true;
+            messageUntil = xTaskGetTickCount() + pdMS_TO_TICKS(LCD_MESSAGE_HOLD_MS);
         }
-        // Default display update
-        else if((xTaskGetTickCount() - lastUpdate) >= updateInterval) {
-            if(xSemaphoreTake(lcdMutex, portMAX_DELAY) == pdTRUE) {
-                lcd.clear();
-                
-                // Line 1: Time and slots
-                lcd.setCursor(0, 0);
-                String timeStr = "";
-                if(xSemaphoreTake(timeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                    timeStr = currentTime;
-                    xSemaphoreGive(timeMutex);
-                }
-                lcd.print(timeStr);
-                lcd.print(" ");
-                
-                if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-                    lcd.print(availableSlots);
-                    xSemaphoreGive(slotsMutex);
-                }
-                lcd.print("/");
-                lcd.print(TOTAL_SLOTS);
-                
-                // Line 2: Gate status
-                lcd.setCursor(0, 1);
-                lcd.print("Gate:");
-                if(xSemaphoreTake(gateStatusMutex, portMAX_DELAY) == pdTRUE) {
-                    lcd.print(gateStatus);
-                    xSemaphoreGive(gateStatusMutex);
-                }
-                
-                xSemaphoreGive(lcdMutex);
+        
+        TickType_t now = xTaskGetTickCount();
+        if(showingMessage && (int32_t)(now - messageUntil) >= 0) {
+            showingMessage = false;
+        }
+        
+        // Default display: time and slots, gate status. A federated node
+        // shows the site total (or where to go when full) while the gate rests
+        if(!showingMessage) {
+            ParkingState state;
+            char timeText[TIME_TEXT_LEN];
+            
+            parkingStateRead(&state);
+            timeFormatEpoch(timeServiceNow(), timeText, NULL);
+            lcdFramePrintf(&frame, 0, "%s %d/%d", timeText, state.availableSlots - state.reservedSlots, state.totalSlots);
+            if(state.gate == GATE_IDLE && state.redirect[0]) {
+                lcdFramePrintf(&frame, 1, "Try %s", state.redirect);
+            } else if(state.gate == GATE_IDLE && state.siteNodes > 1) {
+                lcdFramePrintf(&frame, 1, "Site %d/%d", state.siteAvailable, state.siteTotal);
+            } else {
+                lcdFramePrintf(&frame, 1, "Gate:%s", gateStateName(state.gate));
             }
-            lastUpdate = xTaskGetTickCount();
         }
         
-        vTaskDelay(pdMS_TO_TICKS(50));
+        lcdRendererDraw(&frame);
+        
+        // Wake on the next second so the clock ticks in step
+        TickType_t wait = showingMessage ? messageUntil - now : pdMS_TO_TICKS(timeServiceMsToNextSecond());
+        ulTaskNotifyTake(pdTRUE, wait);
     }
 }
 
 /**
- * @brief Web server task
+ * @brief Wake the events, LCD and LED tasks whenever the shared state changes
+ */
+static void onStateChanged() {
+    if(eventsTaskHandle != NULL) xTaskNotifyGive(eventsTaskHandle);
+    if(lcdTaskHandle != NULL) xTaskNotifyGive(lcdTaskHandle);
+    if(ledTaskHandle != NULL) xTaskNotifyGive(ledTaskHandle);
+}
+
+/**
+ * @brief Push "full" / "space freed" alerts when walk-in vacancy crosses 0
+ *
+ * A listener rather than a call in the gate paths, so slots freed by a
+ * cancelled or expired reservation, or by a capacity change, alert too.
+ * The exchange makes sure a transition seen by two writers alerts once.
+ */
+static volatile bool lotFull = false;
+
+static void onVacancyChanged() {
+    ParkingState state;
+    
+    parkingStateRead(&state);
+    bool full = state.availableSlots - state.reservedSlots <= 0;
+    if(__atomic_exchange_n(&lotFull, full, __ATOMIC_RELAXED) == full) return;
+    
+    if(full) telegramAlert(TELEGRAM_TOPIC_FULL, "*🚫 Parking FULL*\n\nAll slots are occupied.");
+    else telegramAlert(TELEGRAM_TOPIC_FREED, "*✅ Space freed*\n\nA slot is available again.");
+}
+
+/**
+ * @brief Live event push task (/events subscribers)
  * Runs on Core 1 (Communication)
+ *
+ * Sleeps until a state publish notifies it; sends a keep-alive comment
+ * when nothing has changed for SSE_KEEPALIVE_MS.
  */
-void webServerTask(void *parameter) {
-    Serial.println("[Web] Started on Core 1");
+void eventsTask(void *parameter) {
+    ParkingState state;
+    
+    Serial.println("[Events] Started on Core 1");
     
     while(1) {
-        server.handleClient();
-        vTaskDelay(pdMS_TO_TICKS(10));
+        if(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SSE_KEEPALIVE_MS)) > 0) {
+            parkingStateRead(&state);
+            liveEventsPublish(&state);
+        } else {
+            liveEventsHeartbeat();
+        }
     }
 }
 
 /**
- * @brief Telegram bot task
+ * @brief Telegram bot task - long-polls for commands
  * Runs on Core 1 (Communication)
+ *
+ * getUpdates blocks server-side for up to TELEGRAM_LONG_POLL_SEC on a
+ * TLS session that stays open between polls; replies are queued to
+ * telegramSendTask so they never delay the next poll.
  */
 void telegramTask(void *parameter) {
     Serial.println("[Telegram] Started on Core 1");
+    bot.longPoll = TELEGRAM_LONG_POLL_SEC;
     
     while(1) {
+        unsigned long pollStart = millis();
         int numNewMessages = bot.getUpdates(bot.last_message_received + 1);
         
+        // A poll that returns empty-handed at once means no connection;
+        // back off instead of re-handshaking in a tight loop
+        if(numNewMessages == 0 && millis() - pollStart < TELEGRAM_CHECK_INTERVAL) {
+            connectivityReport(CONN_SOURCE_TELEGRAM, false);
+            vTaskDelay(pdMS_TO_TICKS(TELEGRAM_CHECK_INTERVAL));
+            continue;
+        }
+        connectivityReport(CONN_SOURCE_TELEGRAM, true);
+        
         for(int i = 0; i < numNewMessages; i++) {
-            String chat_id = bot.messages[i].chat_id;
-            String text = bot.messages[i].text;
+            const String &chatId = bot.messages[i].chat_id;
+            const String &text = bot.messages[i].text;
             
             Serial.printf("[Telegram] Received command: %s\n", text.c_str());
             
-            if(text == "/start") {
-                String msg = "*🚗 FreeRTOS Parking System*\n\n";
-                msg += "Available Commands:\n";
-                msg += "/status - Parking status\n";
-                msg += "/time - Date & Time\n";
-                msg += "/temp - Temperature\n";
-                msg += "/all - Complete info";
-                bot.sendMessage(chat_id, msg, "Markdown");
-            }
-            else if(text == "/status") {
-                String msg = "*🅿️ Parking Status*\n\n";
-                if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-                    msg += "Available: " + String(availableSlots) + "/" + String(TOTAL_SLOTS);
-                    if(availableSlots == 0) msg += " ❌ FULL";
-                    else msg += " ✅";
-                    xSemaphoreGive(slotsMutex);
-                }
-                bot.sendMessage(chat_id, msg, "Markdown");
-            }
-            else if(text == "/time") {
-                String msg = "*🕒 Date & Time*\n\n";
-                if(xSemaphoreTake(timeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                    msg += "📅 " + currentDate + "\n";
-                    msg += "⏰ " + currentTime;
-                    xSemaphoreGive(timeMutex);
-                }
-                bot.sendMessage(chat_id, msg, "Markdown");
-            }
-            else if(text == "/temp") {
-                String msg = "*🌡️ Environment*\n\n";
-                if(xSemaphoreTake(dhtMutex, portMAX_DELAY) == pdTRUE) {
-                    msg += "Temperature: " + String(temperature, 1) + "°C\n";
-                    msg += "Humidity: " + String(humidity, 1) + "%";
-                    xSemaphoreGive(dhtMutex);
-                }
-                bot.sendMessage(chat_id, msg, "Markdown");
-            }
-            else if(text == "/all") {
-                String msg = "*📊 Complete Status*\n\n";
-                if(xSemaphoreTake(timeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                    msg += "📅 " + currentDate + " " + currentTime + "\n\n";
-                    xSemaphoreGive(timeMutex);
-                }
-                if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-                    msg += "🅿️ Parking: " + String(availableSlots) + "/" + String(TOTAL_SLOTS) + "\n";
-                    xSemaphoreGive(slotsMutex);
-                }
-                if(xSemaphoreTake(dhtMutex, portMAX_DELAY) == pdTRUE) {
-                    msg += "🌡️ Temp: " + String(temperature, 1) + "°C\n";
-                    msg += "💧 Humidity: " + String(humidity, 1) + "%";
-                    xSemaphoreGive(dhtMutex);
-                }
-                bot.sendMessage(chat_id, msg, "Markdown");
-            }
+            telegramHandleCommand(chatId.c_str(), text.c_str());
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
-// ============================================================================
-// WEB SERVER HANDLERS
-// ============================================================================
-
 /**
- * @brief Handle /data endpoint - returns JSON with all sensor data
+ * @brief UART receive callback (UART event task) - wake the console
  */
-void handleData() {
-    String json = "{";
-    
-    if(xSemaphoreTake(slotsMutex, portMAX_DELAY) == pdTRUE) {
-        json += "\"available\":" + String(availableSlots) + ",";
-        json += "\"occupied\":" + String(TOTAL_SLOTS - availableSlots) + ",";
-        xSemaphoreGive(slotsMutex);
-    }
-    
-    if(xSemaphoreTake(gateStatusMutex, portMAX_DELAY) == pdTRUE) {
-        json += "\"gate\":\"" + gateStatus + "\",";
-        xSemaphoreGive(gateStatusMutex);
-    }
-    
-    if(xSemaphoreTake(dhtMutex, portMAX_DELAY) == pdTRUE) {
-        json += "\"temperature\":" + String(temperature, 1) + ",";
-        json += "\"humidity\":" + String(humidity, 1) + ",";
-        xSemaphoreGive(dhtMutex);
-    }
-    
-    if(xSemaphoreTake(timeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-        json += "\"time\":\"" + currentTime + "\",";
-        json += "\"date\":\"" + currentDate + "\",";
-        xSemaphoreGive(timeMutex);
-    }
-    
-    json += "\"wifi\":" + String(wifiConnected ? "true" : "false") + ",";
-    json += "\"internet\":" + String(internetConnected ? "true" : "false") + ",";
-    json += "\"uptime\":" + String(millis() / 1000);
-    
-    json += "}";
-    server.send(200, "application/json", json);
-}
-
-/**
- * @brief Generate HTML for web dashboard
- */
-String getHTML() {
-    String html = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <meta charset='UTF-8'>
-    <meta name='viewport' content='width=device-width,initial-scale=1.0'>
-    <title>FreeRTOS Parking</title>
-    <style>
-        *{margin:0;padding:0;box-sizing:border-box}
-        body{font-family:'Segoe UI',Arial,sans-serif;background:linear-gradient(135deg,#667eea 0%,#764ba2 100%);color:#fff;min-height:100vh;padding:20px}
-        .container{max-width:1200px;margin:0 auto}
-        h1{text-align:center;font-size:2.5em;margin-bottom:10px;text-shadow:2px 2px 4px rgba(0,0,0,0.3)}
-        .subtitle{text-align:center;font-size:1.1em;opacity:0.9;margin-bottom:30px}
-        .status-bar{background:rgba(255,255,255,0.1);border-radius:15px;padding:15px;margin-bottom:20px;display:flex;justify-content:space-around;flex-wrap:wrap;backdrop-filter:blur(10px)}
-        .status-item{text-align:center;padding:10px}
-        .status-item .label{font-size:0.9em;opacity:0.8;margin-bottom:5px}
-        .status-item .value{font-size:1.3em;font-weight:bold}
-        .grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(250px,1fr));gap:20px;margin:20px 0}
-        .card{background:rgba(255,255,255,0.15);border-radius:20px;padding:25px;text-align:center;backdrop-filter:blur(10px);border:2px solid rgba(255,255,255,0.2);transition:transform 0.3s,box-shadow 0.3s}
-        .card:hover{transform:translateY(-5px);box-shadow:0 10px 30px rgba(0,0,0,0.3)}
-        .icon{font-size:3em;margin-bottom:15px}
-        .label{font-size:1em;opacity:0.8;margin-bottom:10px;text-transform:uppercase;letter-spacing:1px}
-        .stat{font-size:3em;font-weight:bold;margin:10px 0;text-shadow:2px 2px 4px rgba(0,0,0,0.2)}
-        .unit{font-size:0.5em;opacity:0.9}
-        .badge{display:inline-block;background:rgba(255,255,255,0.2);padding:8px 15px;border-radius:20px;font-size:0.9em;margin-top:10px}
-        .green{color:#00ff88}
-        .red{color:#ff4444}
-        .blue{color:#4488ff}
-        .orange{color:#ff8844}
-        .pulse{animation:pulse 2s infinite}
-        @keyframes pulse{0%,100%{opacity:1}50%{opacity:0.6}}
-        .footer{text-align:center;margin-top:30px;padding:20px;opacity:0.7;font-size:0.9em}
-        @media(max-width:768px){h1{font-size:2em}.stat{font-size:2.5em}.grid{grid-template-columns:1fr}}
-    </style>
-</head>
-<body>
-    <div class='container'>
-        <h1>🚗 FreeRTOS Parking System</h1>
-        <div class='subtitle'>Real-Time Multitasking Dashboard</div>
-        
-        <div class='status-bar'>
-            <div class='status-item'><div class='label'>📅 Date</div><div class='value' id='date'>--</div></div>
-            <div class='status-item'><div class='label'>🕒 Time</div><div class='value' id='time'>--</div></div>
-            <div class='status-item'><div class='label'>📡 WiFi</div><div class='value' id='wifi'>--</div></div>
-            <div class='status-item'><div class='label'>🌐 Internet</div><div class='value' id='internet'>--</div></div>
-            <div class='status-item'><div class='label'>⏱️ Uptime</div><div class='value' id='uptime'>--</div></div>
-        </div>
-        
-        <div class='grid'>
-            <div class='card'><div class='icon'>🅿️</div><div class='label'>Available Slots</div><div id='available' class='stat green'>0</div><div class='badge'>Spaces Free</div></div>
-            <div class='card'><div class='icon'>🚙</div><div class='label'>Occupied</div><div id='occupied' class='stat red'>0</div><div class='badge'>Cars Inside</div></div>
-            <div class='card'><div class='icon'>🚧</div><div class='label'>Gate Status</div><div id='gate' class='stat red'>Closed</div><div class='badge' id='gateBadge'>Barrier Down</div></div>
-            <div class='card'><div class='icon'>🌡️</div><div class='label'>Temperature</div><div id='temp' class='stat orange'>--<span class='unit'>°C</span></div><div class='badge'>Live Data</div></div>
-            <div class='card'><div class='icon'>💧</div><div class='label'>Humidity</div><div id='humid' class='stat blue'>--<span class='unit'>%</span></div><div class='badge'>Live Data</div></div>
-            <div class='card'><div class='icon'>⚡</div><div class='label'>System Status</div><div class='stat green'>ONLINE</div><div class='badge pulse'>8 Tasks Running</div></div>
-        </div>
-        
-        <div class='footer'>Powered by ESP32 FreeRTOS | 8 Concurrent Tasks | Dual Core Processing</div>
-    </div>
-    
-    <script>
-        function formatUptime(sec) {
-            const h = Math.floor(sec / 3600);
-            const m = Math.floor((sec % 3600) / 60);
-            const s = sec % 60;
-            return h + 'h ' + m + 'm ' + s + 's';
-        }
-        
-        async function update() {
-            try {
-                const r = await fetch('/data');
-                const d = await r.json();
-                
-                document.getElementById('available').innerText = d.available;
-                document.getElementById('occupied').innerText = d.occupied;
-                
-                const g = document.getElementById('gate');
-                const gb = document.getElementById('gateBadge');
-                g.innerText = d.gate;
-                if (d.gate == 'Open') {
-                    g.className = 'stat green';
-                    gb.innerText = 'Barrier Up';
-                } else {
-                    g.className = 'stat red';
-                    gb.innerText = 'Barrier Down';
-                }
-                
-                document.getElementById('temp').innerHTML = d.temperature + "<span class='unit'>°C</span>";
-                document.getElementById('humid').innerHTML = d.humidity + "<span class='unit'>%</span>";
-                document.getElementById('date').innerText = d.date;
-                document.getElementById('time').innerText = d.time;
-                document.getElementById('wifi').innerText = d.wifi ? '✅ Connected' : '❌ Offline';
-                document.getElementById('internet').innerText = d.internet ? '✅ Online' : '❌ Offline';
-                document.getElementById('uptime').innerText = formatUptime(d.uptime);
-            } catch (e) {
-                console.error(e);
-            }
-        }
-        
-        setInterval(update, 1000);
-        update();
-    </script>
-</body>
-</html>
-)rawliteral";
-    
-    return html;
+static void onSerialReceive() {
+    if(consoleTaskHandle != NULL) xTaskNotifyGive(consoleTaskHandle);
 }
 
 // ============================================================================
@@ -916,120 +950,197 @@ String getHTML() {
 // ============================================================================
 
 void setup() {
-    Serial.begin(115200);
-    delay(1000);
+    Serial.begin(SERIAL_BAUD_RATE);
     
     Serial.println("\n========================================");
     Serial.println("   SMART PARKING SYSTEM - FreeRTOS");
     Serial.println("========================================\n");
+    otaBegin();             // May roll back to the previous image and restart
+    heapWatchBegin();
+    heapWatchReport("Boot");
     
-    // Initialize I2C and LCD
+    // Shared state must exist before any task or network callback runs;
+    // a capacity set over MQTT overrides TOTAL_PARKING_SLOTS
+#if SLOT_SENSOR_TYPE == SLOT_SENSOR_NONE
+    Preferences prefs;
+    if(prefs.begin("parking", true)) {
+        lotCapacity = prefs.getShort("capacity", TOTAL_PARKING_SLOTS);
+        prefs.end();
+    }
+#endif
+    parkingStateInit(lotCapacity);
+    metricsBegin();
+    traceBegin();
+    
+    // I2C before anything that uses it: the bay scanner's MCP23017
+    // expanders share the LCD's bus
     Serial.println("[Hardware] Initializing...");
-    Wire.begin(21, 22);
+    Wire.begin(LCD_SDA, LCD_SCL);
     lcd.init();
+    Wire.setClock(LCD_I2C_CLOCK_HZ);   // After init(), which may restart the bus
     lcd.backlight();
     lcd.setCursor(0, 0);
     lcd.print("FreeRTOS Parking");
     lcd.setCursor(0, 1);
     lcd.print("Starting...");
     
-    // Initialize servo
-    barrierServo.attach(SERVO_PIN);
-    barrierServo.write(90);  // Start closed
-    Serial.println("[Servo] Attached to GPIO 25 (90 deg - Closed)");
+    // Restore occupancy from the flash journal, then let per-bay
+    // sensors (if fitted) overrule it with what is really there
+    JournalRecord lastRecord;
+    if(journalBegin(&lastRecord)) {
+        parkingStateSetAvailable(lastRecord.available);
+        Serial.printf("[Journal] Restored %d/%d free from event #%lu\n",
+                      lastRecord.available, lotCapacity, (unsigned long)lastRecord.seq);
+    }
+    slotScannerBegin();
+    reservationBegin(onReservationArrival);
+    historyBegin();
+    forecastBegin();
+    telegramOutboxBegin();  // Gate alerts queue up here until the network is there
     
-    // Initialize DHT sensor
-    dht.begin();
-    Serial.println("[DHT22] Sensor initialized on GPIO 4");
+    // Events from the gate tasks wait in the uplink backlog the same way
+    static const MqttCommandHandlers mqttCommands = { remoteOpenLane, remoteSetCapacity, otaStart };
+    mqttUplinkBegin(&mqttCommands);
+    federationBegin();
     
-    // Configure Telegram secure client
-    secured_client.setInsecure();
-    Serial.println("[Telegram] Secure client configured");
+    // Group lanes into barriers and initialize them (start closed)
+    lanesBegin();
+    uint32_t travelMs = servoMotionTravelMs(SERVO_OPEN_ANGLE - SERVO_CLOSED_ANGLE);
+    gateFlowBegin(&gateFlowHooks, travelMs);
+    for(int b = 0; b < laneBarrierCount(); b++) {
+        Barrier *barrier = &barriers[b];
+        uint8_t served = laneBarrierLanes(b);
+        
+        // A barrier with one lane takes its name; shared ones are "Gate"
+        if((served & (served - 1)) == 0) barrier->name = laneConfig(__builtin_ctz(served))->name;
+        else barrier->name = "Gate";
+        if(laneBarrierCount() == 1) strlcpy(barrier->taskName, "Gate", sizeof(barrier->taskName));
+        else snprintf(barrier->taskName, sizeof(barrier->taskName), "Gate%d", b);
+        
+        servoMotionAttach(&barrier->servo, laneBarrierPin(b), SERVO_LEDC_CHANNEL + b, SERVO_CLOSED_ANGLE);
+        Serial.printf("[Servo] %s barrier on GPIO %d (%d deg - Closed)\n", barrier->name, laneBarrierPin(b), SERVO_CLOSED_ANGLE);
+    }
+    for(int l = 0; l < laneCount(); l++) {
+        lanes[l].config = laneConfig(l);
+        lanes[l].barrier = &barriers[laneBarrier(l)];
+        Serial.printf("[Lane] %s: %s, IR GPIO %d -> %s barrier\n", lanes[l].config->name,
+                      lanes[l].config->direction == LANE_ENTRY ? "entry" : "exit",
+                      lanes[l].config->irPin, lanes[l].barrier->name);
+    }
+    Serial.printf("[Servo] Ramped swing %lu ms, close %d ms after the beam clears\n",
+                  (unsigned long)travelMs, GATE_CLEAR_GUARD_MS);
     
-    // Connect to WiFi
-    Serial.println("");
-    Serial.print("[WiFi] Connecting to: ");
-    Serial.println(ssid);
-    WiFi.begin(ssid, password);
+    // Create synchronization primitives
+    Serial.println("\n[RTOS] Creating synchronization primitives...");
+    parkingStateAddListener(onStateChanged);
+    ParkingState restored;
+    parkingStateRead(&restored);
+    lotFull = restored.availableSlots - restored.reservedSlots <= 0;
+    parkingStateAddListener(onVacancyChanged);
     
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+    // Create queues
+    for(int l = 0; l < laneCount(); l++) {
+        lanes[l].queue = laneQueueMem[l].create();
+        metricsRegisterQueue((MetricsQueueId)(METRICS_QUEUE_LANE + l), lanes[l].config->name, lanes[l].queue);
     }
-    Serial.println();
+    lcdQueue = lcdQueueMem.create();
+    metricsRegisterQueue(METRICS_QUEUE_LCD, "lcd", lcdQueue);
+    gateStatusMutex = xSemaphoreCreateMutexStatic(&gateStatusMutexMem);
     
-    if(WiFi.status() == WL_CONNECTED) {
-        Serial.print("[WiFi] Connected! IP: ");
-        Serial.println(WiFi.localIP());
-        wifiConnected = true;
-        
-        // Initialize NTP
-        initTime(NTP_SERVER, GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC);
-        delay(2000);
-    } else {
-        Serial.println("[WiFi] Connection failed!");
-        wifiConnected = false;
+    // Each gate task waits on all of its barrier's lanes at once
+    for(int b = 0; b < laneBarrierCount(); b++) {
+        barriers[b].events = xQueueCreateSet(__builtin_popcount(laneBarrierLanes(b)) * LANE_QUEUE_SIZE);
+    }
+    for(int l = 0; l < laneCount(); l++) {
+        xQueueAddToSet(lanes[l].queue, lanes[l].barrier->events);
     }
     
-    // Setup web server routes
-    server.on("/", []() { 
-        server.send(200, "text/html", getHTML()); 
-    });
-    server.on("/data", handleData);
-    server.begin();
-    Serial.print("[Web] Server started at http://");
-    Serial.println(WiFi.localIP());
+    // Core 0 tasks (Hardware) first: the barrier works before the LCD,
+    // WiFi or the clock are up. Gate messages wait in lcdQueue.
+    Serial.println("[RTOS] Creating tasks...\n");
+    sensorTaskHandle = countTask(sensorTaskMem.start(sensorTask, "Sensor"));
+    for(int b = 0; b < laneBarrierCount(); b++) {
+        gateTaskHandles[b] = countTask(gateTaskMem[b].start(gateTask, barriers[b].taskName, &barriers[b]));
+    }
+    ledTaskHandle = countTask(ledTaskMem.start(ledTask, "LED"));
+    journalTaskHandle = countTask(journalTaskMem.start(journalTask, "Journal"));
+#if SLOT_SENSOR_TYPE != SLOT_SENSOR_NONE
+    slotScanTaskHandle = countTask(slotScanTaskMem.start(slotScanTask, "Slots"));
+#endif
+    logBootMilestone("Gate control up");
     
-    // Create mutexes
-    Serial.println("\n[RTOS] Creating synchronization primitives...");
-    slotsMutex = xSemaphoreCreateMutex();
-    gateStatusMutex = xSemaphoreCreateMutex();
-    lcdMutex = xSemaphoreCreateMutex();
-    dhtMutex = xSemaphoreCreateMutex();
-    timeMutex = xSemaphoreCreateMutex();
+    // Initialize DHT sensor (RMT capture, see dht_reader.h)
+    if(dhtReaderBegin(DHT_PIN, DHT_TYPE)) {
+        dhtTaskHandle = countTask(dhtTaskMem.start(dhtTask, "DHT"));
+        Serial.printf("[DHT22] Sensor initialized on GPIO %d (RMT)\n", DHT_PIN);
+    }
     
-    // Create queues
-    entryQueue = xQueueCreate(5, sizeof(SystemEvent));
-    exitQueue = xQueueCreate(5, sizeof(SystemEvent));
-    lcdQueue = xQueueCreate(10, sizeof(LCDMessage));
+    // Configure Telegram secure client
+    secured_client.setInsecure();
+    Serial.println("[Telegram] Secure client configured");
     
-    // Create tasks
-    Serial.println("[RTOS] Creating tasks...\n");
+    // Start connecting; wifiTask reports the result from WiFi events
+    Serial.printf("[WiFi] Connecting to: %s\n", ssid);
+    WiFi.begin(ssid, password);
+    powerBegin();           // Modem sleep, DFS and light sleep (POWER_SAVE_MODE)
+    timeServiceBegin();     // SNTP keeps retrying until the network is up
     
-    // Core 0 tasks (Hardware)
-    xTaskCreatePinnedToCore(sensorTask, "Sensor", 4096, NULL, 3, &sensorTaskHandle, pro_cpu);
-    xTaskCreatePinnedToCore(dhtTask, "DHT", 3072, NULL, 1, &dhtTaskHandle, pro_cpu);
-    xTaskCreatePinnedToCore(gateTask, "Gate", 4096, NULL, 2, &gateTaskHandle, pro_cpu);
-    xTaskCreatePinnedToCore(ledTask, "LED", 2048, NULL, 1, &ledTaskHandle, pro_cpu);
+    // Start the web server (/, /data, /events); it listens before the
+    // station has an address and serves once it gets one
+    webServerBegin();
     
     // Core 1 tasks (Communication)
-    xTaskCreatePinnedToCore(lcdTask, "LCD", 4096, NULL, 1, &lcdTaskHandle, app_cpu);
-    xTaskCreatePinnedToCore(webServerTask, "Web", 8192, NULL, 1, &webServerTaskHandle, app_cpu);
-    xTaskCreatePinnedToCore(telegramTask, "Telegram", 8192, NULL, 1, &telegramTaskHandle, app_cpu);
-    xTaskCreatePinnedToCore(wifiTask, "WiFi", 6144, NULL, 1, &wifiTaskHandle, app_cpu);
+    lcdTaskHandle = countTask(lcdTaskMem.start(lcdTask, "LCD"));
+#if !WEB_ASYNC_BACKEND
+    webServerTaskHandle = countTask(webServerTaskMem.start(webServerTask, "Web"));
+#endif
+    telegramTaskHandle = countTask(telegramTaskMem.start(telegramTask, "Telegram"));
+    telegramSendTaskHandle = countTask(telegramSendTaskMem.start(telegramSendTask, "TelegramTx"));
+    wifiTaskHandle = countTask(wifiTaskMem.start(wifiTask, "WiFi"));
+    eventsTaskHandle = countTask(eventsTaskMem.start(eventsTask, "Events"));
+    if(mqttUplinkEnabled()) {
+        mqttTaskHandle = countTask(mqttTaskMem.start(mqttTask, "MQTT"));
+    }
+    if(otaEnabled()) {
+        countTask(otaTaskMem.start(otaTask, "OTA"));
+    }
+    if(federationEnabled()) {
+        countTask(federationTaskMem.start(federationTask, "Federation"));
+    }
     
     Serial.println("========================================");
-    Serial.println("   All 8 tasks created successfully!");
+    Serial.printf("   All %d tasks created successfully!\n", tasksStarted);
     Serial.println("   Waiting for sensor events...");
     Serial.println("========================================\n");
+    logBootMilestone("Setup done");
+    heapWatchReport("Setup done");
     
-    // Update LCD
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("System Ready!");
-    lcd.setCursor(0, 1);
-    lcd.print("4/4 Available");
+    // LCD belongs to lcdTask now
+    ParkingState state;
+    char readyLine[LCD_COLS + 1];
+    parkingStateRead(&state);
+    snprintf(readyLine, sizeof(readyLine), "%d/%d Available", state.availableSlots, state.totalSlots);
+    showLcdMessage("System Ready!", readyLine);
     
-    // Delete setup task (FreeRTOS takes over)
-    vTaskDelete(NULL);
+    // The setup task stays alive as the serial console and sleeps until
+    // the UART driver reports input
+    consoleTaskHandle = xTaskGetCurrentTaskHandle();
+    Serial.onReceive(onSerialReceive);
 }
 
 // ============================================================================
-// LOOP (Empty - FreeRTOS tasks handle everything)
+// LOOP (serial console only - FreeRTOS tasks handle everything else)
 // ============================================================================
 
+static bool serialSink(void *ctx, const char *data, size_t len) {
+    Serial.write((const uint8_t *)data, len);
+    return true;
+}
+
 void loop() {
-    // Empty - all work is done by FreeRTOS tasks
+    // 't' = dump the latency trace
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while(Serial.available()) {
+        if(Serial.read() == 't') traceWrite(serialSink, NULL);
+    }
 }
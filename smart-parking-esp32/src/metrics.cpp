@@ -0,0 +1,556 @@
+/**
+ * @file metrics.cpp
+ * @brief Runtime instrumentation: tasks, queues, mutexes, gate latency
+ */
+
+#include "metrics.h"
+#include "parking_state.h"
+#include "ir_sensor.h"
+#include "journal.h"
+#include "live_events.h"
+#include "telegram_outbox.h"
+#include "power.h"
+#include "mqtt_uplink.h"
+#include "connectivity.h"
+#include "heap_watch.h"
+#include "reservation.h"
+#include "ota_update.h"
+#include "forecast.h"
+#include "federation.h"
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <stdarg.h>
+
+#define METRICS_MAX_TASKS 24
+
+typedef struct {
+    const char *name;
+    QueueHandle_t queue;
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t peakDepth;
+} QueueStats;
+
+typedef struct {
+    uint32_t acquisitions;
+    uint32_t timeouts;
+    uint64_t waitUsTotal;
+    uint32_t waitUsMax;
+} MutexStats;
+
+static const char *const mutexNames[METRICS_MUTEX_COUNT] = { "sse_clients", "web_streams", "journal", "gate_status" };
+
+// Gate latency histogram bucket upper bounds (cumulative in the output)
+static const uint32_t latencyBoundsUs[] = { 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 500000 };
+#define LATENCY_BUCKETS (sizeof(latencyBoundsUs) / sizeof(latencyBoundsUs[0]))
+
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static QueueStats queues[METRICS_QUEUE_COUNT];
+static MutexStats mutexes[METRICS_MUTEX_COUNT];
+static uint32_t latencyCounts[LATENCY_BUCKETS + 1];     // Last one is +Inf
+static uint64_t latencyUsTotal = 0;
+static uint32_t latencyCount = 0;
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+void metricsRegisterQueue(MetricsQueueId id, const char *name, QueueHandle_t queue) {
+    queues[id].name = name;
+    queues[id].queue = queue;
+}
+
+bool metricsQueueSend(MetricsQueueId id, const void *item, TickType_t wait) {
+    QueueStats *q = &queues[id];
+    bool sent = xQueueSend(q->queue, item, wait) == pdTRUE;
+    uint32_t depth = sent ? uxQueueMessagesWaiting(q->queue) : 0;
+
+    portENTER_CRITICAL(&statsLock);
+    if(sent) {
+        q->sent++;
+        if(depth > q->peakDepth) q->peakDepth = depth;
+    } else {
+        q->dropped++;
+    }
+    portEXIT_CRITICAL(&statsLock);
+
+    return sent;
+}
+
+bool metricsMutexTake(MetricsMutexId id, SemaphoreHandle_t mutex, TickType_t wait) {
+    int64_t start = esp_timer_get_time();
+    bool taken = xSemaphoreTake(mutex, wait) == pdTRUE;
+    uint32_t waited = (uint32_t)(esp_timer_get_time() - start);
+    MutexStats *m = &mutexes[id];
+
+    portENTER_CRITICAL(&statsLock);
+    if(taken) m->acquisitions++;
+    else m->timeouts++;
+    m->waitUsTotal += waited;
+    if(waited > m->waitUsMax) m->waitUsMax = waited;
+    portEXIT_CRITICAL(&statsLock);
+
+    return taken;
+}
+
+void metricsObserveGateLatency(int64_t latencyUs) {
+    uint32_t us = latencyUs < 0 ? 0 : (uint32_t)latencyUs;
+    size_t bucket = 0;
+
+    while(bucket < LATENCY_BUCKETS && us > latencyBoundsUs[bucket]) bucket++;
+
+    portENTER_CRITICAL(&statsLock);
+    latencyCounts[bucket]++;
+    latencyUsTotal += us;
+    latencyCount++;
+    portEXIT_CRITICAL(&statsLock);
+}
+
+// ============================================================================
+// Snapshots
+// ============================================================================
+
+typedef struct {
+    TaskStatus_t tasks[METRICS_MAX_TASKS];
+    UBaseType_t taskCount;
+    uint32_t totalRunTime;
+    QueueStats queues[METRICS_QUEUE_COUNT];
+    uint32_t queueDepth[METRICS_QUEUE_COUNT];
+    uint32_t queueCapacity[METRICS_QUEUE_COUNT];
+    MutexStats mutexes[METRICS_MUTEX_COUNT];
+    uint32_t latencyCounts[LATENCY_BUCKETS + 1];
+    uint64_t latencyUsTotal;
+    uint32_t latencyCount;
+    float dutyCycle[portNUM_PROCESSORS];    // -1 until two snapshots exist
+} MetricsSnapshot;
+
+// ~1.5 KB, too big for the callers' stacks; /metrics and /diag take turns
+static MetricsSnapshot snap;
+static SemaphoreHandle_t snapshotMutex = NULL;
+static StaticSemaphore_t snapshotMutexBuffer;
+
+// Idle-task run time at the previous snapshot, for the duty cycle window
+static uint32_t prevIdleRunTime[portNUM_PROCESSORS];
+static uint32_t prevTotalRunTime = 0;
+
+void metricsBegin() {
+    snapshotMutex = xSemaphoreCreateMutexStatic(&snapshotMutexBuffer);
+}
+
+static TaskHandle_t idleTaskOf(int core) {
+#if ESP_IDF_VERSION_MAJOR > 5 || (ESP_IDF_VERSION_MAJOR == 5 && ESP_IDF_VERSION_MINOR >= 1)
+    return xTaskGetIdleTaskHandleForCore(core);
+#else
+    return xTaskGetIdleTaskHandleForCPU(core);
+#endif
+}
+
+/**
+ * @brief Per-core busy share since the previous snapshot
+ *
+ * Tickless idle sleeps inside the idle task, so its run time counts
+ * light sleep too. Windows are unsigned differences, which stay correct
+ * across the 32-bit counter wrap as long as scrapes are < 71 min apart.
+ */
+static void updateDutyCycle(MetricsSnapshot *snap) {
+    for(int c = 0; c < portNUM_PROCESSORS; c++) snap->dutyCycle[c] = -1;
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    uint32_t window = snap->totalRunTime - prevTotalRunTime;
+    bool valid = prevTotalRunTime != 0 && window > 0;
+
+    for(int c = 0; c < portNUM_PROCESSORS; c++) {
+        TaskHandle_t idle = idleTaskOf(c);
+        for(UBaseType_t i = 0; i < snap->taskCount; i++) {
+            if(snap->tasks[i].xHandle != idle) continue;
+            uint32_t idleRun = snap->tasks[i].ulRunTimeCounter;
+            if(valid) {
+                float busy = 1.0f - (float)(idleRun - prevIdleRunTime[c]) / window;
+                snap->dutyCycle[c] = busy < 0 ? 0 : busy;
+            }
+            prevIdleRunTime[c] = idleRun;
+        }
+    }
+    prevTotalRunTime = snap->totalRunTime;
+#endif
+}
+
+/**
+ * @brief Take one consistent copy of the counters plus the task list
+ */
+static void takeSnapshot(MetricsSnapshot *snap) {
+#if configUSE_TRACE_FACILITY
+    snap->taskCount = uxTaskGetSystemState(snap->tasks, METRICS_MAX_TASKS, &snap->totalRunTime);
+#else
+    snap->taskCount = 0;
+    snap->totalRunTime = 0;
+#endif
+
+    portENTER_CRITICAL(&statsLock);
+    memcpy(snap->queues, queues, sizeof(queues));
+    memcpy(snap->mutexes, mutexes, sizeof(mutexes));
+    memcpy(snap->latencyCounts, latencyCounts, sizeof(latencyCounts));
+    snap->latencyUsTotal = latencyUsTotal;
+    snap->latencyCount = latencyCount;
+    portEXIT_CRITICAL(&statsLock);
+
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        QueueHandle_t q = snap->queues[i].queue;
+        snap->queueDepth[i] = q ? uxQueueMessagesWaiting(q) : 0;
+        snap->queueCapacity[i] = q ? snap->queueDepth[i] + uxQueueSpacesAvailable(q) : 0;
+    }
+
+    updateDutyCycle(snap);
+}
+
+/**
+ * @brief Share of one core used by a task since boot, in percent
+ */
+static float taskCpuPercent(const MetricsSnapshot *snap, const TaskStatus_t *task) {
+#if configGENERATE_RUN_TIME_STATS
+    if(snap->totalRunTime == 0) return 0;
+    return task->ulRunTimeCounter * 100.0f / snap->totalRunTime;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Smallest bucket bound covering fraction p of the observations
+ */
+static uint32_t latencyPercentileUs(const MetricsSnapshot *snap, float p) {
+    uint32_t target = (uint32_t)(snap->latencyCount * p + 0.999f);
+    uint32_t seen = 0;
+
+    for(size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += snap->latencyCounts[i];
+        if(seen >= target) return latencyBoundsUs[i];
+    }
+    return UINT32_MAX;
+}
+
+// ============================================================================
+// Prometheus Output
+// ============================================================================
+
+static void metricHeader(ChunkWriter *out, const char *name, const char *type, const char *help) {
+    chunkPrintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * @brief OTA progress, download throughput and flash write time
+ */
+static void writeOta(ChunkWriter *out) {
+    OtaStatus ota;
+    otaGetStatus(&ota);
+
+    metricHeader(out, "parking_ota_phase", "gauge", "Current update phase (label)");
+    chunkPrintf(out, "parking_ota_phase{phase=\"%s\"} 1\n", otaPhaseName(ota.phase));
+    metricHeader(out, "parking_ota_image_bytes", "gauge", "Size of the image being installed");
+    chunkPrintf(out, "parking_ota_image_bytes %lu\n", (unsigned long)ota.imageBytes);
+    metricHeader(out, "parking_ota_written_bytes", "gauge", "Image bytes in flash so far");
+    chunkPrintf(out, "parking_ota_written_bytes %lu\n", (unsigned long)ota.writtenBytes);
+    metricHeader(out, "parking_ota_downloaded_bytes_total", "counter", "Image bytes received since boot");
+    chunkPrintf(out, "parking_ota_downloaded_bytes_total %lu\n", (unsigned long)ota.downloadedBytes);
+    metricHeader(out, "parking_ota_download_seconds_total", "counter", "Time spent reading from the network");
+    chunkPrintf(out, "parking_ota_download_seconds_total %.3f\n", ota.downloadUs / 1e6);
+    metricHeader(out, "parking_ota_flash_write_seconds_total", "counter", "Time spent erasing and writing flash");
+    chunkPrintf(out, "parking_ota_flash_write_seconds_total %.3f\n", ota.flashUs / 1e6);
+    metricHeader(out, "parking_ota_flash_write_max_seconds", "gauge", "Longest single chunk erase + write");
+    chunkPrintf(out, "parking_ota_flash_write_max_seconds %.6f\n", ota.flashMaxUs / 1e6);
+    metricHeader(out, "parking_ota_resumes_total", "counter", "Range requests after a dropped or interrupted transfer");
+    chunkPrintf(out, "parking_ota_resumes_total %lu\n", (unsigned long)ota.resumes);
+    metricHeader(out, "parking_ota_gate_deferrals_total", "counter", "Flash writes held back while a barrier moved");
+    chunkPrintf(out, "parking_ota_gate_deferrals_total %lu\n", (unsigned long)ota.gateDeferrals);
+    metricHeader(out, "parking_ota_pending_confirm", "gauge", "1 while a new image runs on trial");
+    chunkPrintf(out, "parking_ota_pending_confirm %d\n", ota.pendingConfirm ? 1 : 0);
+    metricHeader(out, "parking_ota_rolled_back", "gauge", "1 if the last update was rolled back");
+    chunkPrintf(out, "parking_ota_rolled_back %d\n", ota.rolledBack ? 1 : 0);
+}
+
+/**
+ * @brief Learned rates for the current hour and the fill estimate
+ */
+static void writeForecast(ChunkWriter *out) {
+    ForecastResult forecast;
+    forecastGet(&forecast);
+
+    metricHeader(out, "parking_forecast_ready", "gauge", "1 once every hour up to the horizon has been learned");
+    chunkPrintf(out, "parking_forecast_ready %d\n", forecast.ready ? 1 : 0);
+    metricHeader(out, "parking_forecast_minutes_to_full", "gauge", "Expected minutes until no walk-in slot is left (-1 = not within the horizon)");
+    chunkPrintf(out, "parking_forecast_minutes_to_full %d\n", forecast.minutesToFull);
+    metricHeader(out, "parking_forecast_arrivals_per_hour", "gauge", "Learned arrival rate for this weekday and hour");
+    chunkPrintf(out, "parking_forecast_arrivals_per_hour %.2f\n", forecast.arrivalsPerHour);
+    metricHeader(out, "parking_forecast_departures_per_hour", "gauge", "Learned departure rate for this weekday and hour");
+    chunkPrintf(out, "parking_forecast_departures_per_hour %.2f\n", forecast.departuresPerHour);
+}
+
+/**
+ * @brief Peer count, the site aggregate and protocol traffic
+ */
+static void writeFederation(ChunkWriter *out) {
+    if(!federationEnabled()) return;
+
+    FederationStats fed;
+    ParkingState state;
+    federationGetStats(&fed);
+    parkingStateRead(&state);
+
+    metricHeader(out, "parking_federation_peers", "gauge", "Other nodes heard from within their expiry");
+    chunkPrintf(out, "parking_federation_peers %u\n", fed.peers);
+    metricHeader(out, "parking_site_available_slots", "gauge", "Walk-in free slots on every federated node");
+    chunkPrintf(out, "parking_site_available_slots %d\n", state.siteAvailable);
+    metricHeader(out, "parking_site_total_slots", "gauge", "Capacity of every federated node");
+    chunkPrintf(out, "parking_site_total_slots %d\n", state.siteTotal);
+    metricHeader(out, "parking_federation_sync_interval_seconds", "gauge", "This node's anti-entropy sync period");
+    chunkPrintf(out, "parking_federation_sync_interval_seconds %.3f\n", fed.syncIntervalMs / 1e3);
+    metricHeader(out, "parking_federation_tx_packets_total", "counter", "Records sent, by kind");
+    chunkPrintf(out, "parking_federation_tx_packets_total{kind=\"delta\"} %lu\n", (unsigned long)(fed.txDeltas - fed.txRepairs));
+    chunkPrintf(out, "parking_federation_tx_packets_total{kind=\"repair\"} %lu\n", (unsigned long)fed.txRepairs);
+    chunkPrintf(out, "parking_federation_tx_packets_total{kind=\"sync\"} %lu\n", (unsigned long)fed.txSyncs);
+    metricHeader(out, "parking_federation_tx_bytes_total", "counter", "Payload bytes sent");
+    chunkPrintf(out, "parking_federation_tx_bytes_total %lu\n", (unsigned long)fed.txBytes);
+    metricHeader(out, "parking_federation_rx_packets_total", "counter", "Valid records received from peers");
+    chunkPrintf(out, "parking_federation_rx_packets_total %lu\n", (unsigned long)fed.rxPackets);
+    metricHeader(out, "parking_federation_rx_bytes_total", "counter", "Payload bytes received from peers");
+    chunkPrintf(out, "parking_federation_rx_bytes_total %lu\n", (unsigned long)fed.rxBytes);
+    metricHeader(out, "parking_federation_lost_total", "counter", "Peer deltas never received (sequence gaps)");
+    chunkPrintf(out, "parking_federation_lost_total %lu\n", (unsigned long)fed.rxLost);
+    metricHeader(out, "parking_federation_stale_total", "counter", "Records older than one already applied");
+    chunkPrintf(out, "parking_federation_stale_total %lu\n", (unsigned long)fed.rxStale);
+    metricHeader(out, "parking_federation_rejected_total", "counter", "Malformed packets or peers beyond FED_MAX_PEERS");
+    chunkPrintf(out, "parking_federation_rejected_total %lu\n", (unsigned long)fed.rxRejected);
+    metricHeader(out, "parking_federation_expired_total", "counter", "Peers dropped after going silent");
+    chunkPrintf(out, "parking_federation_expired_total %lu\n", (unsigned long)fed.expired);
+}
+
+/**
+ * @brief Heap fragmentation (heap_watch.h)
+ */
+static void writeMemory(ChunkWriter *out) {
+    HeapStats heap;
+
+    heapWatchStats(&heap);
+
+    metricHeader(out, "parking_heap_largest_free_block_bytes", "gauge", "Largest contiguous free heap block");
+    chunkPrintf(out, "parking_heap_largest_free_block_bytes %lu\n", (unsigned long)heap.largestBlock);
+    metricHeader(out, "parking_heap_min_largest_free_block_bytes", "gauge", "Smallest largest-free-block sampled since boot");
+    chunkPrintf(out, "parking_heap_min_largest_free_block_bytes %lu\n", (unsigned long)heap.minLargestBlock);
+    metricHeader(out, "parking_heap_largest_free_block_trend_bytes_per_hour", "gauge", "Change of the largest free block over the sample window");
+    chunkPrintf(out, "parking_heap_largest_free_block_trend_bytes_per_hour %ld\n", (long)heap.largestTrendPerHour);
+    metricHeader(out, "parking_heap_fragmented", "gauge", "1 while the largest free block is below MEM_FRAG_ALERT_BYTES");
+    chunkPrintf(out, "parking_heap_fragmented %d\n", heap.fragmented ? 1 : 0);
+    metricHeader(out, "parking_heap_alloc_failures_total", "counter", "Heap requests that returned NULL, any caller");
+    chunkPrintf(out, "parking_heap_alloc_failures_total %lu\n", (unsigned long)heap.failedAllocs);
+    metricHeader(out, "parking_heap_largest_failed_alloc_bytes", "gauge", "Largest request the heap could not serve");
+    chunkPrintf(out, "parking_heap_largest_failed_alloc_bytes %lu\n", (unsigned long)heap.largestFailedAlloc);
+}
+
+bool metricsWritePrometheus(ChunkSink sink, void *ctx) {
+    static ChunkWriter out;
+
+    if(snapshotMutex == NULL || xSemaphoreTake(snapshotMutex, portMAX_DELAY) != pdTRUE) return false;
+    takeSnapshot(&snap);
+    chunkWriterInit(&out, sink, ctx);
+
+    metricHeader(&out, "parking_uptime_seconds", "gauge", "Time since boot");
+    chunkPrintf(&out, "parking_uptime_seconds %llu\n", (unsigned long long)(esp_timer_get_time() / 1000000));
+    metricHeader(&out, "parking_heap_free_bytes", "gauge", "Free heap");
+    chunkPrintf(&out, "parking_heap_free_bytes %lu\n", (unsigned long)esp_get_free_heap_size());
+    metricHeader(&out, "parking_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    chunkPrintf(&out, "parking_heap_min_free_bytes %lu\n", (unsigned long)esp_get_minimum_free_heap_size());
+    writeMemory(&out);
+    writeOta(&out);
+    writeForecast(&out);
+    writeFederation(&out);
+
+    metricHeader(&out, "freertos_task_stack_free_bytes", "gauge", "Stack high-water mark (never-used bytes)");
+    for(UBaseType_t i = 0; i < snap.taskCount; i++) {
+        chunkPrintf(&out, "freertos_task_stack_free_bytes{task=\"%s\"} %lu\n",
+                    snap.tasks[i].pcTaskName, (unsigned long)snap.tasks[i].usStackHighWaterMark);
+    }
+#if configGENERATE_RUN_TIME_STATS
+    metricHeader(&out, "freertos_task_runtime_seconds_total", "counter", "CPU time spent in the task");
+    for(UBaseType_t i = 0; i < snap.taskCount; i++) {
+        chunkPrintf(&out, "freertos_task_runtime_seconds_total{task=\"%s\"} %.6f\n",
+                    snap.tasks[i].pcTaskName, snap.tasks[i].ulRunTimeCounter / 1e6);
+    }
+#endif
+
+    metricHeader(&out, "parking_cpu_duty_cycle", "gauge", "Share of the core not idle or light-sleeping since the previous /metrics or /diag");
+    for(int c = 0; c < portNUM_PROCESSORS; c++) {
+        if(snap.dutyCycle[c] >= 0) chunkPrintf(&out, "parking_cpu_duty_cycle{core=\"%d\"} %.4f\n", c, snap.dutyCycle[c]);
+    }
+    metricHeader(&out, "parking_power_light_sleep", "gauge", "1 if automatic light sleep is enabled");
+    chunkPrintf(&out, "parking_power_light_sleep %d\n", powerLightSleepEnabled() ? 1 : 0);
+
+    metricHeader(&out, "freertos_queue_depth", "gauge", "Items waiting");
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        if(snap.queues[i].name) chunkPrintf(&out, "freertos_queue_depth{queue=\"%s\"} %lu\n", snap.queues[i].name, (unsigned long)snap.queueDepth[i]);
+    }
+    metricHeader(&out, "freertos_queue_capacity", "gauge", "Queue length");
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        if(snap.queues[i].name) chunkPrintf(&out, "freertos_queue_capacity{queue=\"%s\"} %lu\n", snap.queues[i].name, (unsigned long)snap.queueCapacity[i]);
+    }
+    metricHeader(&out, "freertos_queue_peak_depth", "gauge", "Highest depth seen right after a send");
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        if(snap.queues[i].name) chunkPrintf(&out, "freertos_queue_peak_depth{queue=\"%s\"} %lu\n", snap.queues[i].name, (unsigned long)snap.queues[i].peakDepth);
+    }
+    metricHeader(&out, "freertos_queue_sent_total", "counter", "Items queued");
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        if(snap.queues[i].name) chunkPrintf(&out, "freertos_queue_sent_total{queue=\"%s\"} %lu\n", snap.queues[i].name, (unsigned long)snap.queues[i].sent);
+    }
+    metricHeader(&out, "freertos_queue_dropped_total", "counter", "Items dropped because the queue was full");
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        if(snap.queues[i].name) chunkPrintf(&out, "freertos_queue_dropped_total{queue=\"%s\"} %lu\n", snap.queues[i].name, (unsigned long)snap.queues[i].dropped);
+    }
+
+    metricHeader(&out, "freertos_mutex_acquisitions_total", "counter", "Successful takes");
+    for(int i = 0; i < METRICS_MUTEX_COUNT; i++) {
+        chunkPrintf(&out, "freertos_mutex_acquisitions_total{mutex=\"%s\"} %lu\n", mutexNames[i], (unsigned long)snap.mutexes[i].acquisitions);
+    }
+    metricHeader(&out, "freertos_mutex_wait_seconds_total", "counter", "Time spent waiting to take");
+    for(int i = 0; i < METRICS_MUTEX_COUNT; i++) {
+        chunkPrintf(&out, "freertos_mutex_wait_seconds_total{mutex=\"%s\"} %.6f\n", mutexNames[i], snap.mutexes[i].waitUsTotal / 1e6);
+    }
+    metricHeader(&out, "freertos_mutex_wait_max_seconds", "gauge", "Longest single wait");
+    for(int i = 0; i < METRICS_MUTEX_COUNT; i++) {
+        chunkPrintf(&out, "freertos_mutex_wait_max_seconds{mutex=\"%s\"} %.6f\n", mutexNames[i], snap.mutexes[i].waitUsMax / 1e6);
+    }
+
+    metricHeader(&out, "parking_gate_latency_seconds", "histogram", "IR sensor edge to barrier open command");
+    uint32_t cumulative = 0;
+    for(size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        cumulative += snap.latencyCounts[i];
+        chunkPrintf(&out, "parking_gate_latency_seconds_bucket{le=\"%g\"} %lu\n", latencyBoundsUs[i] / 1e6, (unsigned long)cumulative);
+    }
+    chunkPrintf(&out, "parking_gate_latency_seconds_bucket{le=\"+Inf\"} %lu\n", (unsigned long)snap.latencyCount);
+    chunkPrintf(&out, "parking_gate_latency_seconds_sum %.6f\n", snap.latencyUsTotal / 1e6);
+    chunkPrintf(&out, "parking_gate_latency_seconds_count %lu\n", (unsigned long)snap.latencyCount);
+
+    metricHeader(&out, "parking_dropped_total", "counter", "Events lost by source");
+    chunkPrintf(&out, "parking_dropped_total{source=\"ir_edges\"} %lu\n", (unsigned long)irSensorDroppedEdges());
+    chunkPrintf(&out, "parking_dropped_total{source=\"journal\"} %lu\n", (unsigned long)journalDropped());
+    chunkPrintf(&out, "parking_dropped_total{source=\"telegram\"} %lu\n", (unsigned long)telegramOutboxDropped());
+    chunkPrintf(&out, "parking_dropped_total{source=\"mqtt\"} %lu\n", (unsigned long)mqttUplinkDropped());
+    metricHeader(&out, "parking_internet_reachable", "gauge", "1 while recent network traffic (or the probe) gets through");
+    chunkPrintf(&out, "parking_internet_reachable %d\n", connectivityReachable() ? 1 : 0);
+    metricHeader(&out, "parking_connectivity_probes_total", "counter", "Active reachability probes sent");
+    chunkPrintf(&out, "parking_connectivity_probes_total %lu\n", (unsigned long)connectivityProbeCount());
+    metricHeader(&out, "parking_telegram_subscribers", "gauge", "Chats subscribed to alerts");
+    chunkPrintf(&out, "parking_telegram_subscribers %d\n", telegramSubscriberCount());
+    metricHeader(&out, "parking_mqtt_connected", "gauge", "1 while the MQTT uplink has a broker session");
+    chunkPrintf(&out, "parking_mqtt_connected %d\n", mqttUplinkConnected() ? 1 : 0);
+    metricHeader(&out, "parking_mqtt_backlog", "gauge", "Events waiting for the MQTT broker");
+    chunkPrintf(&out, "parking_mqtt_backlog %lu\n", (unsigned long)mqttUplinkBacklog());
+    ReservationCounters booked;
+    reservationGetCounters(&booked);
+    metricHeader(&out, "parking_reservations_active", "gauge", "Open reservations, each holding a slot");
+    chunkPrintf(&out, "parking_reservations_active %d\n", reservationActive());
+    metricHeader(&out, "parking_reservations_total", "counter", "Reservations by outcome");
+    chunkPrintf(&out, "parking_reservations_total{outcome=\"created\"} %lu\n", (unsigned long)booked.created);
+    chunkPrintf(&out, "parking_reservations_total{outcome=\"arrived\"} %lu\n", (unsigned long)booked.arrived);
+    chunkPrintf(&out, "parking_reservations_total{outcome=\"expired\"} %lu\n", (unsigned long)booked.expired);
+    chunkPrintf(&out, "parking_reservations_total{outcome=\"cancelled\"} %lu\n", (unsigned long)booked.cancelled);
+    chunkPrintf(&out, "parking_reservations_total{outcome=\"revoked\"} %lu\n", (unsigned long)booked.revoked);
+    chunkPrintf(&out, "parking_reservations_total{outcome=\"refused\"} %lu\n", (unsigned long)booked.refused);
+    metricHeader(&out, "parking_sse_clients", "gauge", "Open /events streams");
+    chunkPrintf(&out, "parking_sse_clients %d\n", liveEventsClientCount());
+
+    bool ok = chunkFlush(&out);
+    xSemaphoreGive(snapshotMutex);
+    return ok;
+}
+
+// ============================================================================
+// Telegram Summary
+// ============================================================================
+
+// Bounded appender for the /diag text
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+} DiagOut;
+
+static void diagPrintf(DiagOut *out, const char *fmt, ...) {
+    if(out->pos + 1 >= out->len) return;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(out->buf + out->pos, out->len - out->pos, fmt, args);
+    va_end(args);
+
+    if(n < 0) return;
+    out->pos += n;
+    if(out->pos >= out->len) out->pos = out->len - 1;
+}
+
+size_t metricsFormatDiag(char *buf, size_t len) {
+    DiagOut out = { buf, len, 0 };
+
+    if(len == 0 || snapshotMutex == NULL || xSemaphoreTake(snapshotMutex, portMAX_DELAY) != pdTRUE) return 0;
+    takeSnapshot(&snap);
+    buf[0] = '\0';
+
+    uint32_t up = esp_timer_get_time() / 1000000;
+    HeapStats heap;
+    heapWatchStats(&heap);
+    diagPrintf(&out, "*🩺 Diagnostics*\n\nUp %luh%02lum, heap %lu KB (min %lu KB)\n",
+               (unsigned long)(up / 3600), (unsigned long)(up / 60 % 60),
+               (unsigned long)(heap.freeBytes / 1024), (unsigned long)(heap.minFreeBytes / 1024));
+    diagPrintf(&out, "Largest block %lu KB (min %lu KB, %+ld B/h)%s\n",
+               (unsigned long)(heap.largestBlock / 1024), (unsigned long)(heap.minLargestBlock / 1024),
+               (long)heap.largestTrendPerHour, heap.fragmented ? " ⚠️ fragmented" : "");
+
+    if(snap.dutyCycle[0] >= 0) {
+        diagPrintf(&out, "CPU busy %.1f%% / %.1f%%, light sleep %s\n", snap.dutyCycle[0] * 100,
+                   portNUM_PROCESSORS > 1 ? snap.dutyCycle[portNUM_PROCESSORS - 1] * 100 : 0.0f,
+                   powerLightSleepEnabled() ? "on" : "off");
+    }
+
+    OtaStatus ota;
+    otaGetStatus(&ota);
+    if(ota.phase != OTA_IDLE || ota.pendingConfirm) {
+        float downloadSec = ota.downloadUs / 1e6f;
+        diagPrintf(&out, "OTA %s%s %lu/%lu KB, %.1f KB/s, flash %lu ms (max %lu ms)%s%s\n",
+                   otaPhaseName(ota.phase), ota.pendingConfirm ? " (trial boot)" : "",
+                   (unsigned long)(ota.writtenBytes / 1024), (unsigned long)(ota.imageBytes / 1024),
+                   downloadSec > 0 ? ota.downloadedBytes / 1024.0f / downloadSec : 0.0f,
+                   (unsigned long)(ota.flashUs / 1000), (unsigned long)(ota.flashMaxUs / 1000),
+                   ota.error[0] ? ": " : "", ota.error);
+    }
+
+    if(federationEnabled()) {
+        FederationStats fed;
+        ParkingState state;
+        federationGetStats(&fed);
+        parkingStateRead(&state);
+        diagPrintf(&out, "Site: %d/%d free on %u nodes, %lu lost, sync %lu ms\n",
+                   state.siteAvailable, state.siteTotal, state.siteNodes,
+                   (unsigned long)fed.rxLost, (unsigned long)fed.syncIntervalMs);
+    }
+
+    diagPrintf(&out, "\nTask: stack free B / CPU%%\n");
+    for(UBaseType_t i = 0; i < snap.taskCount; i++) {
+        diagPrintf(&out, "%s %lu / %.1f\n", snap.tasks[i].pcTaskName,
+                   (unsigned long)snap.tasks[i].usStackHighWaterMark, taskCpuPercent(&snap, &snap.tasks[i]));
+    }
+
+    diagPrintf(&out, "\nQueue: depth/peak/cap, drops\n");
+    for(int i = 0; i < METRICS_QUEUE_COUNT; i++) {
+        if(!snap.queues[i].name) continue;
+        diagPrintf(&out, "%s %lu/%lu/%lu, %lu\n", snap.queues[i].name,
+                   (unsigned long)snap.queueDepth[i], (unsigned long)snap.queues[i].peakDepth,
+                   (unsigned long)snap.queueCapacity[i], (unsigned long)snap.queues[i].dropped);
+    }
+
+    if(snap.latencyCount > 0) {
+        diagPrintf(&out, "\nGate latency (n=%lu): p50 <= %lu us, p99 <= %lu us\n",
+                   (unsigned long)snap.latencyCount,
+                   (unsigned long)latencyPercentileUs(&snap, 0.50f),
+                   (unsigned long)latencyPercentileUs(&snap, 0.99f));
+    }
+
+    xSemaphoreGive(snapshotMutex);
+    return out.pos;
+}
@@ -0,0 +1,424 @@
+/**
+ * @file mqtt_uplink.cpp
+ * @brief Fleet telemetry over MQTT: CBOR events and state, remote commands
+ */
+
+#include "mqtt_uplink.h"
+#include "config.h"
+#include "cbor_writer.h"
+#include "lane.h"
+#include "parking_state.h"
+#include "connectivity.h"
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <esp_timer.h>
+
+#ifndef MQTT_BROKER_HOST
+    #define MQTT_BROKER_HOST ""
+#endif
+#ifndef MQTT_BROKER_PORT
+    #define MQTT_BROKER_PORT 1883
+#endif
+#ifndef MQTT_USERNAME
+    #define MQTT_USERNAME ""
+#endif
+#ifndef MQTT_PASSWORD
+    #define MQTT_PASSWORD ""
+#endif
+#ifndef MQTT_DEVICE_ID
+    #define MQTT_DEVICE_ID ""
+#endif
+#ifndef MQTT_TOPIC_PREFIX
+    #define MQTT_TOPIC_PREFIX "parking"
+#endif
+#ifndef MQTT_BACKLOG_SIZE
+    #define MQTT_BACKLOG_SIZE 256
+#endif
+#ifndef MQTT_BATCH_MAX
+    #define MQTT_BATCH_MAX 32
+#endif
+#ifndef MQTT_FLUSH_BURST
+    #define MQTT_FLUSH_BURST 4
+#endif
+#ifndef MQTT_FLUSH_GAP_MS
+    #define MQTT_FLUSH_GAP_MS 50
+#endif
+#ifndef MQTT_SUMMARY_INTERVAL_MS
+    #define MQTT_SUMMARY_INTERVAL_MS 60000
+#endif
+#ifndef MQTT_STATE_MIN_INTERVAL_MS
+    #define MQTT_STATE_MIN_INTERVAL_MS 1000
+#endif
+#ifndef MQTT_POLL_MS
+    #define MQTT_POLL_MS 250
+#endif
+#ifndef MQTT_KEEPALIVE_SEC
+    #define MQTT_KEEPALIVE_SEC 30
+#endif
+#ifndef MQTT_RECONNECT_MIN_MS
+    #define MQTT_RECONNECT_MIN_MS 1000
+#endif
+#ifndef MQTT_RECONNECT_MAX_MS
+    #define MQTT_RECONNECT_MAX_MS 60000
+#endif
+
+// One encoded event is at most 18 bytes (array head, two 32-bit uints,
+// type, a 16-bit value and a 16-bit count), plus ~32 bytes of batch header
+#define MQTT_PAYLOAD_MAX 768
+#define MQTT_TOPIC_MAX 64
+#define MQTT_COMMAND_MAX 176      // "update " and a firmware URL
+
+static_assert(MQTT_BATCH_MAX * 18 + 32 <= MQTT_PAYLOAD_MAX, "MQTT_BATCH_MAX does not fit MQTT_PAYLOAD_MAX");
+
+typedef struct {
+    uint32_t seq;
+    uint32_t uptimeSec;
+    uint8_t type;           // EventType
+    int16_t value;          // Lane of car events, barrier of gate events
+    uint16_t available;     // Free slots right after the event
+} UplinkEvent;
+
+static bool enabled = false;
+static MqttCommandHandlers commands;
+static TaskHandle_t mqttTaskHandle = NULL;
+
+static WiFiClient netClient;
+static PubSubClient client(netClient);
+static char deviceId[24];
+static char topicBase[MQTT_TOPIC_MAX];
+
+// Backlog ring, oldest at (head - count); shared by every recording task
+static UplinkEvent backlog[MQTT_BACKLOG_SIZE];
+static uint32_t backlogHead = 0;
+static uint32_t backlogCount = 0;
+static uint32_t nextSeq = 1;
+static volatile uint32_t droppedEvents = 0;
+static portMUX_TYPE backlogLock = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile bool connectedFlag = false;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void topicFor(char *out, const char *leaf) {
+    snprintf(out, MQTT_TOPIC_MAX, "%s/%s", topicBase, leaf);
+}
+
+static void wakeTask() {
+    if(mqttTaskHandle != NULL) xTaskNotifyGive(mqttTaskHandle);
+}
+
+static void onStateChanged() {
+    wakeTask();
+}
+
+/**
+ * @brief Copy up to max of the oldest events without removing them
+ */
+static int backlogPeek(UplinkEvent *out, int max) {
+    portENTER_CRITICAL(&backlogLock);
+    int n = backlogCount < (uint32_t)max ? backlogCount : max;
+    uint32_t tail = (backlogHead + MQTT_BACKLOG_SIZE - backlogCount) % MQTT_BACKLOG_SIZE;
+    for(int i = 0; i < n; i++) {
+        out[i] = backlog[(tail + i) % MQTT_BACKLOG_SIZE];
+    }
+    portEXIT_CRITICAL(&backlogLock);
+    return n;
+}
+
+/**
+ * @brief Remove every event up to lastSeq (some may already have been
+ *        overwritten by new ones while the batch was in flight)
+ */
+static void backlogCommit(uint32_t lastSeq) {
+    portENTER_CRITICAL(&backlogLock);
+    while(backlogCount > 0) {
+        uint32_t tail = (backlogHead + MQTT_BACKLOG_SIZE - backlogCount) % MQTT_BACKLOG_SIZE;
+        if((int32_t)(backlog[tail].seq - lastSeq) > 0) break;
+        backlogCount--;
+    }
+    portEXIT_CRITICAL(&backlogLock);
+}
+
+// ============================================================================
+// Publishing
+// ============================================================================
+
+/**
+ * @brief Send one batch of the oldest events
+ * @return false if nothing was sent (backlog empty or the write failed)
+ */
+static bool publishEventBatch() {
+    static UplinkEvent batch[MQTT_BATCH_MAX];
+    static uint8_t payload[MQTT_PAYLOAD_MAX];
+    char topic[MQTT_TOPIC_MAX];
+    CborWriter out;
+    ParkingState state;
+
+    int n = backlogPeek(batch, MQTT_BATCH_MAX);
+    if(n == 0) return false;
+
+    parkingStateRead(&state);
+    cborWriterInit(&out, payload, sizeof(payload));
+    cborMap(&out, 3);
+    cborText(&out, "boot");
+    cborUint(&out, state.bootEpoch);
+    cborText(&out, "lost");
+    cborUint(&out, droppedEvents);
+    cborText(&out, "ev");
+    cborArray(&out, n);
+    for(int i = 0; i < n; i++) {
+        cborArray(&out, 5);
+        cborUint(&out, batch[i].seq);
+        cborUint(&out, batch[i].uptimeSec);
+        cborUint(&out, batch[i].type);
+        cborInt(&out, batch[i].value);
+        cborUint(&out, batch[i].available);
+    }
+
+    topicFor(topic, "events");
+    bool sent = client.publish(topic, payload, cborLength(&out), false);
+    connectivityReport(CONN_SOURCE_MQTT, sent);
+    if(!sent) {
+        Serial.printf("[MQTT] Event batch not sent (%d waiting), retrying later\n", (int)mqttUplinkBacklog());
+        return false;
+    }
+    backlogCommit(batch[n - 1].seq);
+    return true;
+}
+
+static bool publishState() {
+    uint8_t payload[128];
+    char topic[MQTT_TOPIC_MAX];
+    CborWriter out;
+    ParkingState state;
+
+    parkingStateRead(&state);
+    cborWriterInit(&out, payload, sizeof(payload));
+    cborMap(&out, 10);
+    cborText(&out, "v");
+    cborUint(&out, state.version);
+    cborText(&out, "total");
+    cborInt(&out, state.totalSlots);
+    cborText(&out, "free");
+    cborInt(&out, state.availableSlots);
+    cborText(&out, "gate");
+    cborText(&out, gateStateName(state.gate));
+    cborText(&out, "temp");
+    cborFloat(&out, state.temperature);
+    cborText(&out, "hum");
+    cborFloat(&out, state.humidity);
+    cborText(&out, "boot");
+    cborUint(&out, state.bootEpoch);
+    cborText(&out, "up");
+    cborUint(&out, (uint32_t)(esp_timer_get_time() / 1000000));
+    cborText(&out, "rssi");
+    cborInt(&out, WiFi.RSSI());
+    cborText(&out, "lost");
+    cborUint(&out, droppedEvents);
+
+    topicFor(topic, "state");
+    return client.publish(topic, payload, cborLength(&out), true);
+}
+
+static void publishAck(const char *command, bool ok) {
+    uint8_t payload[MQTT_COMMAND_MAX + 16];
+    char topic[MQTT_TOPIC_MAX];
+    CborWriter out;
+
+    cborWriterInit(&out, payload, sizeof(payload));
+    cborMap(&out, 2);
+    cborText(&out, "cmd");
+    cborText(&out, command);
+    cborText(&out, "ok");
+    cborBool(&out, ok);
+
+    topicFor(topic, "ack");
+    client.publish(topic, payload, cborLength(&out), false);
+}
+
+// ============================================================================
+// Commands
+// ============================================================================
+
+/**
+ * @brief PubSubClient callback, runs inside client.loop() on the MQTT task
+ */
+static void onMessage(char *topic, uint8_t *payload, unsigned int length) {
+    char command[MQTT_COMMAND_MAX];
+    bool ok = false;
+
+    // The payload lives in the client's buffer, which publishAck reuses
+    if(length >= sizeof(command)) length = sizeof(command) - 1;
+    memcpy(command, payload, length);
+    command[length] = '\0';
+
+    const char *arg = strchr(command, ' ');
+    arg = arg ? arg + 1 : "";
+
+    if(strncmp(command, "open ", 5) == 0) {
+        int lane = laneFind(arg);
+        ok = lane >= 0 && commands.openLane != NULL && commands.openLane(lane);
+    } else if(strncmp(command, "capacity ", 9) == 0) {
+        int slots = atoi(arg);
+        ok = slots > 0 && slots <= INT16_MAX && commands.setCapacity != NULL && commands.setCapacity(slots);
+    } else if(strncmp(command, "update ", 7) == 0) {
+        ok = commands.startUpdate != NULL && commands.startUpdate(arg);
+    }
+
+    Serial.printf("[MQTT] Command \"%s\" %s\n", command, ok ? "done" : "rejected");
+    publishAck(command, ok);
+}
+
+static bool connectBroker() {
+    char statusTopic[MQTT_TOPIC_MAX];
+    char cmdTopic[MQTT_TOPIC_MAX];
+
+    topicFor(statusTopic, "status");
+    topicFor(cmdTopic, "cmd");
+
+    const char *user = MQTT_USERNAME[0] ? MQTT_USERNAME : NULL;
+    const char *pass = MQTT_USERNAME[0] ? MQTT_PASSWORD : NULL;
+    bool ok = client.connect(deviceId, user, pass, statusTopic, 1, true, "offline");
+    connectivityReport(CONN_SOURCE_MQTT, ok);
+    if(!ok) {
+        Serial.printf("[MQTT] Connect to %s:%d failed (state %d)\n", MQTT_BROKER_HOST, MQTT_BROKER_PORT, client.state());
+        return false;
+    }
+
+    client.publish(statusTopic, "online", true);
+    client.subscribe(cmdTopic);
+    Serial.printf("[MQTT] Connected as %s, %d events waiting\n", deviceId, (int)mqttUplinkBacklog());
+    return true;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool mqttUplinkBegin(const MqttCommandHandlers *handlers) {
+    if(MQTT_BROKER_HOST[0] == '\0') return false;
+
+    if(MQTT_DEVICE_ID[0] != '\0') {
+        strlcpy(deviceId, MQTT_DEVICE_ID, sizeof(deviceId));
+    } else {
+        uint8_t mac[6];
+        WiFi.macAddress(mac);
+        snprintf(deviceId, sizeof(deviceId), "lot-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    }
+    snprintf(topicBase, sizeof(topicBase), "%s/%s", MQTT_TOPIC_PREFIX, deviceId);
+
+    commands = *handlers;
+    client.setServer(MQTT_BROKER_HOST, MQTT_BROKER_PORT);
+    client.setCallback(onMessage);
+    client.setKeepAlive(MQTT_KEEPALIVE_SEC);
+    client.setBufferSize(MQTT_PAYLOAD_MAX + MQTT_TOPIC_MAX + 8);
+    parkingStateAddListener(onStateChanged);
+
+    enabled = true;
+    Serial.printf("[MQTT] Uplink to %s:%d under %s/\n", MQTT_BROKER_HOST, MQTT_BROKER_PORT, topicBase);
+    return true;
+}
+
+bool mqttUplinkEnabled() {
+    return enabled;
+}
+
+void mqttUplinkRecord(EventType type, int value) {
+    if(!enabled) return;
+
+    ParkingState state;
+    parkingStateRead(&state);
+
+    UplinkEvent event;
+    event.uptimeSec = esp_timer_get_time() / 1000000;
+    event.type = type;
+    event.value = value;
+    event.available = state.availableSlots;
+
+    portENTER_CRITICAL(&backlogLock);
+    if(backlogCount == MQTT_BACKLOG_SIZE) {
+        backlogCount--;     // Overwrite the oldest
+        droppedEvents++;
+    }
+    event.seq = nextSeq++;
+    backlog[backlogHead] = event;
+    backlogHead = (backlogHead + 1) % MQTT_BACKLOG_SIZE;
+    backlogCount++;
+    portEXIT_CRITICAL(&backlogLock);
+
+    wakeTask();
+}
+
+bool mqttUplinkConnected() {
+    return connectedFlag;
+}
+
+uint32_t mqttUplinkBacklog() {
+    return backlogCount;
+}
+
+uint32_t mqttUplinkDropped() {
+    return droppedEvents;
+}
+
+void mqttTask(void *parameter) {
+    uint32_t backoffMs = MQTT_RECONNECT_MIN_MS;
+    unsigned long lastAttempt = millis() - backoffMs;
+    unsigned long lastStateMs = 0;
+    uint32_t lastStateVersion = 0;
+    bool stateSent = false;
+
+    mqttTaskHandle = xTaskGetCurrentTaskHandle();
+    Serial.println("[MQTT] Started on Core 1");
+
+    while(1) {
+        unsigned long now = millis();
+        TickType_t wait = pdMS_TO_TICKS(MQTT_POLL_MS);
+
+        if(!client.connected()) {
+            if(connectedFlag) {
+                connectedFlag = false;
+                Serial.println("[MQTT] Disconnected, buffering events");
+            }
+            if(WiFi.status() == WL_CONNECTED && now - lastAttempt >= backoffMs) {
+                lastAttempt = now;
+                if(connectBroker()) {
+                    connectedFlag = true;
+                    backoffMs = MQTT_RECONNECT_MIN_MS;
+                    stateSent = false;
+                } else {
+                    backoffMs = backoffMs * 2 > MQTT_RECONNECT_MAX_MS ? MQTT_RECONNECT_MAX_MS : backoffMs * 2;
+                }
+            }
+        }
+
+        if(client.connected()) {
+            client.loop();      // Keepalive and incoming commands
+
+            // Retained state: on change (coalesced) and as a periodic summary
+            uint32_t version = parkingStateVersion();
+            now = millis();
+            if(!stateSent || now - lastStateMs >= MQTT_SUMMARY_INTERVAL_MS ||
+               (version != lastStateVersion && now - lastStateMs >= MQTT_STATE_MIN_INTERVAL_MS)) {
+                if(publishState()) {
+                    lastStateVersion = version;
+                    lastStateMs = now;
+                    stateSent = true;
+                }
+            }
+
+            // Drain a few batches, then come back soon for the rest
+            int sent = 0;
+            while(sent < MQTT_FLUSH_BURST && publishEventBatch()) sent++;
+            if(sent == MQTT_FLUSH_BURST && mqttUplinkBacklog() > 0) {
+                wait = pdMS_TO_TICKS(MQTT_FLUSH_GAP_MS);
+            }
+        }
+
+        // New events and state changes wake the task early; a coalesced
+        // state change goes out on the first poll after the interval
+        ulTaskNotifyTake(pdTRUE, wait > 0 ? wait : 1);
+    }
+}
@@ -0,0 +1,609 @@
+/**
+ * @file ota_update.cpp
+ * @brief Signed, resumable OTA updates with trial boots and rollback
+ */
+
+#include "ota_update.h"
+#include "config.h"
+#include "parking_state.h"
+#include "telegram_outbox.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+
+#ifndef OTA_PUBLIC_KEY_PEM
+    #define OTA_PUBLIC_KEY_PEM ""
+#endif
+#ifndef OTA_CHUNK_SIZE
+    #define OTA_CHUNK_SIZE 4096
+#endif
+#ifndef OTA_CHECKPOINT_BYTES
+    #define OTA_CHECKPOINT_BYTES 65536
+#endif
+#ifndef OTA_MAX_RESUMES
+    #define OTA_MAX_RESUMES 8
+#endif
+#ifndef OTA_RETRY_MS
+    #define OTA_RETRY_MS 5000
+#endif
+#ifndef OTA_READ_TIMEOUT_MS
+    #define OTA_READ_TIMEOUT_MS 10000
+#endif
+#ifndef OTA_GATE_DEFER_MS
+    #define OTA_GATE_DEFER_MS 3000
+#endif
+#ifndef OTA_TRIAL_BOOTS
+    #define OTA_TRIAL_BOOTS 3
+#endif
+#ifndef OTA_CONFIRM_MS
+    #define OTA_CONFIRM_MS 120000
+#endif
+
+// One rollback mechanism per build. The bootloader rolls an image that
+// is still PENDING_VERIFY back at its first reset, so with it the trial is
+// a single boot and the NVS boot counter would never get past one
+#ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+    #define OTA_BOOTLOADER_ROLLBACK 1
+    #undef OTA_TRIAL_BOOTS
+    #define OTA_TRIAL_BOOTS 1
+#else
+    #define OTA_BOOTLOADER_ROLLBACK 0
+#endif
+static_assert(OTA_TRIAL_BOOTS >= 1, "a new image needs at least one trial boot");
+
+#define OTA_SIGNATURE_MAX 512       // DER ECDSA is ~72 bytes, RSA-4096 512
+#define OTA_ETAG_MAX 64
+#define OTA_SECTOR_SIZE 4096
+#define OTA_GATE_POLL_MS 50
+
+static_assert(OTA_CHUNK_SIZE % OTA_SECTOR_SIZE == 0, "OTA_CHUNK_SIZE must be whole flash sectors");
+static_assert(OTA_CHECKPOINT_BYTES % OTA_CHUNK_SIZE == 0, "OTA_CHECKPOINT_BYTES must be whole chunks");
+
+// Download in progress; mirrored in NVS at every checkpoint
+typedef struct {
+    uint32_t size;
+    uint32_t done;              // Bytes in flash, always whole chunks until the end
+    char etag[OTA_ETAG_MAX];
+} OtaJob;
+
+typedef enum {
+    DOWNLOAD_DONE,
+    DOWNLOAD_RETRY,             // Dropped or stalled; resume with a range
+    DOWNLOAD_FATAL
+} DownloadResult;
+
+static portMUX_TYPE statusLock = portMUX_INITIALIZER_UNLOCKED;
+static OtaStatus status;
+static char jobUrl[OTA_URL_MAX];
+static TaskHandle_t otaTaskHandle = NULL;
+static bool resumeAtBoot = false;
+static bool rollbackAlertPending = false;
+
+static uint8_t chunk[OTA_CHUNK_SIZE];       // One chunk in flight, never on the stack
+static uint8_t signature[OTA_SIGNATURE_MAX];
+
+// ============================================================================
+// Status
+// ============================================================================
+
+static void setPhase(OtaPhase phase, const char *error) {
+    portENTER_CRITICAL(&statusLock);
+    status.phase = phase;
+    strlcpy(status.error, error ? error : "", sizeof(status.error));
+    portEXIT_CRITICAL(&statusLock);
+}
+
+static void fail(const char *error) {
+    char msg[96];
+
+    setPhase(OTA_FAILED, error);
+    Serial.printf("[OTA] Failed: %s\n", error);
+    snprintf(msg, sizeof(msg), "*❌ Update failed*\n\n%s", error);
+    telegramAlert(TELEGRAM_TOPIC_SYSTEM, msg);
+}
+
+static void addDownload(uint32_t bytes, int64_t us) {
+    portENTER_CRITICAL(&statusLock);
+    status.downloadedBytes += bytes;
+    status.downloadUs += us;
+    portEXIT_CRITICAL(&statusLock);
+}
+
+// ============================================================================
+// Resume State (NVS)
+// ============================================================================
+
+/**
+ * @brief Pick up the saved job if it is for this URL and slot
+ */
+static void loadJob(const char *url, const esp_partition_t *target, OtaJob *job) {
+    Preferences prefs;
+
+    memset(job, 0, sizeof(*job));
+    if(!prefs.begin("ota", true)) return;
+    if(prefs.getString("url") == url && prefs.getUInt("part") == target->address) {
+        job->size = prefs.getUInt("size");
+        job->done = prefs.getUInt("done");
+        strlcpy(job->etag, prefs.getString("etag").c_str(), sizeof(job->etag));
+        if(job->size > target->size || job->done > job->size || job->done % OTA_CHUNK_SIZE != 0) job->done = 0;
+    }
+    prefs.end();
+}
+
+static void saveJob(const char *url, const esp_partition_t *target, const OtaJob *job) {
+    Preferences prefs;
+
+    if(!prefs.begin("ota", false)) return;
+    prefs.putString("url", url);
+    prefs.putUInt("part", target->address);
+    prefs.putUInt("size", job->size);
+    prefs.putUInt("done", job->done);
+    prefs.putString("etag", job->etag);
+    prefs.putUInt("active", 1);
+    prefs.end();
+}
+
+static void saveProgress(const OtaJob *job) {
+    Preferences prefs;
+
+    if(!prefs.begin("ota", false)) return;
+    prefs.putUInt("done", job->done);
+    prefs.end();
+}
+
+/**
+ * @brief Stop resuming at boot; the progress stays for a manual retry
+ *        of the same URL unless forget is set
+ */
+static void endJob(bool forget) {
+    Preferences prefs;
+
+    if(!prefs.begin("ota", false)) return;
+    prefs.remove("active");
+    if(forget) {
+        prefs.remove("url");
+        prefs.remove("part");
+        prefs.remove("size");
+        prefs.remove("done");
+        prefs.remove("etag");
+    }
+    prefs.end();
+}
+
+// ============================================================================
+// Flash
+// ============================================================================
+
+/**
+ * @brief Hold a flash write back while any barrier is moving or open
+ *
+ * A sector erase stops instruction fetches from flash on both cores for
+ * tens of milliseconds, which would show as a stuttering servo ramp. The
+ * wait is capped so a barrier held open by a queue of cars cannot stall
+ * the download until the server gives up.
+ */
+static void waitForGateIdle() {
+    ParkingState state;
+    uint32_t waitedMs = 0;
+
+    parkingStateRead(&state);
+    if(state.gate == GATE_IDLE) return;
+
+    portENTER_CRITICAL(&statusLock);
+    status.gateDeferrals++;
+    portEXIT_CRITICAL(&statusLock);
+
+    while(state.gate != GATE_IDLE && waitedMs < OTA_GATE_DEFER_MS) {
+        vTaskDelay(pdMS_TO_TICKS(OTA_GATE_POLL_MS));
+        waitedMs += OTA_GATE_POLL_MS;
+        parkingStateRead(&state);
+    }
+}
+
+static bool writeChunk(const esp_partition_t *target, uint32_t offset, size_t len) {
+    size_t eraseLen = (len + OTA_SECTOR_SIZE - 1) & ~(size_t)(OTA_SECTOR_SIZE - 1);
+
+    waitForGateIdle();
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = esp_partition_erase_range(target, offset, eraseLen);
+    if(err == ESP_OK) err = esp_partition_write(target, offset, chunk, len);
+    uint32_t us = esp_timer_get_time() - start;
+
+    portENTER_CRITICAL(&statusLock);
+    status.flashUs += us;
+    if(us > status.flashMaxUs) status.flashMaxUs = us;
+    if(err == ESP_OK) status.writtenBytes = offset + len;
+    portEXIT_CRITICAL(&statusLock);
+
+    if(err != ESP_OK) Serial.printf("[OTA] Flash write at 0x%lx failed (%s)\n", (unsigned long)offset, esp_err_to_name(err));
+    return err == ESP_OK;
+}
+
+// ============================================================================
+// Download
+// ============================================================================
+
+/**
+ * @brief GET <url>.sig into signature[]
+ * @return Signature length, 0 on failure
+ */
+static size_t fetchSignature(const char *url) {
+    char sigUrl[OTA_URL_MAX + 4];
+    HTTPClient http;
+    size_t len = 0;
+
+    snprintf(sigUrl, sizeof(sigUrl), "%s.sig", url);
+    http.setTimeout(OTA_READ_TIMEOUT_MS);
+    if(!http.begin(sigUrl)) return 0;
+
+    int code = http.GET();
+    int size = http.getSize();
+    if(code == HTTP_CODE_OK && size > 0 && size <= OTA_SIGNATURE_MAX) {
+        len = http.getStream().readBytes(signature, size);
+        if(len != (size_t)size) len = 0;
+    } else {
+        Serial.printf("[OTA] Signature GET %s: HTTP %d, %d bytes\n", sigUrl, code, size);
+    }
+    http.end();
+    return len;
+}
+
+/**
+ * @brief One GET from job->done to the end of the image
+ *
+ * A 200 answer to a range request means the server ignores ranges or
+ * the file has changed (If-Range failed); the download starts over.
+ */
+static DownloadResult downloadRange(const char *url, const esp_partition_t *target, OtaJob *job) {
+    static const char *headerKeys[] = { "ETag", "Content-Range" };
+    char range[24];
+    HTTPClient http;
+
+    http.setTimeout(OTA_READ_TIMEOUT_MS);
+    if(!http.begin(url)) return DOWNLOAD_FATAL;
+    http.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+    if(job->done > 0) {
+        snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)job->done);
+        http.addHeader("Range", range);
+        if(job->etag[0]) http.addHeader("If-Range", job->etag);
+    }
+
+    int code = http.GET();
+    if(code == HTTP_CODE_OK) {
+        if(job->done > 0) Serial.println("[OTA] Range not honoured, starting over");
+        job->done = 0;
+        job->size = http.getSize() > 0 ? http.getSize() : 0;
+        strlcpy(job->etag, http.header("ETag").c_str(), sizeof(job->etag));
+        if(job->size == 0 || job->size > target->size) {
+            Serial.printf("[OTA] Image size %d does not fit %s (%lu bytes)\n", http.getSize(), target->label, (unsigned long)target->size);
+            http.end();
+            return DOWNLOAD_FATAL;
+        }
+        saveJob(url, target, job);
+    } else if(code == HTTP_CODE_PARTIAL_CONTENT && job->done > 0) {
+        // "bytes <from>-<to>/<total>": a different total is a different file
+        String contentRange = http.header("Content-Range");
+        const char *total = strrchr(contentRange.c_str(), '/');
+        if(total != NULL && strtoul(total + 1, NULL, 10) != job->size) {
+            Serial.println("[OTA] Image changed on the server, starting over");
+            job->done = 0;
+            http.end();
+            return DOWNLOAD_RETRY;
+        }
+    } else {
+        Serial.printf("[OTA] GET %s: HTTP %d\n", url, code);
+        http.end();
+        return (code <= 0 || code >= 500) ? DOWNLOAD_RETRY : DOWNLOAD_FATAL;
+    }
+
+    portENTER_CRITICAL(&statusLock);
+    status.imageBytes = job->size;
+    status.writtenBytes = job->done;
+    portEXIT_CRITICAL(&statusLock);
+
+    WiFiClient &stream = http.getStream();
+    size_t fill = 0;
+    while(job->done + fill < job->size) {
+        size_t want = job->size - job->done - fill;
+        if(want > OTA_CHUNK_SIZE - fill) want = OTA_CHUNK_SIZE - fill;
+
+        int64_t readStart = esp_timer_get_time();
+        size_t got = stream.readBytes(chunk + fill, want);
+        addDownload(got, esp_timer_get_time() - readStart);
+        if(got == 0) {
+            // Partial chunk is dropped; the range restarts on a chunk boundary
+            http.end();
+            return DOWNLOAD_RETRY;
+        }
+        fill += got;
+
+        if(fill == OTA_CHUNK_SIZE || job->done + fill == job->size) {
+            if(!writeChunk(target, job->done, fill)) {
+                http.end();
+                return DOWNLOAD_FATAL;
+            }
+            job->done += fill;
+            fill = 0;
+            if(job->done % OTA_CHECKPOINT_BYTES == 0) saveProgress(job);
+        }
+    }
+    http.end();
+    return DOWNLOAD_DONE;
+}
+
+// ============================================================================
+// Verification
+// ============================================================================
+
+/**
+ * @brief Hash the slot as written and check it against the signature
+ *
+ * Reading back rather than hashing the stream also covers ranges written
+ * before a reset and catches bad flash writes.
+ */
+static bool verifyImage(const esp_partition_t *target, uint32_t size, size_t sigLen) {
+    mbedtls_sha256_context sha;
+    mbedtls_pk_context key;
+    uint8_t digest[32];
+    bool readOk = true;
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    for(uint32_t offset = 0; offset < size && readOk; offset += OTA_CHUNK_SIZE) {
+        size_t len = size - offset < OTA_CHUNK_SIZE ? size - offset : OTA_CHUNK_SIZE;
+        readOk = esp_partition_read(target, offset, chunk, len) == ESP_OK;
+        if(readOk) mbedtls_sha256_update(&sha, chunk, len);
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    if(!readOk) return false;
+
+    // Length includes the terminating NUL, as mbedtls wants for PEM
+    mbedtls_pk_init(&key);
+    int rc = mbedtls_pk_parse_public_key(&key, (const unsigned char *)OTA_PUBLIC_KEY_PEM, sizeof(OTA_PUBLIC_KEY_PEM));
+    if(rc != 0) Serial.printf("[OTA] OTA_PUBLIC_KEY_PEM does not parse (-0x%04x)\n", -rc);
+    else rc = mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature, sigLen);
+    mbedtls_pk_free(&key);
+    return rc == 0;
+}
+
+// ============================================================================
+// Update
+// ============================================================================
+
+static void runUpdate() {
+    char url[OTA_URL_MAX];
+    OtaJob job;
+
+    portENTER_CRITICAL(&statusLock);
+    strlcpy(url, jobUrl, sizeof(url));
+    portEXIT_CRITICAL(&statusLock);
+
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    if(target == NULL) {
+        fail("No inactive app partition");
+        return;
+    }
+
+    size_t sigLen = fetchSignature(url);
+    if(sigLen == 0) {
+        fail("Signature download failed");
+        endJob(false);
+        return;
+    }
+
+    loadJob(url, target, &job);
+    Serial.printf("[OTA] %s -> %s%s\n", url, target->label, job.done ? " (resuming)" : "");
+    if(job.done > 0) {
+        portENTER_CRITICAL(&statusLock);
+        status.resumes++;
+        portEXIT_CRITICAL(&statusLock);
+    }
+
+    int64_t started = esp_timer_get_time();
+    for(int attempt = 0; ; attempt++) {
+        DownloadResult result = downloadRange(url, target, &job);
+        if(result == DOWNLOAD_DONE) break;
+        if(result == DOWNLOAD_FATAL || attempt >= OTA_MAX_RESUMES) {
+            saveProgress(&job);
+            endJob(false);
+            fail(result == DOWNLOAD_FATAL ? "Download rejected" : "Too many dropped transfers");
+            return;
+        }
+        Serial.printf("[OTA] Transfer dropped at %lu/%lu, resuming\n", (unsigned long)job.done, (unsigned long)job.size);
+        portENTER_CRITICAL(&statusLock);
+        status.resumes++;
+        portEXIT_CRITICAL(&statusLock);
+        vTaskDelay(pdMS_TO_TICKS(OTA_RETRY_MS));
+    }
+    uint32_t elapsedMs = (esp_timer_get_time() - started) / 1000;
+
+    setPhase(OTA_VERIFYING, NULL);
+    bool verified = verifyImage(target, job.size, sigLen);
+    endJob(true);
+    if(!verified) {
+        fail("Signature check failed");
+        return;
+    }
+    // Also validates the image header, segments and appended hash
+    esp_err_t err = esp_ota_set_boot_partition(target);
+    if(err != ESP_OK) {
+        fail(esp_err_to_name(err));
+        return;
+    }
+
+    Preferences prefs;
+    if(prefs.begin("ota", false)) {
+        prefs.putUInt("trial", target->address);
+        prefs.putUInt("boots", 0);
+        prefs.remove("rolledBack");
+        prefs.end();
+    }
+
+    OtaStatus done;
+    otaGetStatus(&done);
+    float downloadSec = done.downloadUs / 1e6f;
+    Serial.printf("[OTA] %lu KB in %lu ms: %.1f KB/s network, flash %lu ms (longest chunk %lu us), %lu resumes\n",
+                  (unsigned long)(job.size / 1024), (unsigned long)elapsedMs,
+                  downloadSec > 0 ? done.downloadedBytes / 1024.0f / downloadSec : 0.0f,
+                  (unsigned long)(done.flashUs / 1000), (unsigned long)done.flashMaxUs, (unsigned long)done.resumes);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "*⬆️ Update installed*\n\n%lu KB into %s, restarting.", (unsigned long)(job.size / 1024), target->label);
+    telegramAlert(TELEGRAM_TOPIC_SYSTEM, msg);
+    setPhase(OTA_INSTALLED, NULL);
+
+    // Let the alert and MQTT ack out, and never cut power to a moving barrier
+    vTaskDelay(pdMS_TO_TICKS(OTA_RETRY_MS));
+    waitForGateIdle();
+    esp_restart();
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+// Arduino core: keep a PENDING_VERIFY image unconfirmed until otaMaintain
+extern "C" bool verifyRollbackLater() {
+    return true;
+}
+
+void otaBegin() {
+    Preferences prefs;
+
+    if(!prefs.begin("ota", false)) return;
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint32_t trial = prefs.getUInt("trial");
+    if(trial != 0 && running != NULL && running->address != trial) {
+        // The bootloader already went back to the old slot
+        prefs.remove("trial");
+        prefs.remove("boots");
+        prefs.putUInt("rolledBack", 1);
+        Serial.println("[OTA] Bootloader rolled the update back");
+    } else if(trial != 0) {
+        uint32_t boots = prefs.getUInt("boots") + 1;
+        // Only the software counter gets here with boots > 1
+        if(!OTA_BOOTLOADER_ROLLBACK && boots > OTA_TRIAL_BOOTS) {
+            const esp_partition_t *previous = esp_ota_get_next_update_partition(NULL);
+            prefs.remove("trial");
+            prefs.remove("boots");
+            prefs.putUInt("rolledBack", 1);
+            prefs.end();
+            Serial.printf("[OTA] Image unconfirmed after %d boots, rolling back\n", OTA_TRIAL_BOOTS);
+            if(previous != NULL && esp_ota_set_boot_partition(previous) == ESP_OK) esp_restart();
+            Serial.println("[OTA] Previous image is not bootable, staying on this one");
+            return;
+        }
+        prefs.putUInt("boots", boots);
+        status.pendingConfirm = true;
+        Serial.printf("[OTA] Trial boot %lu/%d of %s\n", (unsigned long)boots, OTA_TRIAL_BOOTS, running->label);
+    }
+    status.rolledBack = prefs.getUInt("rolledBack") != 0;
+    rollbackAlertPending = status.rolledBack;
+
+    // Cut off by a reset: carry on once the network is back
+    if(prefs.getUInt("active") != 0) {
+        String url = prefs.getString("url");
+        if(url.length() > 0 && url.length() < OTA_URL_MAX) {
+            strlcpy(jobUrl, url.c_str(), sizeof(jobUrl));
+            status.phase = OTA_DOWNLOADING;
+            resumeAtBoot = true;
+            Serial.printf("[OTA] Resuming %s at %lu bytes\n", jobUrl, (unsigned long)prefs.getUInt("done"));
+        }
+    }
+    prefs.end();
+}
+
+bool otaEnabled() {
+    return OTA_PUBLIC_KEY_PEM[0] != '\0';
+}
+
+bool otaStart(const char *url) {
+    bool started = false;
+
+    if(!otaEnabled()) {
+        Serial.println("[OTA] OTA_PUBLIC_KEY_PEM not set, updates are off");
+        return false;
+    }
+    if(otaTaskHandle == NULL || strlen(url) >= OTA_URL_MAX || strncmp(url, "http", 4) != 0) return false;
+
+    portENTER_CRITICAL(&statusLock);
+    if(!status.pendingConfirm && (status.phase == OTA_IDLE || status.phase == OTA_FAILED)) {
+        strlcpy(jobUrl, url, sizeof(jobUrl));
+        status.phase = OTA_DOWNLOADING;
+        status.error[0] = '\0';
+        started = true;
+    }
+    portEXIT_CRITICAL(&statusLock);
+
+    if(started) xTaskNotifyGive(otaTaskHandle);
+    return started;
+}
+
+void otaMaintain(bool wifiConnected) {
+    if(!wifiConnected) return;
+
+    if(rollbackAlertPending) {
+        rollbackAlertPending = false;
+        telegramAlert(TELEGRAM_TOPIC_SYSTEM, "*⚠️ Update rolled back*\n\nThe new firmware did not come up; running the previous one.");
+        Preferences prefs;
+        if(prefs.begin("ota", false)) {
+            prefs.remove("rolledBack");
+            prefs.end();
+        }
+    }
+
+    if(!status.pendingConfirm || millis() < OTA_CONFIRM_MS) return;
+
+    esp_ota_mark_app_valid_cancel_rollback();
+    Preferences prefs;
+    if(prefs.begin("ota", false)) {
+        prefs.remove("trial");
+        prefs.remove("boots");
+        prefs.end();
+    }
+    portENTER_CRITICAL(&statusLock);
+    status.pendingConfirm = false;
+    portEXIT_CRITICAL(&statusLock);
+    Serial.println("[OTA] New image confirmed");
+}
+
+void otaGetStatus(OtaStatus *out) {
+    portENTER_CRITICAL(&statusLock);
+    *out = status;
+    portEXIT_CRITICAL(&statusLock);
+}
+
+const char *otaPhaseName(OtaPhase phase) {
+    switch(phase) {
+        case OTA_IDLE: return "idle";
+        case OTA_DOWNLOADING: return "downloading";
+        case OTA_VERIFYING: return "verifying";
+        case OTA_INSTALLED: return "installed";
+        case OTA_FAILED: return "failed";
+    }
+    return "unknown";
+}
+
+void otaTask(void *parameter) {
+    Serial.println("[OTA] Started on Core 1");
+    otaTaskHandle = xTaskGetCurrentTaskHandle();
+
+    if(resumeAtBoot) {
+        while(!WiFi.isConnected()) vTaskDelay(pdMS_TO_TICKS(OTA_RETRY_MS));
+        runUpdate();
+    }
+
+    while(1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        runUpdate();
+    }
+}
@@ -0,0 +1,238 @@
+/**
+ * @file parking_state.cpp
+ * @brief Versioned snapshot of the shared parking state (seqlock)
+ */
+
+#include "parking_state.h"
+
+static ParkingState current;
+static volatile uint32_t sequence = 0;      // Odd while a write is in progress
+static portMUX_TYPE writeLock = portMUX_INITIALIZER_UNLOCKED;
+
+static ParkingStateListener listeners[PARKING_STATE_MAX_LISTENERS];
+static volatile int listenerCount = 0;
+static void (*holdsDroppedHandler)(int dropped) = NULL;
+
+// ============================================================================
+// Seqlock Helpers
+// ============================================================================
+
+/**
+ * @brief Enter the writer critical section and mark the data unstable
+ *
+ * The critical section masks interrupts on this core, so a reader can
+ * never preempt a half-finished write on the same core; a reader on the
+ * other core spins for the few hundred nanoseconds the update takes.
+ */
+static inline void beginWrite() {
+    portENTER_CRITICAL(&writeLock);
+    sequence = sequence + 1;
+    __sync_synchronize();
+}
+
+static inline void endWrite() {
+    current.version++;
+    __sync_synchronize();
+    sequence = sequence + 1;
+    portEXIT_CRITICAL(&writeLock);
+
+    for(int i = 0; i < listenerCount; i++) {
+        listeners[i]();
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void parkingStateInit(int totalSlots) {
+    beginWrite();
+    memset(&current, 0, sizeof(current));
+    current.totalSlots = totalSlots;
+    current.availableSlots = totalSlots;
+    current.gate = GATE_IDLE;
+    endWrite();
+}
+
+void parkingStateRead(ParkingState *out) {
+    uint32_t start;
+
+    do {
+        while((start = sequence) & 1) {
+            // Writer active on the other core
+        }
+        __sync_synchronize();
+        memcpy(out, (const void *)&current, sizeof(*out));
+        __sync_synchronize();
+    } while(sequence != start);
+}
+
+uint32_t parkingStateVersion() {
+    return current.version;
+}
+
+bool parkingStateAddListener(ParkingStateListener listener) {
+    bool added = false;
+
+    portENTER_CRITICAL(&writeLock);
+    if(listenerCount < PARKING_STATE_MAX_LISTENERS) {
+        listeners[listenerCount] = listener;
+        listenerCount = listenerCount + 1;
+        added = true;
+    }
+    portEXIT_CRITICAL(&writeLock);
+
+    return added;
+}
+
+bool parkingStateTakeSlot(int *remaining) {
+    bool taken = false;
+
+    beginWrite();
+    if(current.availableSlots > current.reservedSlots) {
+        current.availableSlots--;
+        taken = true;
+    }
+    if(remaining) *remaining = current.availableSlots;
+    endWrite();
+
+    return taken;
+}
+
+bool parkingStateTakeHeldSlot(int *remaining, bool *usedHold) {
+    bool taken = false;
+    bool used = false;
+
+    beginWrite();
+    if(current.availableSlots > 0) {
+        if(current.reservedSlots > 0) {
+            current.reservedSlots--;
+            used = true;
+        }
+        current.availableSlots--;
+        taken = true;
+    }
+    if(remaining) *remaining = current.availableSlots;
+    endWrite();
+
+    if(usedHold) *usedHold = used;
+    return taken;
+}
+
+void parkingStateRestoreHeldSlot() {
+    beginWrite();
+    // A hold must still cover a free slot
+    if(current.reservedSlots < current.availableSlots) current.reservedSlots++;
+    endWrite();
+}
+
+bool parkingStateHoldSlot(int maxHeldPct) {
+    bool held = false;
+
+    beginWrite();
+    int maxHeld = current.totalSlots * maxHeldPct / 100;
+    if(maxHeld < 1) maxHeld = 1;
+    if(current.availableSlots > current.reservedSlots && current.reservedSlots < maxHeld) {
+        current.reservedSlots++;
+        held = true;
+    }
+    endWrite();
+
+    return held;
+}
+
+void parkingStateReleaseHold() {
+    beginWrite();
+    if(current.reservedSlots > 0) current.reservedSlots--;
+    endWrite();
+}
+
+void parkingStateReleaseSlot(int *remaining) {
+    beginWrite();
+    if(current.availableSlots < current.totalSlots) {
+        current.availableSlots++;
+    }
+    if(remaining) *remaining = current.availableSlots;
+    endWrite();
+}
+
+/**
+ * @brief Drop holds no free slot is left for (writer critical section held)
+ * @return Number dropped
+ */
+static int clampHolds() {
+    int dropped = current.reservedSlots - current.availableSlots;
+    if(dropped <= 0) return 0;
+    current.reservedSlots = current.availableSlots;
+    return dropped;
+}
+
+static void reportDroppedHolds(int dropped) {
+    if(dropped > 0 && holdsDroppedHandler != NULL) holdsDroppedHandler(dropped);
+}
+
+void parkingStateSetAvailable(int available) {
+    if(available < 0) available = 0;
+    beginWrite();
+    current.availableSlots = available < current.totalSlots ? available : current.totalSlots;
+    int dropped = clampHolds();
+    endWrite();
+    reportDroppedHolds(dropped);
+}
+
+void parkingStateSetTotal(int totalSlots) {
+    beginWrite();
+    int available = totalSlots - (current.totalSlots - current.availableSlots);
+    current.totalSlots = totalSlots;
+    current.availableSlots = available < 0 ? 0 : (available > totalSlots ? totalSlots : available);
+    int dropped = clampHolds();
+    endWrite();
+    reportDroppedHolds(dropped);
+}
+
+void parkingStateOnHoldsDropped(void (*handler)(int dropped)) {
+    holdsDroppedHandler = handler;
+}
+
+// Each publisher owns its fields, so the unchanged check needs no lock
+
+void parkingStatePublishGate(GateState gate) {
+    if(current.gate == gate) return;
+    beginWrite();
+    current.gate = gate;
+    endWrite();
+}
+
+void parkingStatePublishEnv(float temperature, float humidity) {
+    if(current.temperature == temperature && current.humidity == humidity) return;
+    beginWrite();
+    current.temperature = temperature;
+    current.humidity = humidity;
+    endWrite();
+}
+
+void parkingStatePublishClock(uint32_t bootEpoch) {
+    if(current.bootEpoch == bootEpoch) return;
+    beginWrite();
+    current.bootEpoch = bootEpoch;
+    endWrite();
+}
+
+void parkingStatePublishNetwork(bool wifiConnected, bool internetConnected) {
+    if(current.wifiConnected == wifiConnected && current.internetConnected == internetConnected) return;
+    beginWrite();
+    current.wifiConnected = wifiConnected;
+    current.internetConnected = internetConnected;
+    endWrite();
+}
+
+void parkingStatePublishSite(int available, int total, int nodes, const char *redirect) {
+    if(current.siteAvailable == available && current.siteTotal == total && current.siteNodes == nodes &&
+       strcmp(current.redirect, redirect) == 0) return;
+    beginWrite();
+    current.siteAvailable = available;
+    current.siteTotal = total;
+    current.siteNodes = nodes;
+    strlcpy(current.redirect, redirect, sizeof(current.redirect));
+    endWrite();
+}
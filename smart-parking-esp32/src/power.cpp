@@ -0,0 +1,76 @@
+/**
+ * @file power.cpp
+ * @brief Low-power mode: frequency scaling and automatic light sleep
+ */
+
+#include "power.h"
+#include "config.h"
+#include <WiFi.h>
+
+#ifndef POWER_SAVE_MODE
+    #define POWER_SAVE_MODE 0
+#endif
+#ifndef POWER_MAX_FREQ_MHZ
+    #define POWER_MAX_FREQ_MHZ 240
+#endif
+#ifndef POWER_MIN_FREQ_MHZ
+    #define POWER_MIN_FREQ_MHZ 80
+#endif
+
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+    #include <esp_pm.h>
+    #include <esp_sleep.h>
+    static esp_pm_lock_handle_t awakeLock = NULL;
+#endif
+
+static bool lightSleep = false;
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void powerBegin() {
+#if POWER_SAVE_MODE
+    // Keep the association through DTIM beacons instead of full power
+    WiFi.setSleep(true);
+
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pm = {};
+#else
+    esp_pm_config_esp32_t pm = {};
+#endif
+    pm.max_freq_mhz = POWER_MAX_FREQ_MHZ;
+    pm.min_freq_mhz = POWER_MIN_FREQ_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = true;
+#endif
+
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "barrier", &awakeLock);
+    esp_err_t err = esp_pm_configure(&pm);
+    if(err != ESP_OK) {
+        Serial.printf("[Power] esp_pm_configure failed (%d), running at full power\n", err);
+        return;
+    }
+    lightSleep = pm.light_sleep_enable;
+    if(lightSleep) esp_sleep_enable_gpio_wakeup();
+
+    Serial.printf("[Power] %d-%d MHz, light sleep %s\n", POWER_MIN_FREQ_MHZ, POWER_MAX_FREQ_MHZ,
+                  lightSleep ? "on" : "off (no tickless idle in this build)");
+#else
+    Serial.println("[Power] Framework built without CONFIG_PM_ENABLE, modem sleep only");
+#endif
+#endif
+}
+
+bool powerLightSleepEnabled() {
+    return lightSleep;
+}
+
+void powerStayAwake(bool awake) {
+#if POWER_SAVE_MODE && CONFIG_PM_ENABLE
+    if(awakeLock == NULL) return;
+    if(awake) esp_pm_lock_acquire(awakeLock);
+    else esp_pm_lock_release(awakeLock);
+#endif
+}
@@ -0,0 +1,465 @@
+/**
+ * @file reservation.cpp
+ * @brief Slot reservations by plate or token, held against the lot counter
+ */
+
+#include "reservation.h"
+#include "config.h"
+#include "lane.h"
+#include "parking_state.h"
+#include <esp_timer.h>
+#include <esp_system.h>
+
+#ifndef RESERVATION_MAX
+    #define RESERVATION_MAX 8
+#endif
+#ifndef RESERVATION_TABLE_SIZE
+    #define RESERVATION_TABLE_SIZE 16
+#endif
+#ifndef RESERVATION_MAX_HELD_PCT
+    #define RESERVATION_MAX_HELD_PCT 50
+#endif
+#ifndef RESERVATION_PER_REQUESTER
+    #define RESERVATION_PER_REQUESTER 1
+#endif
+#ifndef RESERVATION_HOLD_MIN
+    #define RESERVATION_HOLD_MIN 30
+#endif
+#ifndef RESERVATION_MAX_HOLD_MIN
+    #define RESERVATION_MAX_HOLD_MIN 240
+#endif
+#ifndef RESERVATION_WHEEL_SLOTS
+    #define RESERVATION_WHEEL_SLOTS 64
+#endif
+#ifndef RESERVATION_WHEEL_TICK_S
+    #define RESERVATION_WHEEL_TICK_S 30
+#endif
+
+#define TOKEN_LEN 6
+#define NONE 0xFF
+
+static_assert(RESERVATION_MAX < NONE, "record indices are 8 bits");
+static_assert((RESERVATION_TABLE_SIZE & (RESERVATION_TABLE_SIZE - 1)) == 0, "RESERVATION_TABLE_SIZE must be a power of two");
+static_assert(RESERVATION_TABLE_SIZE >= 2 * RESERVATION_MAX, "keep the hash table at most half full so probes stay short");
+static_assert(RESERVATION_MAX_HOLD_MIN * 60 / RESERVATION_WHEEL_TICK_S / RESERVATION_WHEEL_SLOTS < 256, "wheel rounds are 8 bits");
+static_assert(TOKEN_LEN < RESERVATION_CODE_MAX, "token does not fit a code");
+
+typedef enum {
+    RECORD_FREE = 0,
+    RECORD_HELD,                // Slot held, driver not here yet
+    RECORD_ARRIVED              // Checked in at a lane, waiting for the entry event
+} RecordState;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t owner;             // hashCode() of the requester
+    uint32_t expiresSec;        // Uptime
+    char code[RESERVATION_CODE_MAX];
+    uint8_t state;              // RecordState
+    uint8_t rounds;             // Wheel turns left before expiry
+    uint8_t wheelSlot;
+    uint8_t next;               // Wheel slot list, or the free list
+    uint8_t prev;
+    int8_t lane;                // RECORD_ARRIVED: lane it waits at
+} Reservation;
+
+static portMUX_TYPE storeLock = portMUX_INITIALIZER_UNLOCKED;
+static Reservation records[RESERVATION_MAX];
+static uint8_t table[RESERVATION_TABLE_SIZE];       // Record index or NONE
+static uint8_t wheel[RESERVATION_WHEEL_SLOTS];      // List head per slot
+static uint8_t pending[LANE_MAX];                   // Checked-in record per lane
+static uint8_t freeHead = NONE;
+static int active = 0;
+
+static uint16_t wheelCursor = 0;        // Slot processed at nextTickSec
+static uint32_t nextTickSec = 0;
+
+static ReservationCounters counters;
+static void (*arrivalHook)(int lane) = NULL;
+
+static const char tokenAlphabet[] = "ABCDEFGHJKLMNPQRSTUVWXYZ23456789";     // No 0/O, 1/I
+
+static uint32_t uptimeSec() {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+// ============================================================================
+// Codes
+// ============================================================================
+
+/**
+ * @brief Upper-case letters and digits only, so "abc-123" finds "ABC 123"
+ * @return false if nothing (or too much) is left
+ */
+static bool normaliseCode(const char *in, char *out) {
+    size_t n = 0;
+
+    for(; *in; in++) {
+        char c = toupper((unsigned char)*in);
+        if(!isalnum((unsigned char)c)) continue;
+        if(n + 1 >= RESERVATION_CODE_MAX) return false;
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return n > 0;
+}
+
+static void makeToken(char *out) {
+    uint32_t bits = esp_random();
+
+    // 5 bits per character, 6 characters = 30 bits of one draw
+    for(int i = 0; i < TOKEN_LEN; i++, bits >>= 5) out[i] = tokenAlphabet[bits & 31];
+    out[TOKEN_LEN] = '\0';
+}
+
+/**
+ * @brief FNV-1a, 32-bit
+ */
+static uint32_t hashCode(const char *code) {
+    uint32_t h = 2166136261UL;
+    while(*code) h = (h ^ (uint8_t)*code++) * 16777619UL;
+    return h;
+}
+
+// ============================================================================
+// Hash Table (linear probing, backward-shift delete; caller holds storeLock)
+// ============================================================================
+
+#define TABLE_MASK (RESERVATION_TABLE_SIZE - 1)
+
+/**
+ * @brief Table position holding code, or -1
+ */
+static int tableFind(uint32_t hash, const char *code) {
+    for(uint32_t i = hash & TABLE_MASK;; i = (i + 1) & TABLE_MASK) {
+        uint8_t index = table[i];
+        if(index == NONE) return -1;
+        if(records[index].hash == hash && strcmp(records[index].code, code) == 0) return i;
+    }
+}
+
+static void tableInsert(uint8_t index) {
+    uint32_t i = records[index].hash & TABLE_MASK;
+    while(table[i] != NONE) i = (i + 1) & TABLE_MASK;
+    table[i] = index;
+}
+
+/**
+ * @brief Close the gap so later probes never stop early (no tombstones)
+ */
+static void tableRemove(uint32_t hole) {
+    for(uint32_t i = (hole + 1) & TABLE_MASK; table[i] != NONE; i = (i + 1) & TABLE_MASK) {
+        uint32_t home = records[table[i]].hash & TABLE_MASK;
+        // Move the entry back unless its home lies between the hole and it
+        if(((i - home) & TABLE_MASK) >= ((i - hole) & TABLE_MASK)) {
+            table[hole] = table[i];
+            hole = i;
+        }
+    }
+    table[hole] = NONE;
+}
+
+// ============================================================================
+// Timer Wheel (caller holds storeLock)
+// ============================================================================
+
+static void wheelInsert(uint8_t index) {
+    Reservation *r = &records[index];
+    uint32_t ticks = r->expiresSec <= nextTickSec ? 0 : (r->expiresSec - nextTickSec + RESERVATION_WHEEL_TICK_S - 1) / RESERVATION_WHEEL_TICK_S;
+
+    r->wheelSlot = (wheelCursor + ticks) % RESERVATION_WHEEL_SLOTS;
+    r->rounds = ticks / RESERVATION_WHEEL_SLOTS;
+    r->prev = NONE;
+    r->next = wheel[r->wheelSlot];
+    if(r->next != NONE) records[r->next].prev = index;
+    wheel[r->wheelSlot] = index;
+}
+
+static void wheelRemove(uint8_t index) {
+    Reservation *r = &records[index];
+
+    if(r->prev != NONE) records[r->prev].next = r->next;
+    else wheel[r->wheelSlot] = r->next;
+    if(r->next != NONE) records[r->next].prev = r->prev;
+}
+
+/**
+ * @brief Open bookings of one requester (RESERVATION_MAX is small, so
+ *        this scans the records; only reservationCreate() calls it)
+ */
+static int ownedBy(uint32_t owner) {
+    int count = 0;
+    for(int i = 0; i < RESERVATION_MAX; i++) {
+        if(records[i].state != RECORD_FREE && records[i].owner == owner) count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Take a record out of the table, the wheel and its lane
+ */
+static void recordRemove(uint8_t index, int tablePos) {
+    Reservation *r = &records[index];
+
+    tableRemove(tablePos);
+    wheelRemove(index);
+    if(r->state == RECORD_ARRIVED && pending[r->lane] == index) pending[r->lane] = NONE;
+    r->state = RECORD_FREE;
+    r->next = freeHead;
+    freeHead = index;
+    active--;
+}
+
+/**
+ * @brief The free count was overwritten below the holds (bay sensors,
+ *        new capacity) and parking_state dropped that many
+ *
+ * Bookings whose driver has not checked in go first, soonest expiry
+ * first. A rare correction, so it scans the records instead of indexing.
+ */
+static void onHoldsDropped(int dropped) {
+    int revoked = 0;
+
+    portENTER_CRITICAL(&storeLock);
+    for(; revoked < dropped && active > 0; revoked++) {
+        int victim = -1;
+        for(int i = 0; i < RESERVATION_MAX; i++) {
+            Reservation *r = &records[i];
+            if(r->state == RECORD_FREE) continue;
+            if(victim < 0) {
+                victim = i;
+                continue;
+            }
+            Reservation *v = &records[victim];
+            bool earlier = (int32_t)(r->expiresSec - v->expiresSec) < 0;
+            if(r->state != v->state ? r->state == RECORD_HELD : earlier) victim = i;
+        }
+        recordRemove(victim, tableFind(records[victim].hash, records[victim].code));
+        counters.revoked++;
+    }
+    portEXIT_CRITICAL(&storeLock);
+
+    if(revoked > 0) Serial.printf("[Reserve] Free count corrected: %d reservation(s) revoked, %d open\n", revoked, active);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void reservationBegin(void (*onArrival)(int lane)) {
+    arrivalHook = onArrival;
+    memset(table, NONE, sizeof(table));
+    memset(wheel, NONE, sizeof(wheel));
+    memset(pending, NONE, sizeof(pending));
+    for(int i = RESERVATION_MAX - 1; i >= 0; i--) {
+        records[i].state = RECORD_FREE;
+        records[i].next = freeHead;
+        freeHead = i;
+    }
+    nextTickSec = uptimeSec() + RESERVATION_WHEEL_TICK_S;
+    parkingStateOnHoldsDropped(onHoldsDropped);
+}
+
+ReserveResult reservationCreate(const char *plate, uint32_t holdMin, const char *requester, ReservationInfo *out) {
+    bool issueToken = plate == NULL || plate[0] == '\0';
+    char code[RESERVATION_CODE_MAX];
+    ReserveResult result = RESERVE_OK;
+    uint32_t owner = requester != NULL ? hashCode(requester) : 0;
+
+    if(holdMin == 0) holdMin = RESERVATION_HOLD_MIN;
+    if(requester == NULL || requester[0] == '\0') {
+        result = RESERVE_UNAUTHORIZED;
+    } else if(holdMin > RESERVATION_MAX_HOLD_MIN || (!issueToken && !normaliseCode(plate, code))) {
+        result = RESERVE_INVALID;
+    } else if(!parkingStateHoldSlot(RESERVATION_MAX_HELD_PCT)) {
+        ParkingState state;
+        parkingStateRead(&state);
+        result = state.availableSlots > state.reservedSlots ? RESERVE_HELD_LIMIT : RESERVE_FULL;
+    }
+
+    if(result == RESERVE_OK) {
+        portENTER_CRITICAL(&storeLock);
+        if(ownedBy(owner) >= RESERVATION_PER_REQUESTER) {
+            result = RESERVE_REQUESTER_LIMIT;
+        } else if(freeHead == NONE) {
+            result = RESERVE_TABLE_FULL;
+        } else {
+            // A fresh token that collides with an open code is drawn again
+            uint32_t hash;
+            do {
+                if(issueToken) makeToken(code);
+                hash = hashCode(code);
+            } while(issueToken && tableFind(hash, code) >= 0);
+
+            if(tableFind(hash, code) >= 0) {
+                result = RESERVE_DUPLICATE;
+            } else {
+                uint8_t index = freeHead;
+                Reservation *r = &records[index];
+                freeHead = r->next;
+                r->hash = hash;
+                r->owner = owner;
+                r->expiresSec = uptimeSec() + holdMin * 60;
+                strlcpy(r->code, code, sizeof(r->code));
+                r->state = RECORD_HELD;
+                r->lane = -1;
+                tableInsert(index);
+                wheelInsert(index);
+                active++;
+                counters.created++;
+            }
+        }
+        portEXIT_CRITICAL(&storeLock);
+
+        if(result != RESERVE_OK) parkingStateReleaseHold();
+    }
+
+    if(result != RESERVE_OK) {
+        portENTER_CRITICAL(&storeLock);
+        counters.refused++;
+        portEXIT_CRITICAL(&storeLock);
+        return result;
+    }
+
+    Serial.printf("[Reserve] %s held for %lu min\n", code, (unsigned long)holdMin);
+    if(out) {
+        strlcpy(out->code, code, sizeof(out->code));
+        out->expiresInSec = holdMin * 60;
+    }
+    return RESERVE_OK;
+}
+
+ReserveResult reservationCancel(const char *code) {
+    char key[RESERVATION_CODE_MAX];
+    bool found = false;
+
+    if(!normaliseCode(code, key)) return RESERVE_INVALID;
+
+    portENTER_CRITICAL(&storeLock);
+    int pos = tableFind(hashCode(key), key);
+    if(pos >= 0) {
+        recordRemove(table[pos], pos);
+        counters.cancelled++;
+        found = true;
+    }
+    portEXIT_CRITICAL(&storeLock);
+
+    if(!found) return RESERVE_NOT_FOUND;
+    parkingStateReleaseHold();
+    Serial.printf("[Reserve] %s cancelled\n", key);
+    return RESERVE_OK;
+}
+
+ReserveResult reservationArrive(const char *code, int lane) {
+    char key[RESERVATION_CODE_MAX];
+    bool found = false;
+
+    if(lane < 0) {
+        // First entry lane when the driver did not say
+        for(int l = 0; l < laneCount() && lane < 0; l++) {
+            if(laneConfig(l)->direction == LANE_ENTRY) lane = l;
+        }
+    }
+    if(lane < 0 || lane >= laneCount() || laneConfig(lane)->direction != LANE_ENTRY) return RESERVE_INVALID;
+    if(!normaliseCode(code, key)) return RESERVE_INVALID;
+
+    portENTER_CRITICAL(&storeLock);
+    int pos = tableFind(hashCode(key), key);
+    if(pos >= 0) {
+        uint8_t index = table[pos];
+        Reservation *r = &records[index];
+
+        // One waiting car per lane; an earlier check-in there goes back to held
+        if(pending[lane] != NONE && pending[lane] != index) {
+            records[pending[lane]].state = RECORD_HELD;
+            records[pending[lane]].lane = -1;
+        }
+        if(r->state == RECORD_ARRIVED && pending[r->lane] == index) pending[r->lane] = NONE;
+        r->state = RECORD_ARRIVED;
+        r->lane = lane;
+        pending[lane] = index;
+        found = true;
+    }
+    portEXIT_CRITICAL(&storeLock);
+
+    if(!found) return RESERVE_NOT_FOUND;
+    Serial.printf("[Reserve] %s checked in at %s\n", key, laneConfig(lane)->name);
+    if(arrivalHook != NULL) arrivalHook(lane);
+    return RESERVE_OK;
+}
+
+bool reservationWaiting(int lane) {
+    return pending[lane] != NONE;
+}
+
+bool reservationClaim(int lane) {
+    bool claimed = false;
+
+    // Walk-ins (nothing pending) never take the lock
+    if(pending[lane] == NONE) return false;
+
+    portENTER_CRITICAL(&storeLock);
+    uint8_t index = pending[lane];
+    if(index != NONE) {
+        Reservation *r = &records[index];
+        recordRemove(index, tableFind(r->hash, r->code));
+        counters.arrived++;
+        claimed = true;
+    }
+    portEXIT_CRITICAL(&storeLock);
+
+    return claimed;
+}
+
+void reservationMaintain() {
+    uint32_t now = uptimeSec();
+    int expired = 0;
+
+    while((int32_t)(now - nextTickSec) >= 0) {
+        portENTER_CRITICAL(&storeLock);
+        uint8_t index = wheel[wheelCursor];
+        while(index != NONE) {
+            Reservation *r = &records[index];
+            uint8_t next = r->next;
+            if(r->rounds > 0) {
+                r->rounds--;
+            } else {
+                recordRemove(index, tableFind(r->hash, r->code));
+                counters.expired++;
+                expired++;
+            }
+            index = next;
+        }
+        wheelCursor = (wheelCursor + 1) % RESERVATION_WHEEL_SLOTS;
+        nextTickSec += RESERVATION_WHEEL_TICK_S;
+        portEXIT_CRITICAL(&storeLock);
+    }
+
+    for(int i = 0; i < expired; i++) parkingStateReleaseHold();
+    if(expired > 0) Serial.printf("[Reserve] %d reservation(s) expired, %d open\n", expired, active);
+}
+
+int reservationActive() {
+    return active;
+}
+
+void reservationGetCounters(ReservationCounters *out) {
+    portENTER_CRITICAL(&storeLock);
+    *out = counters;
+    portEXIT_CRITICAL(&storeLock);
+}
+
+const char *reservationResultName(ReserveResult result) {
+    switch(result) {
+        case RESERVE_OK:               return "ok";
+        case RESERVE_FULL:             return "full";
+        case RESERVE_HELD_LIMIT:       return "reservation share of the lot taken";
+        case RESERVE_REQUESTER_LIMIT:  return "limit per requester reached";
+        case RESERVE_UNAUTHORIZED:     return "not allowed";
+        case RESERVE_TABLE_FULL:       return "too many reservations";
+        case RESERVE_DUPLICATE:        return "already reserved";
+        case RESERVE_INVALID:          return "invalid";
+        case RESERVE_NOT_FOUND:        return "not found";
+        default:                       return "?";
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file sensor_filter.cpp
+ * @brief Median-gated EMA for slow, noisy scalar sensors (DHT22)
+ */
+
+#include "sensor_filter.h"
+#include <math.h>
+
+// The median is only meaningful once a few samples agree
+#define SENSOR_FILTER_MIN_SAMPLES 3
+
+static float windowMedian(const SensorFilter *filter) {
+    float sorted[SENSOR_FILTER_WINDOW];
+    int n = filter->count;
+
+    // Insertion sort, at most SENSOR_FILTER_WINDOW elements
+    for(int i = 0; i < n; i++) {
+        float v = filter->window[i];
+        int j = i;
+        while(j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return (n & 1) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+void sensorFilterInit(SensorFilter *filter, float alpha, float outlierDelta) {
+    filter->count = 0;
+    filter->next = 0;
+    filter->alpha = alpha;
+    filter->outlierDelta = outlierDelta;
+    filter->value = 0;
+    filter->rejected = 0;
+}
+
+bool sensorFilterAdd(SensorFilter *filter, float sample) {
+    bool accept = true;
+
+    if(filter->count >= SENSOR_FILTER_MIN_SAMPLES) {
+        accept = fabsf(sample - windowMedian(filter)) <= filter->outlierDelta;
+    }
+
+    filter->window[filter->next] = sample;
+    filter->next = (filter->next + 1) % SENSOR_FILTER_WINDOW;
+    if(filter->count < SENSOR_FILTER_WINDOW) filter->count++;
+
+    if(!accept) {
+        filter->rejected++;
+        return false;
+    }
+    if(filter->count == 1) filter->value = sample;
+    else filter->value += filter->alpha * (sample - filter->value);
+    return true;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file servo_motion.cpp
+ * @brief Ramped barrier servo motion on LEDC PWM
+ */
+
+#include "servo_motion.h"
+#include "config.h"
+#include <esp_timer.h>
+#include <math.h>
+
+#ifndef SERVO_MAX_SPEED_DPS
+    #define SERVO_MAX_SPEED_DPS 360
+#endif
+#ifndef SERVO_ACCEL_DPS2
+    #define SERVO_ACCEL_DPS2 1440
+#endif
+#ifndef SERVO_RAMP_TICK_MS
+    #define SERVO_RAMP_TICK_MS 10
+#endif
+#ifndef SERVO_MIN_PULSE_US
+    #define SERVO_MIN_PULSE_US 544
+#endif
+#ifndef SERVO_MAX_PULSE_US
+    #define SERVO_MAX_PULSE_US 2400
+#endif
+
+#define SERVO_PWM_HZ 50
+#define SERVO_PWM_BITS 16
+#define SERVO_PERIOD_US (1000000 / SERVO_PWM_HZ)
+#define SERVO_MAX_COUNT 4
+#define SERVO_SETTLED_DEG 0.05f
+
+static ServoMotion *servos[SERVO_MAX_COUNT];
+static int servoCount = 0;
+static portMUX_TYPE motionLock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t rampTimer = NULL;
+static bool rampRunning = false;        // Guarded by motionLock
+
+// ============================================================================
+// PWM
+// ============================================================================
+
+static void writeAngle(const ServoMotion *servo, float angle) {
+    if(angle < 0) angle = 0;
+    if(angle > 180) angle = 180;
+
+    uint32_t pulseUs = SERVO_MIN_PULSE_US + (uint32_t)(angle * (SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US) / 180.0f);
+    uint32_t duty = (uint32_t)(((uint64_t)pulseUs << SERVO_PWM_BITS) / SERVO_PERIOD_US);
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcWriteChannel(servo->channel, duty);
+#else
+    ledcWrite(servo->channel, duty);
+#endif
+}
+
+// ============================================================================
+// Profile
+// ============================================================================
+
+/**
+ * @brief Advance one servo by dt; returns true while still moving
+ *
+ * Accelerates towards the target until the remaining distance equals the
+ * braking distance v^2 / 2a, then decelerates, so every move (including
+ * a reversal mid-swing) is rest-to-rest without a jerk to full speed.
+ */
+static bool stepServo(ServoMotion *s, float dt) {
+    const float vmax = SERVO_MAX_SPEED_DPS;
+    const float accel = SERVO_ACCEL_DPS2;
+    float remaining = s->target - s->position;
+
+    if(fabsf(remaining) < SERVO_SETTLED_DEG && fabsf(s->velocity) <= accel * dt) {
+        s->position = s->target;
+        s->velocity = 0;
+        return false;
+    }
+
+    float dir = remaining > 0 ? 1.0f : -1.0f;
+    float braking = s->velocity * s->velocity / (2 * accel);
+    bool towards = s->velocity * dir >= 0;
+
+    if(towards && fabsf(remaining) <= braking) {
+        s->velocity -= dir * accel * dt;               // Brake into the target
+        if(s->velocity * dir < 0) s->velocity = 0;
+    } else {
+        s->velocity += dir * accel * dt;               // Speed up, or reverse
+        if(s->velocity > vmax) s->velocity = vmax;
+        if(s->velocity < -vmax) s->velocity = -vmax;
+    }
+
+    float next = s->position + s->velocity * dt;
+    // Never step past the target
+    if((s->target - next) * dir < 0) {
+        next = s->target;
+        s->velocity = 0;
+    }
+    s->position = next;
+    return true;
+}
+
+/**
+ * @brief Ramp tick (esp_timer task); re-arms itself until all servos settle
+ *
+ * One-shot re-arming instead of a periodic timer: the decision to stop
+ * and a concurrent servoMotionMoveTo() meet under motionLock, so a new
+ * move can never be lost between "stop" and "start".
+ */
+static void onRampTimer(void *) {
+    const float dt = SERVO_RAMP_TICK_MS / 1000.0f;
+    bool moving = false;
+
+    for(int i = 0; i < servoCount; i++) {
+        ServoMotion *s = servos[i];
+
+        portENTER_CRITICAL(&motionLock);
+        stepServo(s, dt);
+        float angle = s->position;
+        portEXIT_CRITICAL(&motionLock);
+
+        writeAngle(s, angle);
+    }
+
+    portENTER_CRITICAL(&motionLock);
+    for(int i = 0; i < servoCount; i++) {
+        if(servos[i]->position != servos[i]->target || servos[i]->velocity != 0) moving = true;
+    }
+    rampRunning = moving;
+    portEXIT_CRITICAL(&motionLock);
+
+    if(moving) esp_timer_start_once(rampTimer, SERVO_RAMP_TICK_MS * 1000);
+}
+
+uint32_t servoMotionTravelMs(float degrees) {
+    const float vmax = SERVO_MAX_SPEED_DPS;
+    const float accel = SERVO_ACCEL_DPS2;
+    float d = fabsf(degrees);
+    float sec;
+
+    if(d >= vmax * vmax / accel) sec = d / vmax + vmax / accel;    // Trapezoid
+    else sec = 2 * sqrtf(d / accel);                               // Triangle
+
+    // Round up to whole ticks, plus one for the tick that notices arrival
+    uint32_t ticks = (uint32_t)ceilf(sec * 1000.0f / SERVO_RAMP_TICK_MS) + 1;
+    return ticks * SERVO_RAMP_TICK_MS;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+bool servoMotionAttach(ServoMotion *servo, int pin, uint8_t channel, float startAngle) {
+    servo->channel = -1;
+    if(servoCount >= SERVO_MAX_COUNT) return false;
+
+    if(rampTimer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = onRampTimer,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "servo",
+            .skip_unhandled_events = true,
+        };
+        if(esp_timer_create(&args, &rampTimer) != ESP_OK) return false;
+    }
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    if(!ledcAttachChannel(pin, SERVO_PWM_HZ, SERVO_PWM_BITS, channel)) return false;
+#else
+    if(ledcSetup(channel, SERVO_PWM_HZ, SERVO_PWM_BITS) == 0) return false;
+    ledcAttachPin(pin, channel);
+#endif
+
+    servo->channel = channel;
+    servo->position = startAngle;
+    servo->target = startAngle;
+    servo->velocity = 0;
+    writeAngle(servo, startAngle);
+    servos[servoCount++] = servo;
+    return true;
+}
+
+void servoMotionMoveTo(ServoMotion *servo, float angle) {
+    if(servo->channel < 0) return;
+
+    portENTER_CRITICAL(&motionLock);
+    servo->target = angle;
+    bool start = !rampRunning;
+    rampRunning = true;
+    portEXIT_CRITICAL(&motionLock);
+
+    if(start) esp_timer_start_once(rampTimer, SERVO_RAMP_TICK_MS * 1000);
+}
+
+bool servoMotionBusy(const ServoMotion *servo) {
+    portENTER_CRITICAL(&motionLock);
+    bool busy = servo->position != servo->target || servo->velocity != 0;
+    portEXIT_CRITICAL(&motionLock);
+    return busy;
+}
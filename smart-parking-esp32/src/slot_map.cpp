@@ -0,0 +1,131 @@
+/**
+ * @file slot_map.cpp
+ * @brief Per-bay occupancy bitmap with scan-to-scan debounce
+ */
+
+#include "slot_map.h"
+
+static portMUX_TYPE mapLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t stable[SLOT_MAP_WORDS];     // Debounced state
+static uint32_t raw[SLOT_MAP_WORDS];        // Previous scan
+static int slotCount = 0;
+static int occupiedCount = 0;
+
+/**
+ * @brief Mask of the bays that exist in word w
+ */
+static inline uint32_t wordMask(int w) {
+    int bits = slotCount - w * 32;
+    if(bits >= 32) return 0xFFFFFFFFu;
+    if(bits <= 0) return 0;
+    return (1u << bits) - 1;
+}
+
+/**
+ * @brief Recount after an update (mapLock held)
+ */
+static void recount() {
+    int n = 0;
+    for(int w = 0; w < SLOT_MAP_WORDS; w++) {
+        n += __builtin_popcount(stable[w]);
+    }
+    occupiedCount = n;
+}
+
+void slotMapInit(int count) {
+    portENTER_CRITICAL(&mapLock);
+    slotCount = count < 0 ? 0 : (count > SLOT_MAP_MAX ? SLOT_MAP_MAX : count);
+    memset(stable, 0, sizeof(stable));
+    memset(raw, 0, sizeof(raw));
+    occupiedCount = 0;
+    portEXIT_CRITICAL(&mapLock);
+}
+
+void slotMapPrime(const uint32_t *scan) {
+    portENTER_CRITICAL(&mapLock);
+    for(int w = 0; w < SLOT_MAP_WORDS; w++) {
+        stable[w] = raw[w] = scan[w] & wordMask(w);
+    }
+    recount();
+    portEXIT_CRITICAL(&mapLock);
+}
+
+int slotMapUpdate(const uint32_t *scan) {
+    int changed = 0;
+
+    portENTER_CRITICAL(&mapLock);
+    for(int w = 0; w < SLOT_MAP_WORDS; w++) {
+        uint32_t now = scan[w] & wordMask(w);
+        // Flip bays that differ from the debounced state and match the last scan
+        uint32_t flip = (now ^ stable[w]) & ~(now ^ raw[w]);
+        stable[w] ^= flip;
+        raw[w] = now;
+        changed += __builtin_popcount(flip);
+    }
+    if(changed) recount();
+    portEXIT_CRITICAL(&mapLock);
+
+    return changed;
+}
+
+int slotMapCount() {
+    return slotCount;
+}
+
+int slotMapOccupiedCount() {
+    return occupiedCount;
+}
+
+bool slotMapOccupied(int slot) {
+    if(slot < 0 || slot >= slotCount) return false;
+    return (stable[slot / 32] >> (slot % 32)) & 1;
+}
+
+int slotMapFirstFree() {
+    int found = -1;
+
+    portENTER_CRITICAL(&mapLock);
+    for(int w = 0; w < SLOT_MAP_WORDS && found < 0; w++) {
+        uint32_t freeBits = ~stable[w] & wordMask(w);
+        if(freeBits) found = w * 32 + __builtin_ctz(freeBits);
+    }
+    portEXIT_CRITICAL(&mapLock);
+
+    return found;
+}
+
+void slotMapCopy(uint32_t *words) {
+    portENTER_CRITICAL(&mapLock);
+    memcpy(words, stable, sizeof(stable));
+    portEXIT_CRITICAL(&mapLock);
+}
+
+size_t slotMapToJson(char *buf, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    uint32_t words[SLOT_MAP_WORDS];
+    int count = slotCount;
+
+    slotMapCopy(words);
+
+    int occupied = 0;
+    for(int w = 0; w < SLOT_MAP_WORDS; w++) occupied += __builtin_popcount(words[w]);
+
+    int n = snprintf(buf, len, "{\"total\":%d,\"occupied\":%d,\"free\":%d,\"bitmap\":\"",
+                     count, occupied, count - occupied);
+    if(n < 0) return 0;
+
+    size_t pos = n;
+    int bytes = (count + 7) / 8;
+    if(pos + bytes * 2 + 3 > len) return 0;
+
+    for(int i = 0; i < bytes; i++) {
+        uint8_t b = words[i / 4] >> ((i % 4) * 8);
+        buf[pos++] = hex[b >> 4];
+        buf[pos++] = hex[b & 0x0F];
+    }
+    buf[pos++] = '"';
+    buf[pos++] = '}';
+    buf[pos] = '\0';
+
+    return pos;
+}
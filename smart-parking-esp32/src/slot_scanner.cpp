@@ -0,0 +1,225 @@
+/**
+ * @file slot_scanner.cpp
+ * @brief Batched scan of per-bay presence sensors behind expanders
+ */
+
+#include "slot_scanner.h"
+#include "slot_map.h"
+#include "parking_state.h"
+#include "journal.h"
+
+#ifndef TOTAL_PARKING_SLOTS
+    #define TOTAL_PARKING_SLOTS 4
+#endif
+#ifndef SLOT_SENSOR_ACTIVE_LOW
+    #define SLOT_SENSOR_ACTIVE_LOW 1
+#endif
+#ifndef SLOT_SCAN_INTERVAL_MS
+    #define SLOT_SCAN_INTERVAL_MS 100
+#endif
+#ifndef SLOT_RECONCILE_MS
+    #define SLOT_RECONCILE_MS 60000
+#endif
+
+#if SLOT_SENSOR_TYPE != SLOT_SENSOR_NONE && TOTAL_PARKING_SLOTS > SLOT_MAP_MAX
+    #error "TOTAL_PARKING_SLOTS exceeds SLOT_MAP_MAX"
+#endif
+
+#if SLOT_SENSOR_TYPE == SLOT_SENSOR_SHIFT_REGISTER
+// ============================================================================
+// 74HC165 Chain (SPI)
+// ============================================================================
+#include <SPI.h>
+
+#ifndef SLOT_SR_LOAD_PIN
+    #define SLOT_SR_LOAD_PIN 32
+#endif
+#ifndef SLOT_SR_CLK_PIN
+    #define SLOT_SR_CLK_PIN 14
+#endif
+#ifndef SLOT_SR_DATA_PIN
+    #define SLOT_SR_DATA_PIN 34
+#endif
+#ifndef SLOT_SR_SPI_HZ
+    #define SLOT_SR_SPI_HZ 1000000
+#endif
+
+static SPIClass slotSpi(HSPI);
+
+static void busBegin() {
+    pinMode(SLOT_SR_LOAD_PIN, OUTPUT);
+    digitalWrite(SLOT_SR_LOAD_PIN, HIGH);
+    slotSpi.begin(SLOT_SR_CLK_PIN, SLOT_SR_DATA_PIN, -1, -1);
+}
+
+/**
+ * @brief Latch every input, then clock the whole chain out in one transfer
+ *
+ * LSB-first, so the first bit out of the chain (D7 of the chip wired to
+ * the ESP32) lands in bit 0 and is bay 0.
+ */
+static bool busScan(uint8_t *bytes, int count) {
+    digitalWrite(SLOT_SR_LOAD_PIN, LOW);
+    delayMicroseconds(1);
+    digitalWrite(SLOT_SR_LOAD_PIN, HIGH);
+
+    slotSpi.beginTransaction(SPISettings(SLOT_SR_SPI_HZ, LSBFIRST, SPI_MODE0));
+    slotSpi.transferBytes(NULL, bytes, count);
+    slotSpi.endTransaction();
+    return true;
+}
+
+#elif SLOT_SENSOR_TYPE == SLOT_SENSOR_MCP23017
+// ============================================================================
+// MCP23017 Expanders (I2C, shared with the LCD)
+// ============================================================================
+#include <Wire.h>
+
+#ifndef SLOT_MCP_BASE_ADDR
+    #define SLOT_MCP_BASE_ADDR 0x20
+#endif
+
+#define MCP_CHIPS ((TOTAL_PARKING_SLOTS + 15) / 16)
+#define MCP_REG_GPPUA 0x0C
+#define MCP_REG_GPIOA 0x12
+
+#if SLOT_MCP_BASE_ADDR + MCP_CHIPS > 0x27
+    #error "MCP23017 addresses overlap the LCD at 0x27; use the shift-register backend"
+#endif
+
+static void busBegin() {
+    // Inputs are the power-on default; enable the pull-ups on both ports
+    for(int chip = 0; chip < MCP_CHIPS; chip++) {
+        Wire.beginTransmission(SLOT_MCP_BASE_ADDR + chip);
+        Wire.write(MCP_REG_GPPUA);
+        Wire.write(0xFF);
+        Wire.write(0xFF);
+        if(Wire.endTransmission() != 0) {
+            Serial.printf("[Slots] MCP23017 at 0x%02X not responding\n", SLOT_MCP_BASE_ADDR + chip);
+        }
+    }
+}
+
+/**
+ * @brief GPIOA and GPIOB of each chip in one sequential read
+ *
+ * Wire holds its bus lock for the whole write/read pair, so this cannot
+ * interleave with an LCD update from the other core.
+ */
+static bool busScan(uint8_t *bytes, int count) {
+    for(int chip = 0; chip < MCP_CHIPS; chip++) {
+        uint8_t addr = SLOT_MCP_BASE_ADDR + chip;
+
+        Wire.beginTransmission(addr);
+        Wire.write(MCP_REG_GPIOA);
+        if(Wire.endTransmission(false) != 0 || Wire.requestFrom(addr, (uint8_t)2) != 2) {
+            return false;
+        }
+        bytes[chip * 2] = Wire.read();
+        if(chip * 2 + 1 < count) bytes[chip * 2 + 1] = Wire.read();
+        else Wire.read();
+    }
+    return true;
+}
+
+#endif // SLOT_SENSOR_TYPE
+
+#if SLOT_SENSOR_TYPE != SLOT_SENSOR_NONE
+// ============================================================================
+// Scan Engine
+// ============================================================================
+
+/**
+ * @brief One scan of every bay into bitmap words (1 = occupied)
+ */
+static bool scanBays(uint32_t *words) {
+    uint8_t bytes[SLOT_MAP_WORDS * 4];
+    const int count = (TOTAL_PARKING_SLOTS + 7) / 8;
+
+    memset(bytes, 0, sizeof(bytes));
+    if(!busScan(bytes, count)) return false;
+
+    // ESP32 is little-endian: byte k / 8 holds bays k .. k + 7
+    memcpy(words, bytes, sizeof(bytes));
+#if SLOT_SENSOR_ACTIVE_LOW
+    for(int w = 0; w < SLOT_MAP_WORDS; w++) words[w] = ~words[w];
+#endif
+    return true;
+}
+
+/**
+ * @brief Snap the gate counter to the bitmap after a sustained mismatch
+ *
+ * A car between the gate and its bay is counted by the gate but not yet
+ * by the sensors, so short disagreements are expected.
+ */
+static void reconcile(uint32_t nowMs) {
+    static uint32_t mismatchSince = 0;
+    static bool mismatch = false;
+
+    ParkingState state;
+    parkingStateRead(&state);
+    int sensedFree = slotMapCount() - slotMapOccupiedCount();
+
+    if(sensedFree == state.availableSlots) {
+        mismatch = false;
+    } else if(!mismatch) {
+        mismatch = true;
+        mismatchSince = nowMs;
+    } else if(nowMs - mismatchSince >= SLOT_RECONCILE_MS) {
+        Serial.printf("[Slots] Counter drift: gate says %d free, sensors say %d - corrected\n",
+                      state.availableSlots, sensedFree);
+        parkingStateSetAvailable(sensedFree);
+        journalAppend(EVENT_COUNT_CORRECTED, sensedFree);
+        mismatch = false;
+    }
+}
+
+void slotScannerBegin() {
+    uint32_t words[SLOT_MAP_WORDS];
+
+    slotMapInit(TOTAL_PARKING_SLOTS);
+    busBegin();
+
+    if(scanBays(words)) {
+        slotMapPrime(words);
+        parkingStateSetAvailable(slotMapCount() - slotMapOccupiedCount());
+        journalAppend(EVENT_COUNT_CORRECTED, slotMapCount() - slotMapOccupiedCount());
+        Serial.printf("[Slots] %d bays, %d occupied at boot\n", slotMapCount(), slotMapOccupiedCount());
+    } else {
+        Serial.println("[Slots] First scan failed - starting from the gate counter");
+    }
+}
+
+void slotScanTask(void *parameter) {
+    uint32_t words[SLOT_MAP_WORDS];
+    TickType_t lastWake = xTaskGetTickCount();
+
+    Serial.println("[Slots] Started on Core 0");
+
+    while(1) {
+        if(scanBays(words)) {
+            int changed = slotMapUpdate(words);
+            if(changed) {
+                Serial.printf("[Slots] %d bay(s) changed, %d/%d occupied\n",
+                              changed, slotMapOccupiedCount(), slotMapCount());
+            }
+            reconcile(millis());
+        }
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SLOT_SCAN_INTERVAL_MS));
+    }
+}
+
+#else
+
+void slotScannerBegin() {
+    // No per-bay sensors: /slots reports an empty map
+    slotMapInit(0);
+}
+
+void slotScanTask(void *parameter) {
+    vTaskDelete(NULL);
+}
+
+#endif // SLOT_SENSOR_TYPE != SLOT_SENSOR_NONE
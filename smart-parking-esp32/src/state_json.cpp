@@ -0,0 +1,133 @@
+/**
+ * @file state_json.cpp
+ * @brief Zero-allocation JSON serializer for ParkingState
+ */
+
+#include "state_json.h"
+#include "time_service.h"
+#include <stdarg.h>
+
+// Incremental writer used by the delta serializer
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+    int fields;
+    bool ok;
+} JsonOut;
+
+/**
+ * @brief Append one "key":value pair (comma-separated) to the object
+ */
+static void jsonField(JsonOut *out, const char *fmt, ...) {
+    if(!out->ok) return;
+
+    if(out->fields > 0) {
+        if(out->pos + 1 >= out->len) { out->ok = false; return; }
+        out->buf[out->pos++] = ',';
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(out->buf + out->pos, out->len - out->pos, fmt, args);
+    va_end(args);
+
+    if(n < 0 || out->pos + n >= out->len) { out->ok = false; return; }
+    out->pos += n;
+    out->fields++;
+}
+
+size_t stateToJson(const ParkingState *state, uint32_t uptimeSec, const ForecastResult *forecast, char *buf, size_t len) {
+    char timeText[TIME_TEXT_LEN];
+    char dateText[DATE_TEXT_LEN];
+
+    timeFormatEpoch(state->bootEpoch ? state->bootEpoch + uptimeSec : 0, timeText, dateText);
+
+    int n = snprintf(buf, len,
+        "{\"available\":%d,\"occupied\":%d,\"reserved\":%d,\"gate\":\"%s\","
+        "\"temperature\":%.1f,\"humidity\":%.1f,"
+        "\"time\":\"%s\",\"date\":\"%s\",\"bootEpoch\":%lu,"
+        "\"wifi\":%s,\"internet\":%s,\"uptime\":%lu}",
+        state->availableSlots,
+        state->totalSlots - state->availableSlots,
+        state->reservedSlots,
+        gateStateName(state->gate),
+        state->temperature,
+        state->humidity,
+        timeText,
+        dateText,
+        (unsigned long)state->bootEpoch,
+        state->wifiConnected ? "true" : "false",
+        state->internetConnected ? "true" : "false",
+        (unsigned long)uptimeSec);
+
+    if(n < 0 || (size_t)n >= len) return 0;
+
+    // Reopen the object for the optional keys
+    if(state->siteTotal > 0) {
+        char redirect[PARKING_NODE_NAME_MAX + 2] = "null";
+        if(state->redirect[0]) snprintf(redirect, sizeof(redirect), "\"%s\"", state->redirect);
+        int m = snprintf(buf + n - 1, len - n + 1, ",\"siteAvailable\":%d,\"siteTotal\":%d,\"siteNodes\":%u,\"redirect\":%s}",
+                         state->siteAvailable, state->siteTotal, state->siteNodes, redirect);
+        if(m < 0 || (size_t)(n - 1 + m) >= len) return 0;
+        n += m - 1;
+    }
+    if(forecast != NULL) {
+        char minutes[8] = "null";
+        if(forecast->minutesToFull >= 0) snprintf(minutes, sizeof(minutes), "%d", forecast->minutesToFull);
+        int m = snprintf(buf + n - 1, len - n + 1, ",\"fullInMin\":%s,\"forecastReady\":%s}",
+                         minutes, forecast->ready ? "true" : "false");
+        if(m < 0 || (size_t)(n - 1 + m) >= len) return 0;
+        n += m - 1;
+    }
+    return (size_t)n;
+}
+
+size_t stateDeltaToJson(const ParkingState *prev, const ParkingState *cur, char *buf, size_t len) {
+    if(len < 3) return 0;
+
+    JsonOut out = { buf, len, 1, 0, true };
+    buf[0] = '{';
+
+    if(prev->availableSlots != cur->availableSlots || prev->totalSlots != cur->totalSlots) {
+        jsonField(&out, "\"available\":%d", cur->availableSlots);
+        jsonField(&out, "\"occupied\":%d", cur->totalSlots - cur->availableSlots);
+    }
+    if(prev->reservedSlots != cur->reservedSlots) {
+        jsonField(&out, "\"reserved\":%d", cur->reservedSlots);
+    }
+    if(prev->gate != cur->gate) {
+        jsonField(&out, "\"gate\":\"%s\"", gateStateName(cur->gate));
+    }
+    if(prev->temperature != cur->temperature) {
+        jsonField(&out, "\"temperature\":%.1f", cur->temperature);
+    }
+    if(prev->humidity != cur->humidity) {
+        jsonField(&out, "\"humidity\":%.1f", cur->humidity);
+    }
+    // Clients derive time and date from bootEpoch + uptime themselves
+    if(prev->bootEpoch != cur->bootEpoch) {
+        jsonField(&out, "\"bootEpoch\":%lu", (unsigned long)cur->bootEpoch);
+    }
+    if(prev->wifiConnected != cur->wifiConnected) {
+        jsonField(&out, "\"wifi\":%s", cur->wifiConnected ? "true" : "false");
+    }
+    if(prev->internetConnected != cur->internetConnected) {
+        jsonField(&out, "\"internet\":%s", cur->internetConnected ? "true" : "false");
+    }
+
+    if(prev->siteAvailable != cur->siteAvailable || prev->siteTotal != cur->siteTotal || prev->siteNodes != cur->siteNodes) {
+        jsonField(&out, "\"siteAvailable\":%d", cur->siteAvailable);
+        jsonField(&out, "\"siteTotal\":%d", cur->siteTotal);
+        jsonField(&out, "\"siteNodes\":%u", cur->siteNodes);
+    }
+    if(strcmp(prev->redirect, cur->redirect) != 0) {
+        if(cur->redirect[0]) jsonField(&out, "\"redirect\":\"%s\"", cur->redirect);
+        else jsonField(&out, "\"redirect\":null");
+    }
+
+    if(!out.ok || out.fields == 0 || out.pos + 2 > len) return 0;
+    buf[out.pos++] = '}';
+    buf[out.pos] = '\0';
+    return out.pos;
+}
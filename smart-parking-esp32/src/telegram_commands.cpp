@@ -0,0 +1,311 @@
+/**
+ * @file telegram_commands.cpp
+ * @brief Telegram bot commands: sorted dispatch table and reply templates
+ */
+
+#include "telegram_commands.h"
+#include "config.h"
+#include "telegram_outbox.h"
+#include "parking_state.h"
+#include "time_service.h"
+#include "reservation.h"
+#include "metrics.h"
+#include "lane.h"
+#include "forecast.h"
+
+#ifndef TELEGRAM_MSG_MAX
+    #define TELEGRAM_MSG_MAX 512
+#endif
+#ifndef TELEGRAM_REPLY_MAX
+    #define TELEGRAM_REPLY_MAX 256
+#endif
+#ifndef FORECAST_HORIZON_H
+    #define FORECAST_HORIZON_H 12
+#endif
+#ifndef RESERVATION_CHAT_IDS
+    #define RESERVATION_CHAT_IDS ""
+#endif
+#ifndef TELEGRAM_ALERT_CHAT_ID
+    #define TELEGRAM_ALERT_CHAT_ID ""
+#endif
+
+// Handlers write at most len bytes of Markdown into reply; empty = no reply
+typedef void (*CommandHandler)(const char *chatId, const char *args, char *reply, size_t len);
+
+typedef struct {
+    const char *name;
+    CommandHandler handler;
+    bool large;                 // Reply needs TELEGRAM_MSG_MAX, not TELEGRAM_REPLY_MAX
+    const char *help;           // Listed by /start; NULL = hidden alias
+} TelegramCommand;
+
+// ============================================================================
+// Reply Templates
+// ============================================================================
+
+static const char statusTemplate[] = "*🅿️ Parking Status*\n\nAvailable: %d/%d %s\nReserved: %d";
+static const char timeTemplate[] = "*🕒 Date & Time*\n\n📅 %s\n⏰ %s";
+static const char tempTemplate[] = "*🌡️ Environment*\n\nTemperature: %.1f°C\nHumidity: %.1f%%";
+static const char allTemplate[] = "*📊 Complete Status*\n\n📅 %s %s\n\n🅿️ Parking: %d/%d\n🌡️ Temp: %.1f°C\n💧 Humidity: %.1f%%\n📈 %s";
+static const char reservedTemplate[] = "*🅿️ Slot reserved*\n\nCode: `%s`\nHeld for %lu min.\nAt the gate send /arrive %s";
+static const char failedTemplate[] = "*❌ %s*\n\n%s";
+static const char subscribedTemplate[] = "*🔔 Alerts*\n\nSubscribed to: %s";
+
+/**
+ * @brief "full, freed" for a topic mask
+ */
+static void formatTopics(uint8_t topics, char *buf, size_t len) {
+    static const struct { uint8_t bit; const char *name; } names[] = {
+        { TELEGRAM_TOPIC_FULL, "full" }, { TELEGRAM_TOPIC_FREED, "freed" }, { TELEGRAM_TOPIC_SYSTEM, "system" },
+    };
+    size_t pos = 0;
+
+    buf[0] = '\0';
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]) && pos < len; i++) {
+        if(!(topics & names[i].bit)) continue;
+        pos += snprintf(buf + pos, len - pos, "%s%s", pos ? ", " : "", names[i].name);
+    }
+    if(buf[0] == '\0') strlcpy(buf, "nothing", len);
+}
+
+// ============================================================================
+// Handlers
+// ============================================================================
+
+static void cmdStart(const char *chatId, const char *args, char *reply, size_t len);
+
+static void cmdAll(const char *chatId, const char *args, char *reply, size_t len) {
+    ParkingState state;
+    char timeText[TIME_TEXT_LEN];
+    char dateText[DATE_TEXT_LEN];
+
+    ForecastResult forecast;
+    char forecastText[48];
+
+    parkingStateRead(&state);
+    forecastGet(&forecast);
+    timeFormatEpoch(timeServiceNow(), timeText, dateText);
+    if(forecast.minutesToFull == 0) strlcpy(forecastText, "Full now", sizeof(forecastText));
+    else if(forecast.minutesToFull > 0) snprintf(forecastText, sizeof(forecastText), "Full in ~%d min", forecast.minutesToFull);
+    else if(forecast.ready) snprintf(forecastText, sizeof(forecastText), "Not expected full within %d h", FORECAST_HORIZON_H);
+    else strlcpy(forecastText, "Forecast still learning", sizeof(forecastText));
+    snprintf(reply, len, allTemplate, dateText, timeText, state.availableSlots - state.reservedSlots,
+             state.totalSlots, state.temperature, state.humidity, forecastText);
+}
+
+static void cmdArrive(const char *chatId, const char *args, char *reply, size_t len) {
+    char code[RESERVATION_CODE_MAX * 2] = "";
+    char laneArg[16] = "";
+
+    sscanf(args, "%23s %15s", code, laneArg);
+    int lane = laneArg[0] ? laneFind(laneArg) : -1;
+    ReserveResult result = (laneArg[0] && lane < 0) ? RESERVE_INVALID : reservationArrive(code, lane);
+
+    if(result == RESERVE_OK) snprintf(reply, len, "*✅ Checked in*\n\nThe barrier opens for you.");
+    else snprintf(reply, len, failedTemplate, "Check-in failed", reservationResultName(result));
+}
+
+/**
+ * @brief May this chat book and cancel? Listed in RESERVATION_CHAT_IDS,
+ *        or the operator chat (TELEGRAM_ALERT_CHAT_ID) if that is empty
+ */
+static bool mayReserve(const char *chatId) {
+    const char *allowed = RESERVATION_CHAT_IDS[0] ? RESERVATION_CHAT_IDS : TELEGRAM_ALERT_CHAT_ID;
+    size_t idLen = strlen(chatId);
+
+    while(*allowed) {
+        while(*allowed == ' ') allowed++;
+        size_t n = strcspn(allowed, ", ");
+        if(idLen > 0 && n == idLen && strncmp(allowed, chatId, n) == 0) return true;
+        allowed += n;
+        allowed += strspn(allowed, ", ");
+    }
+    return false;
+}
+
+static void cmdCancel(const char *chatId, const char *args, char *reply, size_t len) {
+    ReserveResult result = mayReserve(chatId) ? reservationCancel(args) : RESERVE_UNAUTHORIZED;
+
+    if(result == RESERVE_OK) snprintf(reply, len, "*🗑️ Reservation cancelled*");
+    else snprintf(reply, len, failedTemplate, "Not cancelled", reservationResultName(result));
+}
+
+static void cmdDiag(const char *chatId, const char *args, char *reply, size_t len) {
+    metricsFormatDiag(reply, len);
+}
+
+/**
+ * @brief /reserve [plate] [minutes] - a lone number is the duration
+ */
+static void cmdReserve(const char *chatId, const char *args, char *reply, size_t len) {
+    char first[24] = "";
+    char second[8] = "";
+    const char *plate = "";
+    uint32_t minutes = 0;
+
+    sscanf(args, "%23s %7s", first, second);
+    if(first[0] && second[0] == '\0' && strspn(first, "0123456789") == strlen(first)) {
+        minutes = strtoul(first, NULL, 10);
+    } else {
+        plate = first;
+        minutes = strtoul(second, NULL, 10);
+    }
+
+    char requester[32];
+    snprintf(requester, sizeof(requester), "tg:%s", chatId);
+
+    ReservationInfo info;
+    ReserveResult result = mayReserve(chatId) ? reservationCreate(plate, minutes, requester, &info) : RESERVE_UNAUTHORIZED;
+    if(result == RESERVE_OK) {
+        snprintf(reply, len, reservedTemplate, info.code, (unsigned long)(info.expiresInSec / 60), info.code);
+    } else {
+        snprintf(reply, len, failedTemplate, "Not reserved", reservationResultName(result));
+    }
+}
+
+static void cmdStatus(const char *chatId, const char *args, char *reply, size_t len) {
+    ParkingState state;
+
+    parkingStateRead(&state);
+    int walkIn = state.availableSlots - state.reservedSlots;
+    snprintf(reply, len, statusTemplate, walkIn, state.totalSlots, walkIn == 0 ? "❌ FULL" : "✅", state.reservedSlots);
+}
+
+/**
+ * @brief Topic argument, "all" when none is given; 0 if unknown
+ */
+static uint8_t topicsArg(const char *args) {
+    char name[12] = "";
+    sscanf(args, "%11s", name);
+    return name[0] ? telegramTopicFromName(name) : (uint8_t)TELEGRAM_TOPIC_ALL;
+}
+
+static void cmdSubscribe(const char *chatId, const char *args, char *reply, size_t len) {
+    char topics[32];
+    uint8_t wanted = topicsArg(args);
+
+    if(wanted == 0) {
+        snprintf(reply, len, failedTemplate, "Unknown topic", "Use full, freed, system or all.");
+        return;
+    }
+    if(!telegramSubscribe(chatId, wanted)) {
+        snprintf(reply, len, failedTemplate, "Not subscribed", "Subscriber list is full.");
+        return;
+    }
+    formatTopics(telegramSubscription(chatId), topics, sizeof(topics));
+    snprintf(reply, len, subscribedTemplate, topics);
+}
+
+static void cmdTemp(const char *chatId, const char *args, char *reply, size_t len) {
+    ParkingState state;
+
+    parkingStateRead(&state);
+    snprintf(reply, len, tempTemplate, state.temperature, state.humidity);
+}
+
+static void cmdTime(const char *chatId, const char *args, char *reply, size_t len) {
+    char timeText[TIME_TEXT_LEN];
+    char dateText[DATE_TEXT_LEN];
+
+    timeFormatEpoch(timeServiceNow(), timeText, dateText);
+    snprintf(reply, len, timeTemplate, dateText, timeText);
+}
+
+static void cmdUnsubscribe(const char *chatId, const char *args, char *reply, size_t len) {
+    char topics[32];
+    uint8_t dropped = topicsArg(args);
+
+    if(dropped == 0) {
+        snprintf(reply, len, failedTemplate, "Unknown topic", "Use full, freed, system or all.");
+        return;
+    }
+    telegramUnsubscribe(chatId, dropped);
+    formatTopics(telegramSubscription(chatId), topics, sizeof(topics));
+    snprintf(reply, len, subscribedTemplate, topics);
+}
+
+// ============================================================================
+// Dispatch Table
+// ============================================================================
+
+// Sorted by name (byte order) for the binary search
+static constexpr TelegramCommand commands[] = {
+    { "/all",         cmdAll,         false, "Complete info" },
+    { "/arrive",      cmdArrive,      false, "<code> [lane] - At the gate" },
+    { "/cancel",      cmdCancel,      false, "<code> - Drop a reservation" },
+    { "/diag",        cmdDiag,        true,  "Tasks, queues & latency" },
+    { "/help",        cmdStart,       true,  NULL },
+    { "/reserve",     cmdReserve,     false, "[plate] [min] - Hold a slot" },
+    { "/start",       cmdStart,       true,  NULL },
+    { "/status",      cmdStatus,      false, "Parking status" },
+    { "/subscribe",   cmdSubscribe,   false, "[full|freed|system] - Alerts" },
+    { "/temp",        cmdTemp,        false, "Temperature" },
+    { "/time",        cmdTime,        false, "Date & Time" },
+    { "/unsubscribe", cmdUnsubscribe, false, "[topic] - Stop alerts" },
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+constexpr int nameCompare(const char *a, const char *b) {
+    return *a != *b ? (*a < *b ? -1 : 1) : (*a == '\0' ? 0 : nameCompare(a + 1, b + 1));
+}
+
+constexpr bool commandsSorted(size_t i = 1) {
+    return i >= COMMAND_COUNT || (nameCompare(commands[i - 1].name, commands[i].name) < 0 && commandsSorted(i + 1));
+}
+
+static_assert(commandsSorted(), "commands[] must be sorted by name");
+
+static void cmdStart(const char *chatId, const char *args, char *reply, size_t len) {
+    size_t pos = snprintf(reply, len, "*🚗 FreeRTOS Parking System*\n\nAvailable Commands:");
+
+    for(size_t i = 0; i < COMMAND_COUNT && pos < len; i++) {
+        if(commands[i].help == NULL) continue;
+        pos += snprintf(reply + pos, len - pos, "\n%s %s", commands[i].name, commands[i].help);
+    }
+}
+
+/**
+ * @brief Binary search on the command word (up to a space or '@')
+ */
+static const TelegramCommand *findCommand(const char *text, size_t nameLen) {
+    size_t lo = 0;
+    size_t hi = COMMAND_COUNT;
+
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const char *name = commands[mid].name;
+        int cmp = strncmp(text, name, nameLen);
+        if(cmp == 0 && name[nameLen] != '\0') cmp = -1;     // Text is a prefix of name
+        if(cmp == 0) return &commands[mid];
+        if(cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void telegramHandleCommand(const char *chatId, const char *text) {
+    if(text[0] != '/') return;
+
+    size_t nameLen = strcspn(text, " @");
+    const char *args = text + strcspn(text, " ");
+    while(*args == ' ') args++;
+
+    const TelegramCommand *command = findCommand(text, nameLen);
+    if(command == NULL) {
+        telegramSend(chatId, "Unknown command - send /start for the list.");
+        return;
+    }
+
+    // Only telegramTask gets here, and telegramSend() copies the text
+    static char reply[TELEGRAM_MSG_MAX];
+    size_t len = command->large ? TELEGRAM_MSG_MAX : TELEGRAM_REPLY_MAX;
+
+    reply[0] = '\0';
+    command->handler(chatId, args, reply, len);
+    if(reply[0] != '\0') telegramSend(chatId, reply);
+}
@@ -0,0 +1,308 @@
+/**
+ * @file telegram_outbox.cpp
+ * @brief Outbound Telegram queue with batching, rate limiting and
+ *        alert subscriptions
+ */
+
+#include "telegram_outbox.h"
+#include "config.h"
+#include "connectivity.h"
+#include "static_rtos.h"
+#include <WiFiClientSecure.h>
+#include <UniversalTelegramBot.h>
+#include <Preferences.h>
+
+#ifndef BOT_TOKEN
+    #define BOT_TOKEN "your_telegram_bot_token"
+#endif
+#ifndef TELEGRAM_ALERT_CHAT_ID
+    #define TELEGRAM_ALERT_CHAT_ID ""
+#endif
+#ifndef TELEGRAM_OUTBOX_SIZE
+    #define TELEGRAM_OUTBOX_SIZE 8
+#endif
+#ifndef TELEGRAM_MSG_MAX
+    #define TELEGRAM_MSG_MAX 512
+#endif
+#ifndef TELEGRAM_BATCH_MAX
+    #define TELEGRAM_BATCH_MAX 1024
+#endif
+#ifndef TELEGRAM_RATE_BURST
+    #define TELEGRAM_RATE_BURST 3
+#endif
+#ifndef TELEGRAM_RATE_INTERVAL_MS
+    #define TELEGRAM_RATE_INTERVAL_MS 1000
+#endif
+#ifndef TELEGRAM_MAX_SUBSCRIBERS
+    #define TELEGRAM_MAX_SUBSCRIBERS 16
+#endif
+
+#define CHAT_ID_MAX 24
+
+typedef struct {
+    char chatId[CHAT_ID_MAX];   // Empty for alerts
+    uint8_t topics;             // Alerts: TelegramTopic bits, 0 = direct message
+    char text[TELEGRAM_MSG_MAX];
+} TelegramMessage;
+
+typedef struct {
+    char chatId[CHAT_ID_MAX];
+    uint8_t topics;
+} Subscriber;
+
+static StaticQueue<TelegramMessage, TELEGRAM_OUTBOX_SIZE> outboxMem;
+static QueueHandle_t outbox = NULL;
+static volatile uint32_t droppedMessages = 0;
+
+// Separate session from the polling bot: a long poll holds that socket
+static WiFiClientSecure sendClient;
+static UniversalTelegramBot sendBot(BOT_TOKEN, sendClient);
+
+// ============================================================================
+// Subscribers (NVS "telegram"/"subs")
+// ============================================================================
+static portMUX_TYPE subscribersLock = portMUX_INITIALIZER_UNLOCKED;
+static Subscriber subscribers[TELEGRAM_MAX_SUBSCRIBERS];
+static int subscriberCount = 0;
+
+static const struct {
+    const char *name;
+    uint8_t topics;
+} topicNames[] = {
+    { "full", TELEGRAM_TOPIC_FULL },
+    { "freed", TELEGRAM_TOPIC_FREED },
+    { "system", TELEGRAM_TOPIC_SYSTEM },
+    { "all", TELEGRAM_TOPIC_ALL },
+};
+
+static void loadSubscribers() {
+    Preferences prefs;
+
+    if(!prefs.begin("telegram", true)) return;
+    size_t bytes = prefs.getBytes("subs", subscribers, sizeof(subscribers));
+    prefs.end();
+
+    subscriberCount = bytes / sizeof(Subscriber);
+    for(int i = 0; i < subscriberCount; i++) subscribers[i].chatId[CHAT_ID_MAX - 1] = '\0';
+    if(subscriberCount > 0) Serial.printf("[Telegram] %d alert subscriber(s)\n", subscriberCount);
+}
+
+/**
+ * @brief Write the list back; only the command task changes it
+ */
+static void saveSubscribers() {
+    Subscriber copy[TELEGRAM_MAX_SUBSCRIBERS];
+    Preferences prefs;
+
+    portENTER_CRITICAL(&subscribersLock);
+    int count = subscriberCount;
+    memcpy(copy, subscribers, count * sizeof(Subscriber));
+    portEXIT_CRITICAL(&subscribersLock);
+
+    if(!prefs.begin("telegram", false)) return;
+    if(count > 0) prefs.putBytes("subs", copy, count * sizeof(Subscriber));
+    else prefs.remove("subs");
+    prefs.end();
+}
+
+// Caller holds subscribersLock
+static int findSubscriber(const char *chatId) {
+    for(int i = 0; i < subscriberCount; i++) {
+        if(strcmp(subscribers[i].chatId, chatId) == 0) return i;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Rate Limiter (token bucket)
+// ============================================================================
+static uint32_t tokens = TELEGRAM_RATE_BURST;
+static unsigned long lastRefill = 0;
+
+/**
+ * @brief Block until a send token is available
+ *
+ * Messages queued meanwhile are merged into the next batch.
+ */
+static void takeToken() {
+    while(1) {
+        unsigned long now = millis();
+        uint32_t earned = (now - lastRefill) / TELEGRAM_RATE_INTERVAL_MS;
+        if(earned > 0) {
+            tokens = (tokens + earned > TELEGRAM_RATE_BURST) ? TELEGRAM_RATE_BURST : tokens + earned;
+            lastRefill += earned * TELEGRAM_RATE_INTERVAL_MS;
+        }
+        if(tokens > 0) {
+            // A full bucket does not bank time towards a later burst
+            if(tokens == TELEGRAM_RATE_BURST) lastRefill = now;
+            tokens--;
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(TELEGRAM_RATE_INTERVAL_MS - (now - lastRefill)));
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void telegramOutboxBegin() {
+    outbox = outboxMem.create();
+    loadSubscribers();
+    sendClient.setInsecure();
+    lastRefill = millis();
+}
+
+/**
+ * @brief Queue without blocking, counting drops
+ */
+static bool enqueue(const char *chatId, uint8_t topics, const char *text) {
+    TelegramMessage msg;
+
+    if(outbox == NULL) return false;
+
+    strlcpy(msg.chatId, chatId, sizeof(msg.chatId));
+    msg.topics = topics;
+    strlcpy(msg.text, text, sizeof(msg.text));
+
+    if(xQueueSend(outbox, &msg, 0) != pdTRUE) {
+        droppedMessages++;
+        return false;
+    }
+    return true;
+}
+
+bool telegramSend(const char *chatId, const char *text) {
+    if(chatId[0] == '\0') return false;
+    return enqueue(chatId, 0, text);
+}
+
+bool telegramAlert(TelegramTopic topic, const char *text) {
+    bool anyone = TELEGRAM_ALERT_CHAT_ID[0] != '\0';
+
+    portENTER_CRITICAL(&subscribersLock);
+    for(int i = 0; i < subscriberCount && !anyone; i++) anyone = (subscribers[i].topics & topic) != 0;
+    portEXIT_CRITICAL(&subscribersLock);
+
+    return anyone && enqueue("", topic, text);
+}
+
+bool telegramSubscribe(const char *chatId, uint8_t topics) {
+    bool ok = true;
+
+    portENTER_CRITICAL(&subscribersLock);
+    int i = findSubscriber(chatId);
+    if(i >= 0) {
+        subscribers[i].topics |= topics;
+    } else if(subscriberCount < TELEGRAM_MAX_SUBSCRIBERS) {
+        strlcpy(subscribers[subscriberCount].chatId, chatId, CHAT_ID_MAX);
+        subscribers[subscriberCount].topics = topics;
+        subscriberCount++;
+    } else {
+        ok = false;
+    }
+    portEXIT_CRITICAL(&subscribersLock);
+
+    if(ok) saveSubscribers();
+    return ok;
+}
+
+void telegramUnsubscribe(const char *chatId, uint8_t topics) {
+    portENTER_CRITICAL(&subscribersLock);
+    int i = findSubscriber(chatId);
+    if(i >= 0) {
+        subscribers[i].topics &= ~topics;
+        if(subscribers[i].topics == 0) subscribers[i] = subscribers[--subscriberCount];
+    }
+    portEXIT_CRITICAL(&subscribersLock);
+
+    if(i >= 0) saveSubscribers();
+}
+
+uint8_t telegramSubscription(const char *chatId) {
+    portENTER_CRITICAL(&subscribersLock);
+    int i = findSubscriber(chatId);
+    uint8_t topics = i >= 0 ? subscribers[i].topics : 0;
+    portEXIT_CRITICAL(&subscribersLock);
+    return topics;
+}
+
+int telegramSubscriberCount() {
+    return subscriberCount;
+}
+
+uint8_t telegramTopicFromName(const char *name) {
+    for(size_t i = 0; i < sizeof(topicNames) / sizeof(topicNames[0]); i++) {
+        if(strcasecmp(topicNames[i].name, name) == 0) return topicNames[i].topics;
+    }
+    return 0;
+}
+
+uint32_t telegramOutboxDropped() {
+    return droppedMessages;
+}
+
+/**
+ * @brief Chats an alert goes to: the alert chat, then matching subscribers
+ * @return Number of chat ids written to out
+ */
+static int alertRecipients(uint8_t topics, char out[][CHAT_ID_MAX], int max) {
+    int count = 0;
+
+    if(TELEGRAM_ALERT_CHAT_ID[0] != '\0') strlcpy(out[count++], TELEGRAM_ALERT_CHAT_ID, CHAT_ID_MAX);
+
+    portENTER_CRITICAL(&subscribersLock);
+    for(int i = 0; i < subscriberCount && count < max; i++) {
+        if(!(subscribers[i].topics & topics)) continue;
+        if(strcmp(subscribers[i].chatId, TELEGRAM_ALERT_CHAT_ID) == 0) continue;
+        strlcpy(out[count++], subscribers[i].chatId, CHAT_ID_MAX);
+    }
+    portEXIT_CRITICAL(&subscribersLock);
+
+    return count;
+}
+
+void telegramSendTask(void *parameter) {
+    // Static: too large for the task stack alongside the TLS client
+    static TelegramMessage msg;
+    static TelegramMessage next;
+    static char batch[TELEGRAM_BATCH_MAX];
+    static char recipients[TELEGRAM_MAX_SUBSCRIBERS + 1][CHAT_ID_MAX];
+
+    Serial.println("[Telegram] Sender started on Core 1");
+
+    while(1) {
+        xQueueReceive(outbox, &msg, portMAX_DELAY);
+        takeToken();
+
+        size_t len = strlcpy(batch, msg.text, sizeof(batch));
+        int merged = 1;
+
+        while(xQueuePeek(outbox, &next, 0) == pdTRUE && next.topics == msg.topics && strcmp(next.chatId, msg.chatId) == 0) {
+            size_t extra = strlen(next.text);
+            if(len + 2 + extra >= sizeof(batch)) break;
+
+            xQueueReceive(outbox, &next, 0);
+            memcpy(batch + len, "\n\n", 2);
+            memcpy(batch + len + 2, next.text, extra + 1);
+            len += 2 + extra;
+            merged++;
+        }
+
+        int count = 1;
+        if(msg.topics == 0) strlcpy(recipients[0], msg.chatId, CHAT_ID_MAX);
+        else count = alertRecipients(msg.topics, recipients, TELEGRAM_MAX_SUBSCRIBERS + 1);
+
+        // Every further recipient costs a token: the limit is on sendMessage calls
+        for(int r = 0; r < count; r++) {
+            if(r > 0) takeToken();
+            bool sent = sendBot.sendMessage(recipients[r], batch, "Markdown");
+            connectivityReport(CONN_SOURCE_TELEGRAM, sent);
+            if(!sent) {
+                Serial.printf("[Telegram] Send to %s failed (%d message(s) lost)\n", recipients[r], merged);
+            } else if(merged > 1) {
+                Serial.printf("[Telegram] Sent %d messages in one batch\n", merged);
+            }
+        }
+    }
+}
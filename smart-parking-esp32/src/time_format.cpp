@@ -0,0 +1,43 @@
+/**
+ * @file time_format.cpp
+ * @brief timeFormatEpoch, shared by time_service.cpp and the native build
+ *
+ * Digits are written directly: the fields of a struct tm are bounded, but
+ * snprintf with "%02d" can't know that and warns (-Wformat-truncation)
+ * for the fixed TIME_TEXT_LEN/DATE_TEXT_LEN buffers.
+ */
+
+#include "time_service.h"
+
+// Two digits of value % 100 at out
+static void putDigits2(char *out, int value) {
+    out[0] = '0' + (value / 10) % 10;
+    out[1] = '0' + value % 10;
+}
+
+void timeFormatEpoch(uint32_t localEpoch, char *timeText, char *dateText) {
+    if(localEpoch == 0) {
+        if(timeText) strcpy(timeText, "--:--:--");
+        if(dateText) strcpy(dateText, "----/--/--");
+        return;
+    }
+
+    time_t t = (time_t)localEpoch;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+
+    if(timeText) {
+        strcpy(timeText, "hh:mm:ss");
+        putDigits2(timeText, tm.tm_hour);
+        putDigits2(timeText + 3, tm.tm_min);
+        putDigits2(timeText + 6, tm.tm_sec);
+    }
+    if(dateText) {
+        int year = (tm.tm_year + 1900) % 10000;
+        strcpy(dateText, "yyyy/mm/dd");
+        putDigits2(dateText, year / 100);
+        putDigits2(dateText + 2, year % 100);
+        putDigits2(dateText + 5, tm.tm_mon + 1);
+        putDigits2(dateText + 8, tm.tm_mday);
+    }
+}
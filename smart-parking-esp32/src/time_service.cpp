@@ -0,0 +1,194 @@
+/**
+ * @file time_service.cpp
+ * @brief Local timekeeping: occasional network sync, on-demand formatting
+ */
+
+#include "time_service.h"
+#include "config.h"
+#include "connectivity.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifndef NTP_SERVER
+    #define NTP_SERVER "pool.ntp.org"
+#endif
+#ifndef GMT_OFFSET_SEC
+    #define GMT_OFFSET_SEC 7200
+#endif
+#ifndef DAYLIGHT_OFFSET_SEC
+    #define DAYLIGHT_OFFSET_SEC 0
+#endif
+#ifndef TIME_API_URL
+    #define TIME_API_URL "https://timeapi.io/api/Time/current/zone"
+#endif
+#ifndef TIME_ZONE
+    #define TIME_ZONE "Africa/Cairo"
+#endif
+#ifndef TIME_SYNC_INTERVAL_MS
+    #define TIME_SYNC_INTERVAL_MS 3600000
+#endif
+#ifndef TIME_SNTP_TIMEOUT_MS
+    #define TIME_SNTP_TIMEOUT_MS 15000
+#endif
+#ifndef TIME_RETRY_INTERVAL_MS
+    #define TIME_RETRY_INTERVAL_MS 60000
+#endif
+
+#define LOCAL_OFFSET_SEC (GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC)
+
+// Last sync: local epoch (us) at esp_timer reading syncTimerUs
+static portMUX_TYPE syncLock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t syncEpochUs = 0;
+static int64_t syncTimerUs = 0;
+static bool synced = false;
+
+static int64_t lastApiAttemptUs = 0;
+
+// ============================================================================
+// Sync Points
+// ============================================================================
+
+static void setSyncPoint(int64_t localEpochUs, int64_t timerUs) {
+    portENTER_CRITICAL(&syncLock);
+    syncEpochUs = localEpochUs;
+    syncTimerUs = timerUs;
+    synced = true;
+    portEXIT_CRITICAL(&syncLock);
+}
+
+/**
+ * @brief SNTP callback (lwIP task) - system time was just set
+ */
+static void onSntpSync(struct timeval *tv) {
+    int64_t utcUs = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+    setSyncPoint(utcUs + (int64_t)LOCAL_OFFSET_SEC * 1000000LL, esp_timer_get_time());
+    connectivityReport(CONN_SOURCE_NTP, true);
+    Serial.println("[Time] SNTP sync");
+}
+
+/**
+ * @brief Days since 1970-01-01 for a proleptic Gregorian date
+ */
+static int32_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    int32_t yoe = year - era * 400;
+    int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief One HTTPS request for date and time together (SNTP fallback)
+ */
+static bool syncFromApi() {
+    HTTPClient http;
+    bool ok = false;
+
+    http.begin(TIME_API_URL "?timeZone=" TIME_ZONE);
+    http.setTimeout(5000);
+    http.addHeader("Accept", "application/json");
+    http.useHTTP10(true);   // No chunked encoding, so the body can be parsed as a stream
+
+    int64_t requestUs = esp_timer_get_time();
+    if(http.GET() == HTTP_CODE_OK) {
+        StaticJsonDocument<512> doc;
+
+        // Parsed straight off the socket; the body never becomes a String
+        if(!deserializeJson(doc, http.getStream())) {
+            int64_t days = daysFromCivil((int)doc["year"], (int)doc["month"], (int)doc["day"]);
+            int64_t secs = days * 86400 + (int)doc["hour"] * 3600 + (int)doc["minute"] * 60 + (int)doc["seconds"];
+            int64_t ms = (int)doc["milliSeconds"];      // 0 if absent
+
+            // The reply was generated somewhere within the round trip
+            int64_t midUs = requestUs + (esp_timer_get_time() - requestUs) / 2;
+            setSyncPoint(secs * 1000000LL + ms * 1000, midUs);
+            ok = true;
+        }
+    }
+    http.end();
+
+    connectivityReport(CONN_SOURCE_TIME_API, ok);
+    return ok;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void timeServiceBegin() {
+    sntp_set_sync_interval(TIME_SYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(onSntpSync);
+    configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+    Serial.println("[Time] NTP configured");
+}
+
+void timeServiceMaintain(bool wifiConnected) {
+    int64_t now = esp_timer_get_time();
+    int64_t sinceSync;
+
+    portENTER_CRITICAL(&syncLock);
+    sinceSync = synced ? now - syncTimerUs : now;
+    portEXIT_CRITICAL(&syncLock);
+
+    // SNTP normally resyncs on its own; only step in when it is overdue
+    int64_t overdueUs = synced ? 2LL * TIME_SYNC_INTERVAL_MS * 1000 : (int64_t)TIME_SNTP_TIMEOUT_MS * 1000;
+    if(!wifiConnected || sinceSync < overdueUs) return;
+    if(lastApiAttemptUs != 0 && now - lastApiAttemptUs < (int64_t)TIME_RETRY_INTERVAL_MS * 1000) return;
+
+    lastApiAttemptUs = now;
+    if(syncFromApi()) {
+        Serial.println("[Time] Synced from time API");
+    } else {
+        Serial.println("[Time] Time API request failed");
+    }
+}
+
+bool timeServiceValid() {
+    return synced;
+}
+
+/**
+ * @brief Local epoch in microseconds (0 if never synced)
+ */
+static int64_t nowUs() {
+    int64_t epochUs, timerUs;
+    bool valid;
+
+    portENTER_CRITICAL(&syncLock);
+    epochUs = syncEpochUs;
+    timerUs = syncTimerUs;
+    valid = synced;
+    portEXIT_CRITICAL(&syncLock);
+
+    if(!valid) return 0;
+    return epochUs + (esp_timer_get_time() - timerUs);
+}
+
+uint32_t timeServiceNow() {
+    return (uint32_t)(nowUs() / 1000000LL);
+}
+
+uint32_t timeServiceBootEpoch() {
+    int64_t epochUs, timerUs;
+    bool valid;
+
+    portENTER_CRITICAL(&syncLock);
+    epochUs = syncEpochUs;
+    timerUs = syncTimerUs;
+    valid = synced;
+    portEXIT_CRITICAL(&syncLock);
+
+    if(!valid) return 0;
+    return (uint32_t)((epochUs - timerUs + 500000) / 1000000LL);
+}
+
+uint32_t timeServiceMsToNextSecond() {
+    int64_t us = synced ? nowUs() : esp_timer_get_time();
+    return 1000 - (uint32_t)((us / 1000) % 1000);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file trace.cpp
+ * @brief Per-event latency trace from IR edge to servo command
+ */
+
+#include "trace.h"
+#include "config.h"
+#include "lane.h"
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 128
+#endif
+
+// Stage times are stored as offsets from the edge to keep records small
+typedef struct {
+    volatile uint32_t stamp;    // Write index + 1 once complete, 0 while being written
+    uint32_t seq;
+    int64_t edgeUs;
+    uint32_t queuedUs;          // Edge -> xQueueSend
+    uint32_t dequeuedUs;        // Edge -> gate task receive
+    uint32_t actuatedUs;        // Edge -> servo write (0 = none)
+    uint8_t type;               // EventType
+    uint8_t lane;
+    uint8_t outcome;            // TraceOutcome
+} TraceRecord;
+
+static TraceRecord ring[TRACE_RING_SIZE];
+static volatile uint32_t written = 0;       // Slots claimed so far
+static uint32_t nextSeq = 0;
+
+// Readers copy the ring here first; /trace and the serial dump take turns
+static TraceRecord snap[TRACE_RING_SIZE];
+static uint32_t totals[TRACE_RING_SIZE];
+static SemaphoreHandle_t readMutex = NULL;
+static StaticSemaphore_t readMutexBuffer;
+
+static const char *const outcomeNames[] = { "opened", "held", "denied" };
+
+static uint32_t sinceEdge(const SystemEvent *event, int64_t us) {
+    if(us == 0 || us < event->detectedUs) return 0;
+    return (uint32_t)(us - event->detectedUs);
+}
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+void traceBegin() {
+    readMutex = xSemaphoreCreateMutexStatic(&readMutexBuffer);
+}
+
+uint32_t traceNextSeq() {
+    return __atomic_fetch_add(&nextSeq, 1, __ATOMIC_RELAXED);
+}
+
+void traceRecord(const SystemEvent *event, int64_t actuatedUs, TraceOutcome outcome) {
+    uint32_t index = __atomic_fetch_add(&written, 1, __ATOMIC_RELAXED);
+    TraceRecord *r = &ring[index % TRACE_RING_SIZE];
+
+    r->stamp = 0;
+    __sync_synchronize();
+    r->seq = event->seq;
+    r->edgeUs = event->detectedUs;
+    r->queuedUs = sinceEdge(event, event->queuedUs);
+    r->dequeuedUs = sinceEdge(event, event->dequeuedUs);
+    r->actuatedUs = sinceEdge(event, actuatedUs);
+    r->type = event->type;
+    r->lane = (uint8_t)event->value;
+    r->outcome = outcome;
+    __sync_synchronize();
+    r->stamp = index + 1;
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+/**
+ * @brief Copy the valid records into snap, oldest first
+ * @return Number of records copied
+ */
+static uint32_t takeSnapshot() {
+    uint32_t end = written;
+    uint32_t start = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+    uint32_t count = 0;
+
+    for(uint32_t i = start; i < end; i++) {
+        const TraceRecord *r = &ring[i % TRACE_RING_SIZE];
+        uint32_t stamp = r->stamp;
+
+        __sync_synchronize();
+        memcpy(&snap[count], (const void *)r, sizeof(TraceRecord));
+        __sync_synchronize();
+        // Still being written, or overwritten by a newer event while we copied
+        if(stamp != i + 1 || r->stamp != stamp) continue;
+        count++;
+    }
+    return count;
+}
+
+static void sortTotals(uint32_t *values, uint32_t count) {
+    for(uint32_t i = 1; i < count; i++) {
+        uint32_t v = values[i];
+        uint32_t j = i;
+        while(j > 0 && values[j - 1] > v) {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = v;
+    }
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t count, uint32_t pct) {
+    if(count == 0) return 0;
+    uint32_t rank = (count * pct + 99) / 100;     // Nearest-rank
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+bool traceWrite(ChunkSink sink, void *ctx) {
+    static ChunkWriter out;
+
+    if(readMutex == NULL || xSemaphoreTake(readMutex, portMAX_DELAY) != pdTRUE) return false;
+
+    uint32_t count = takeSnapshot();
+    uint32_t opened = 0;
+    uint32_t minSeq = UINT32_MAX;
+    uint32_t maxSeq = 0;
+    for(uint32_t i = 0; i < count; i++) {
+        if(snap[i].outcome == TRACE_OPENED) totals[opened++] = snap[i].actuatedUs;
+        if(snap[i].seq < minSeq) minSeq = snap[i].seq;
+        if(snap[i].seq > maxSeq) maxSeq = snap[i].seq;
+    }
+    // Gate tasks finish out of order, so count missing numbers, not jumps
+    uint32_t gaps = count ? maxSeq - minSeq + 1 - count : 0;
+    sortTotals(totals, opened);
+
+    chunkWriterInit(&out, sink, ctx);
+    chunkPrintf(&out, "# build=%s %s events=%lu opened=%lu seq_gaps=%lu\n",
+                __DATE__, __TIME__, (unsigned long)count, (unsigned long)opened, (unsigned long)gaps);
+    chunkPrintf(&out, "# edge_to_servo_us p50=%lu p90=%lu p99=%lu max=%lu\n",
+                (unsigned long)percentile(totals, opened, 50), (unsigned long)percentile(totals, opened, 90),
+                (unsigned long)percentile(totals, opened, 99), (unsigned long)(opened ? totals[opened - 1] : 0));
+    chunkPrintf(&out, "seq,lane,event,outcome,edge_us,queued_us,dequeued_us,actuated_us\n");
+
+    for(uint32_t i = 0; i < count; i++) {
+        const TraceRecord *r = &snap[i];
+        const char *lane = r->lane < laneCount() ? laneConfig(r->lane)->name : "?";
+        chunkPrintf(&out, "%lu,%s,%s,%s,%lld,%lu,%lu,%lu\n",
+                    (unsigned long)r->seq, lane, r->type == EVENT_CAR_ENTRY ? "entry" : "exit",
+                    outcomeNames[r->outcome], (long long)r->edgeUs,
+                    (unsigned long)r->queuedUs, (unsigned long)r->dequeuedUs, (unsigned long)r->actuatedUs);
+    }
+
+    bool ok = chunkFlush(&out);
+    xSemaphoreGive(readMutex);
+    return ok;
+}
@@ -0,0 +1,526 @@
+/**
+ * @file web_server.cpp
+ * @brief HTTP dashboard server: routes /, /data, /slots, /history, /metrics, /trace, /events and /reserve
+ */
+
+#include "web_server.h"
+#include "parking_state.h"
+#include "state_json.h"
+#include "live_events.h"
+#include "slot_map.h"
+#include "history.h"
+#include "metrics.h"
+#include "trace.h"
+#include "reservation.h"
+#include "lane.h"
+#include "forecast.h"
+#include "dashboard_html.h"  // Generated by scripts/embed_web.py
+#include "lwip/sockets.h"
+
+#ifndef WEB_CACHE_CONTROL
+    #define WEB_CACHE_CONTROL "no-cache"
+#endif
+#ifndef SSE_MAX_CLIENTS
+    #define SSE_MAX_CLIENTS 8
+#endif
+#ifndef WEB_REQUEST_SOCKETS
+    #define WEB_REQUEST_SOCKETS 4
+#endif
+#ifndef RESERVATION_API_TOKEN
+    #define RESERVATION_API_TOKEN ""
+#endif
+
+/**
+ * @brief Non-blocking write for event streams; a full send buffer comes
+ * back as a short write and the viewer is dropped (EventSource reconnects)
+ */
+static int streamSend(int sock, const char *data, size_t len) {
+    return send(sock, data, len, MSG_DONTWAIT);
+}
+
+#define RESERVE_JSON_MAX 96
+
+/**
+ * @brief Compare the whole token whatever the input, so the reply time
+ *        does not give away how much of it matched
+ */
+static bool tokenMatches(const char *given) {
+    static const char expected[] = RESERVATION_API_TOKEN;
+    size_t givenLen = strlen(given);
+    uint8_t diff = givenLen != sizeof(expected) - 1;
+    
+    for(size_t i = 0; i < sizeof(expected) - 1; i++) {
+        diff |= expected[i] ^ (i < givenLen ? given[i] : 0);
+    }
+    return sizeof(expected) > 1 && diff == 0;
+}
+
+/**
+ * @brief POST /reserve, shared by both backends
+ *
+ *   ?token=<t>&plate=<plate>&minutes=<n>[&requester=<id>]
+ *                                book (no plate: a token is issued)
+ *   ?token=<t>&cancel=<code>     drop a reservation
+ *   ?arrive=<code>&lane=<lane>   check in at a barrier (lane optional)
+ *
+ * Booking and cancelling need RESERVATION_API_TOKEN. A front end holding
+ * it passes its user as requester, so RESERVATION_PER_REQUESTER applies
+ * per user instead of to the front end as a whole.
+ *
+ * @return HTTP status; json receives {"ok":...} and the code or error
+ */
+static int reserveRequest(const char *token, const char *requesterArg, const char *plate, const char *minutes,
+                          const char *cancel, const char *arrive, const char *laneArg, char *json, size_t len) {
+    ReserveResult result;
+    ReservationInfo info;
+    bool created = false;
+    char requester[32];
+    
+    if(arrive[0]) {
+        int lane = laneArg[0] ? laneFind(laneArg) : -1;
+        result = (laneArg[0] && lane < 0) ? RESERVE_INVALID : reservationArrive(arrive, lane);
+    } else if(!tokenMatches(token)) {
+        result = RESERVE_UNAUTHORIZED;
+    } else if(cancel[0]) {
+        result = reservationCancel(cancel);
+    } else {
+        snprintf(requester, sizeof(requester), "web:%s", requesterArg);
+        result = reservationCreate(plate, strtoul(minutes, NULL, 10), requester, &info);
+        created = result == RESERVE_OK;
+    }
+    
+    if(created) {
+        snprintf(json, len, "{\"ok\":true,\"code\":\"%s\",\"expiresIn\":%lu}", info.code, (unsigned long)info.expiresInSec);
+    } else if(result == RESERVE_OK) {
+        snprintf(json, len, "{\"ok\":true}");
+    } else {
+        snprintf(json, len, "{\"ok\":false,\"error\":\"%s\"}", reservationResultName(result));
+    }
+    
+    switch(result) {
+        case RESERVE_OK:           return 200;
+        case RESERVE_INVALID:      return 400;
+        case RESERVE_UNAUTHORIZED: return 403;
+        case RESERVE_NOT_FOUND:    return 404;
+        default:                   return 409;
+    }
+}
+
+#if !WEB_ASYNC_BACKEND
+// ============================================================================
+// Synchronous Backend (Arduino WebServer)
+// ============================================================================
+#include <WebServer.h>
+
+static WebServer server(80);
+
+// Copies of the /events clients keep their sockets open after the handler
+// returns (WiFiClient shares the socket between copies)
+static WiFiClient streamHolders[SSE_MAX_CLIENTS];
+static SemaphoreHandle_t holdersMutex = NULL;
+static StaticSemaphore_t holdersMutexBuffer;
+
+static void streamClose(int sock) {
+    if(!metricsMutexTake(METRICS_MUTEX_WEB_STREAMS, holdersMutex, portMAX_DELAY)) return;
+    for(int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if(streamHolders[i].fd() == sock) streamHolders[i].stop();
+    }
+    xSemaphoreGive(holdersMutex);
+}
+
+static const LiveEventsTransport streamTransport = { streamSend, streamClose };
+
+/**
+ * @brief Keep a reference to the client; returns the slot or -1 if full
+ */
+static int holdClient(WiFiClient &client) {
+    int slot = -1;
+    if(!metricsMutexTake(METRICS_MUTEX_WEB_STREAMS, holdersMutex, portMAX_DELAY)) return -1;
+    for(int i = 0; i < SSE_MAX_CLIENTS && slot < 0; i++) {
+        if(streamHolders[i].fd() < 0) {
+            streamHolders[i] = client;
+            slot = i;
+        }
+    }
+    xSemaphoreGive(holdersMutex);
+    return slot;
+}
+
+/**
+ * @brief Drop a held reference; close the socket too, or leave it to the
+ *        server for an error reply
+ */
+static void releaseClient(int slot, bool closeSocket) {
+    if(slot < 0 || !metricsMutexTake(METRICS_MUTEX_WEB_STREAMS, holdersMutex, portMAX_DELAY)) return;
+    if(closeSocket) streamHolders[slot].stop();
+    streamHolders[slot] = WiFiClient();
+    xSemaphoreGive(holdersMutex);
+}
+
+/**
+ * @brief Handle / - serve the pre-gzipped dashboard straight from flash
+ *
+ * The page is compressed at build time (scripts/embed_web.py). Clients
+ * revalidate with If-None-Match and get an empty 304 while the firmware
+ * (and therefore the ETag) is unchanged.
+ */
+static void handleRoot() {
+    server.sendHeader("ETag", DASHBOARD_ETAG);
+    server.sendHeader("Cache-Control", WEB_CACHE_CONTROL);
+    
+    if(server.header("If-None-Match") == DASHBOARD_ETAG) {
+        server.send(304);
+        return;
+    }
+    
+    // Every browser we target accepts gzip; there is no plain copy on flash
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, "text/html", (PGM_P)DASHBOARD_HTML_GZ, DASHBOARD_HTML_GZ_LEN);
+}
+
+/**
+ * @brief Handle /data endpoint - returns JSON with all sensor data
+ *
+ * Serialized into a stack buffer; no String is built on this path.
+ */
+static void handleData() {
+    ParkingState state;
+    ForecastResult forecast;
+    char json[STATE_JSON_MAX];
+    
+    parkingStateRead(&state);
+    forecastGet(&forecast);
+    size_t len = stateToJson(&state, millis() / 1000, &forecast, json, sizeof(json));
+    
+    if(len == 0) {
+        server.send(500, "text/plain", "serialization failed");
+        return;
+    }
+    server.send_P(200, "application/json", json, len);
+}
+
+/**
+ * @brief Handle /slots - per-bay occupancy bitmap
+ */
+static void handleSlots() {
+    char json[SLOT_JSON_MAX];
+    size_t len = slotMapToJson(json, sizeof(json));
+    
+    if(len == 0) {
+        server.send(500, "text/plain", "serialization failed");
+        return;
+    }
+    server.send_P(200, "application/json", json, len);
+}
+
+static bool chunkSink(void *ctx, const char *data, size_t len) {
+    server.sendContent(data, len);
+    return server.client().connected();
+}
+
+/**
+ * @brief Handle /history?res=<s>&from=<t>&to=<t>&format=csv|bin - chunked
+ */
+static void handleHistory() {
+    HistoryQuery query;
+    
+    query.resolutionSec = server.arg("res").toInt();
+    query.from = strtoul(server.arg("from").c_str(), NULL, 10);
+    query.to = strtoul(server.arg("to").c_str(), NULL, 10);
+    query.binary = server.arg("format") == "bin";
+    
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, historyContentType(&query), "");
+    historyStream(&query, chunkSink, NULL);
+    server.sendContent("");     // Terminating chunk
+}
+
+/**
+ * @brief Handle /metrics - Prometheus text exposition, chunked
+ */
+static void handleMetrics() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+    metricsWritePrometheus(chunkSink, NULL);
+    server.sendContent("");
+}
+
+/**
+ * @brief Handle /trace - recent edge-to-servo timings as CSV, chunked
+ */
+static void handleTrace() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "");
+    traceWrite(chunkSink, NULL);
+    server.sendContent("");
+}
+
+/**
+ * @brief Handle POST /reserve - book, cancel or check in
+ */
+static void handleReserve() {
+    char json[RESERVE_JSON_MAX];
+    int status = reserveRequest(server.arg("token").c_str(), server.arg("requester").c_str(),
+                                server.arg("plate").c_str(), server.arg("minutes").c_str(),
+                                server.arg("cancel").c_str(), server.arg("arrive").c_str(),
+                                server.arg("lane").c_str(), json, sizeof(json));
+    server.send(status, "application/json", json);
+}
+
+/**
+ * @brief Handle /events - hand the connection over to the SSE stream
+ */
+static void handleEvents() {
+    WiFiClient client = server.client();
+    int slot = holdClient(client);
+    LiveEventsSubscribeResult result = slot < 0 ? LIVE_EVENTS_FULL : liveEventsSubscribe(client.fd());
+    
+    if(result == LIVE_EVENTS_SUBSCRIBED) return;
+    // Once the 200 and stream headers may be out, a body would land in the stream
+    releaseClient(slot, result == LIVE_EVENTS_SEND_FAILED);
+    if(result == LIVE_EVENTS_FULL) server.send(503, "text/plain", "too many viewers");
+}
+
+void webServerBegin() {
+    holdersMutex = xSemaphoreCreateMutexStatic(&holdersMutexBuffer);
+    liveEventsInit(&streamTransport);
+    
+    static const char *cacheHeaders[] = { "If-None-Match" };
+    server.collectHeaders(cacheHeaders, 1);
+    server.on("/", handleRoot);
+    server.on("/data", handleData);
+    server.on("/slots", handleSlots);
+    server.on("/history", handleHistory);
+    server.on("/metrics", handleMetrics);
+    server.on("/trace", handleTrace);
+    server.on("/events", handleEvents);
+    server.on("/reserve", HTTP_POST, handleReserve);
+    server.begin();
+    
+    Serial.print("[Web] Server started at http://");
+    Serial.println(WiFi.localIP());
+}
+
+void webServerTask(void *parameter) {
+    Serial.println("[Web] Started on Core 1");
+    
+    while(1) {
+        server.handleClient();
+        vTaskDelay(pdMS_TO_TICKS(WEB_SERVER_INTERVAL));
+    }
+}
+
+#else
+// ============================================================================
+// Asynchronous Backend (ESP-IDF esp_http_server)
+// ============================================================================
+#include <WiFi.h>
+#include <esp_http_server.h>
+
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+// esp_http_server keeps three of lwIP's sockets for itself
+static_assert(SSE_MAX_CLIENTS + WEB_REQUEST_SOCKETS <= CONFIG_LWIP_MAX_SOCKETS - 3,
+              "SSE_MAX_CLIENTS + WEB_REQUEST_SOCKETS exceeds CONFIG_LWIP_MAX_SOCKETS");
+#endif
+
+static httpd_handle_t httpServer = NULL;
+
+static void streamClose(int sock) {
+    httpd_sess_trigger_close(httpServer, sock);
+}
+
+static const LiveEventsTransport streamTransport = { streamSend, streamClose };
+
+/**
+ * @brief Session close hook - forget event streams before the fd is reused
+ */
+static void onSocketClosed(httpd_handle_t hd, int sock) {
+    liveEventsForget(sock);
+    close(sock);
+}
+
+/**
+ * @brief GET / - pre-gzipped dashboard from flash, 304 on matching ETag
+ */
+static esp_err_t rootHandler(httpd_req_t *req) {
+    char etag[40];
+    
+    httpd_resp_set_hdr(req, "ETag", DASHBOARD_ETAG);
+    httpd_resp_set_hdr(req, "Cache-Control", WEB_CACHE_CONTROL);
+    
+    if(httpd_req_get_hdr_value_str(req, "If-None-Match", etag, sizeof(etag)) == ESP_OK &&
+       strcmp(etag, DASHBOARD_ETAG) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)DASHBOARD_HTML_GZ, DASHBOARD_HTML_GZ_LEN);
+}
+
+/**
+ * @brief GET /data - JSON snapshot from a stack buffer
+ */
+static esp_err_t dataHandler(httpd_req_t *req) {
+    ParkingState state;
+    ForecastResult forecast;
+    char json[STATE_JSON_MAX];
+    
+    parkingStateRead(&state);
+    forecastGet(&forecast);
+    size_t len = stateToJson(&state, millis() / 1000, &forecast, json, sizeof(json));
+    if(len == 0) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "serialization failed");
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+/**
+ * @brief GET /slots - per-bay occupancy bitmap
+ */
+static esp_err_t slotsHandler(httpd_req_t *req) {
+    char json[SLOT_JSON_MAX];
+    size_t len = slotMapToJson(json, sizeof(json));
+    if(len == 0) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "serialization failed");
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+static bool chunkSink(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
+}
+
+/**
+ * @brief Numeric query parameter, 0 if absent
+ */
+static uint32_t queryNumber(const char *query, const char *key) {
+    char value[16];
+    if(httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return 0;
+    return strtoul(value, NULL, 10);
+}
+
+/**
+ * @brief GET /history?res=<s>&from=<t>&to=<t>&format=csv|bin - chunked
+ */
+static esp_err_t historyHandler(httpd_req_t *req) {
+    char query[96] = "";
+    char format[8] = "";
+    HistoryQuery q;
+    
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    q.resolutionSec = queryNumber(query, "res");
+    q.from = queryNumber(query, "from");
+    q.to = queryNumber(query, "to");
+    httpd_query_key_value(query, "format", format, sizeof(format));
+    q.binary = strcmp(format, "bin") == 0;
+    
+    httpd_resp_set_type(req, historyContentType(&q));
+    if(!historyStream(&q, chunkSink, req)) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief GET /metrics - Prometheus text exposition, chunked
+ */
+static esp_err_t metricsHandler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    if(!metricsWritePrometheus(chunkSink, req)) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief GET /trace - recent edge-to-servo timings as CSV, chunked
+ */
+static esp_err_t traceHandler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/csv");
+    if(!traceWrite(chunkSink, req)) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief POST /reserve - book, cancel or check in
+ */
+static esp_err_t reserveHandler(httpd_req_t *req) {
+    char query[192] = "";
+    char token[48] = "", requester[24] = "";
+    char plate[24] = "", minutes[8] = "", cancel[24] = "", arrive[24] = "", lane[16] = "";
+    char json[RESERVE_JSON_MAX];
+    
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    httpd_query_key_value(query, "token", token, sizeof(token));
+    httpd_query_key_value(query, "requester", requester, sizeof(requester));
+    httpd_query_key_value(query, "plate", plate, sizeof(plate));
+    httpd_query_key_value(query, "minutes", minutes, sizeof(minutes));
+    httpd_query_key_value(query, "cancel", cancel, sizeof(cancel));
+    httpd_query_key_value(query, "arrive", arrive, sizeof(arrive));
+    httpd_query_key_value(query, "lane", lane, sizeof(lane));
+    
+    int status = reserveRequest(token, requester, plate, minutes, cancel, arrive, lane, json, sizeof(json));
+    if(status == 400) httpd_resp_set_status(req, "400 Bad Request");
+    else if(status == 403) httpd_resp_set_status(req, "403 Forbidden");
+    else if(status == 404) httpd_resp_set_status(req, "404 Not Found");
+    else if(status == 409) httpd_resp_set_status(req, "409 Conflict");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief GET /events - the session stays open and live_events owns it
+ */
+static esp_err_t eventsHandler(httpd_req_t *req) {
+    LiveEventsSubscribeResult result = liveEventsSubscribe(httpd_req_to_sockfd(req));
+    
+    if(result == LIVE_EVENTS_FULL) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, "too many viewers", HTTPD_RESP_USE_STRLEN);
+    }
+    // ESP_FAIL makes the server close the session; no reply after a partial stream
+    return result == LIVE_EVENTS_SUBSCRIBED ? ESP_OK : ESP_FAIL;
+}
+
+void webServerBegin() {
+    liveEventsInit(&streamTransport);
+    
+    static const httpd_uri_t routes[] = {
+        { "/",       HTTP_GET, rootHandler,   NULL },
+        { "/data",   HTTP_GET, dataHandler,   NULL },
+        { "/slots",  HTTP_GET, slotsHandler,  NULL },
+        { "/history", HTTP_GET, historyHandler, NULL },
+        { "/metrics", HTTP_GET, metricsHandler, NULL },
+        { "/trace", HTTP_GET, traceHandler, NULL },
+        { "/events", HTTP_GET, eventsHandler, NULL },
+        { "/reserve", HTTP_POST, reserveHandler, NULL },
+    };
+    
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.core_id = COMM_CORE;
+    config.task_priority = WEB_TASK_PRIORITY;
+    config.stack_size = WEB_TASK_STACK;
+    // Every /events stream gets a socket of its own on top of the request
+    // sockets. No LRU purge: a stream never sends another request, so it
+    // would always look oldest and viewers would evict each other
+    config.max_open_sockets = SSE_MAX_CLIENTS + WEB_REQUEST_SOCKETS;
+    config.lru_purge_enable = false;
+    config.close_fn = onSocketClosed;
+    config.max_uri_handlers = sizeof(routes) / sizeof(routes[0]);
+    
+    if(httpd_start(&httpServer, &config) != ESP_OK) {
+        Serial.println("[Web] esp_http_server failed to start!");
+        return;
+    }
+    
+    for(size_t i = 0; i < sizeof(routes) / sizeof(routes[0]); i++) {
+        httpd_register_uri_handler(httpServer, &routes[i]);
+    }
+    
+    Serial.print("[Web] Async server started at http://");
+    Serial.println(WiFi.localIP());
+}
+
+#endif // WEB_ASYNC_BACKEND